@@ -0,0 +1,183 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftabilityKernel.h"
+#include "CraftingRecipeMatcher.h"
+#include "craftingCharacter.h"
+#include "Async/ParallelFor.h"
+
+// SSE is part of every x86 target, other platforms take the scalar loop
+#define CRAFTING_KERNEL_SSE (PLATFORM_ENABLE_VECTORINTRINSICS && !PLATFORM_ENABLE_VECTORINTRINSICS_NEON)
+
+DECLARE_CYCLE_STAT(TEXT("Craftability Kernel"), STAT_CraftabilityKernel, STATGROUP_Crafting);
+
+/** Players evaluated by one worker task, large enough that scheduling does not show up */
+static const int32 PlayersPerTask = 64;
+
+/** Max craft count of one dense recipe row, 0 when a requirement is not met and MAX_int32 when nothing is required */
+static FORCEINLINE int32 EvaluateRow(const float* RESTRICT Counts, const float* RESTRICT Requirements, const float* RESTRICT Divisors, const float* RESTRICT Floors, int32 RowWidth)
+{
+#if CRAFTING_KERNEL_SSE
+	__m128 Min = _mm_set1_ps(BIG_NUMBER);
+	for (int32 i = 0; i < RowWidth; i += 4)
+	{
+		const __m128 Count = _mm_load_ps(Counts + i);
+
+		// most recipes are out of reach, reject them before paying for the divisions
+		if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_load_ps(Requirements + i), Count)) != 0)
+		{
+			return 0;
+		}
+		Min = _mm_min_ps(Min, _mm_max_ps(_mm_div_ps(Count, _mm_load_ps(Divisors + i)), _mm_load_ps(Floors + i)));
+	}
+	Min = _mm_min_ps(Min, _mm_shuffle_ps(Min, Min, _MM_SHUFFLE(1, 0, 3, 2)));
+	Min = _mm_min_ps(Min, _mm_shuffle_ps(Min, Min, _MM_SHUFFLE(2, 3, 0, 1)));
+	const float Result = _mm_cvtss_f32(Min);
+#else
+	float Result = BIG_NUMBER;
+	for (int32 i = 0; i < RowWidth; i++)
+	{
+		if (Requirements[i] > Counts[i])
+		{
+			return 0;
+		}
+		Result = FMath::Min(Result, FMath::Max(Counts[i] / Divisors[i], Floors[i]));
+	}
+#endif
+	return Result >= BIG_NUMBER ? MAX_int32 : (int32)Result;
+}
+
+FCraftabilityKernel::FCraftabilityKernel()
+	: RowWidth(0)
+	, NumRecipes(0)
+	, NumPlayers(0)
+	, NumMaskWords(0)
+{
+}
+
+void FCraftabilityKernel::SetRecipes(const TArray<FCraftingRecipe>& Recipes)
+{
+	ItemIds.Reset();
+	MatcherRecipes.Reset();
+	RecipeKinds.Reset(Recipes.Num());
+
+	for (const FCraftingRecipe& Recipe : Recipes)
+	{
+		const bool bMatcher = FRecipeMatcher::HasWildcards(Recipe);
+		RecipeKinds.Add(Recipe.Ingredients.Num() == 0 ? ERecipeKind::Empty : bMatcher ? ERecipeKind::Matcher : ERecipeKind::Dense);
+		if (bMatcher)
+		{
+			MatcherRecipes.Emplace(RecipeKinds.Num() - 1, Recipe);
+			continue;
+		}
+
+		for (const FRecipeIngredient& Ingredient : Recipe.Ingredients)
+		{
+			if (Ingredient.Class != nullptr && !ItemIds.Contains(Ingredient.Class))
+			{
+				ItemIds.Add(Ingredient.Class, ItemIds.Num());
+			}
+		}
+	}
+
+	NumRecipes = Recipes.Num();
+	NumMaskWords = (NumRecipes + 31) / 32;
+	RowWidth = Align(FMath::Max(ItemIds.Num(), 1), 4);
+
+	Requirements.SetNumZeroed(NumRecipes * RowWidth);
+	Divisors.Init(1.0f, NumRecipes * RowWidth);
+	Floors.Init(BIG_NUMBER, NumRecipes * RowWidth);
+
+	for (int32 Recipe = 0; Recipe < NumRecipes; Recipe++)
+	{
+		if (RecipeKinds[Recipe] != ERecipeKind::Dense)
+		{
+			continue;
+		}
+
+		// an item listed twice needs both amounts from the same stack
+		const int32 Row = Recipe * RowWidth;
+		for (const FRecipeIngredient& Ingredient : Recipes[Recipe].Ingredients)
+		{
+			if (Ingredient.Class != nullptr && Ingredient.Number > 0)
+			{
+				const int32 Cell = Row + ItemIds.FindChecked(Ingredient.Class);
+				Requirements[Cell] = FMath::Min<float>(Requirements[Cell] + Ingredient.Number, MaxItemCount);
+				Divisors[Cell] = Requirements[Cell];
+				Floors[Cell] = 0.0f;
+			}
+		}
+	}
+
+	SetNumPlayers(NumPlayers);
+}
+
+void FCraftabilityKernel::SetNumPlayers(int32 InNumPlayers)
+{
+	NumPlayers = InNumPlayers;
+	Counts.SetNumUninitialized(NumPlayers * RowWidth);
+	MaxCounts.SetNumUninitialized(NumPlayers * NumRecipes);
+	Masks.SetNumUninitialized(NumPlayers * NumMaskWords);
+	PlayerItems.SetNum(MatcherRecipes.Num() > 0 ? NumPlayers : 0);
+}
+
+void FCraftabilityKernel::SetPlayerItems(int32 Player, const TArray<FPickupItem>& Items)
+{
+	float* Row = Counts.GetData() + Player * RowWidth;
+	FMemory::Memzero(Row, RowWidth * sizeof(float));
+
+	for (const FPickupItem& Item : Items)
+	{
+		// items no recipe asks for have no column
+		if (const int32* ItemId = ItemIds.Find(Item.Class))
+		{
+			Row[*ItemId] = FMath::Min<float>(Row[*ItemId] + FMath::Max(Item.Number, 0), MaxItemCount);
+		}
+	}
+
+	if (PlayerItems.Num() > 0)
+	{
+		PlayerItems[Player] = Items;
+	}
+}
+
+void FCraftabilityKernel::Evaluate()
+{
+	SCOPE_CYCLE_COUNTER(STAT_CraftabilityKernel);
+
+	const int32 NumTasks = (NumPlayers + PlayersPerTask - 1) / PlayersPerTask;
+	ParallelFor(NumTasks, [this](int32 Task)
+	{
+		const int32 LastPlayer = FMath::Min(NumPlayers, (Task + 1) * PlayersPerTask);
+		for (int32 Player = Task * PlayersPerTask; Player < LastPlayer; Player++)
+		{
+			EvaluatePlayer(Player);
+		}
+	});
+}
+
+void FCraftabilityKernel::EvaluatePlayer(int32 Player)
+{
+	const float* PlayerCounts = Counts.GetData() + Player * RowWidth;
+	int32* PlayerMaxCounts = MaxCounts.GetData() + Player * NumRecipes;
+
+	for (int32 Recipe = 0; Recipe < NumRecipes; Recipe++)
+	{
+		const int32 Row = Recipe * RowWidth;
+		PlayerMaxCounts[Recipe] = RecipeKinds[Recipe] == ERecipeKind::Dense
+			? EvaluateRow(PlayerCounts, Requirements.GetData() + Row, Divisors.GetData() + Row, Floors.GetData() + Row, RowWidth)
+			: 0;
+	}
+
+	for (const TPair<int32, FCraftingRecipe>& Pair : MatcherRecipes)
+	{
+		PlayerMaxCounts[Pair.Key] = FRecipeMatcher::GetMaxCraftCount(Pair.Value, PlayerItems[Player]);
+	}
+
+	uint32* PlayerMask = Masks.GetData() + Player * NumMaskWords;
+	FMemory::Memzero(PlayerMask, NumMaskWords * sizeof(uint32));
+	for (int32 Recipe = 0; Recipe < NumRecipes; Recipe++)
+	{
+		PlayerMask[Recipe / 32] |= PlayerMaxCounts[Recipe] > 0 ? 1u << (Recipe % 32) : 0u;
+	}
+}
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CraftingRecipe.h"
+
+struct FPickupItem;
+
+/**
+ * Max craft counts of many players for every recipe of one recipe list, evaluated in a batch.
+ *
+ * Item classes used by the recipes get dense ids. Each player is packed into a row of float counts indexed by
+ * item id and each recipe into requirement rows of the same width, padded to whole vector registers. A recipe
+ * is evaluated four items at a time: one compare rejects it as soon as a requirement is not met, otherwise the
+ * counts are divided by the requirements and reduced with min. Counts are clamped to MaxItemCount, below that
+ * the float division floors exactly. Players are split across the worker threads.
+ *
+ * Category and wildcard ingredients cannot be written as a requirement row, those recipes go through
+ * FRecipeMatcher for every player instead.
+ */
+class FCraftabilityKernel
+{
+public:
+	static const int32 MaxItemCount = 1 << 22;
+
+	FCraftabilityKernel();
+
+	void SetRecipes(const TArray<FCraftingRecipe>& Recipes);
+
+	/** Resizes the player rows, their counts are undefined until SetPlayerItems */
+	void SetNumPlayers(int32 InNumPlayers);
+	void SetPlayerItems(int32 Player, const TArray<FPickupItem>& Items);
+
+	/** Evaluates every recipe for every player */
+	void Evaluate();
+
+	int32 GetMaxCraftCount(int32 Player, int32 Recipe) const { return MaxCounts[Player * NumRecipes + Recipe]; }
+	bool CanCraft(int32 Player, int32 Recipe) const { return (Masks[Player * NumMaskWords + Recipe / 32] & (1u << (Recipe % 32))) != 0; }
+
+	int32 GetNumPlayers() const { return NumPlayers; }
+	int32 GetNumRecipes() const { return NumRecipes; }
+	int32 GetNumItemIds() const { return ItemIds.Num(); }
+
+private:
+	enum class ERecipeKind : uint8
+	{
+		Dense,
+		Matcher,
+		Empty
+	};
+
+	void EvaluatePlayer(int32 Player);
+
+	TMap<UClass*, int32> ItemIds;
+
+	/** Floats per row, the number of item ids rounded up to a multiple of four */
+	int32 RowWidth;
+	int32 NumRecipes;
+	int32 NumPlayers;
+	int32 NumMaskWords;
+
+	TArray<ERecipeKind> RecipeKinds;
+
+	// one row per recipe: items needed per craft (0 when not needed), the divisor (1 when not needed)
+	// and a floor that keeps items the recipe does not need out of the min (BIG_NUMBER when not needed)
+	TArray<float, TAlignedHeapAllocator<16>> Requirements;
+	TArray<float, TAlignedHeapAllocator<16>> Divisors;
+	TArray<float, TAlignedHeapAllocator<16>> Floors;
+
+	/** One row per player */
+	TArray<float, TAlignedHeapAllocator<16>> Counts;
+
+	TArray<int32> MaxCounts;
+	TArray<uint32> Masks;
+
+	/** Recipes and inventories for the FRecipeMatcher fallback, only kept when a recipe needs it */
+	TArray<TPair<int32, FCraftingRecipe>> MatcherRecipes;
+	TArray<TArray<FPickupItem>> PlayerItems;
+};
@@ -0,0 +1,186 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingContentStreamer.h"
+#include "CraftingItemCatalog.h"
+
+FCraftingContentStreamer* FCraftingContentStreamer::Instance = nullptr;
+
+/** Icons not drawn for this long may be released under memory pressure */
+static const double IconKeepAliveSeconds = 60.0;
+
+static FAutoConsoleCommand ContentReportCommand(
+	TEXT("Crafting.ContentReport"),
+	TEXT("Prints boot time, content load time and the memory held by streamed crafting icons"),
+	FConsoleCommandDelegate::CreateLambda([]() { FCraftingContentStreamer::Get().DumpReport(); }));
+
+static FAutoConsoleCommand TrimIconsCommand(
+	TEXT("Crafting.TrimIcons"),
+	TEXT("Releases crafting icons that were not drawn recently, as if the platform reported memory pressure"),
+	FConsoleCommandDelegate::CreateLambda([]() { FCraftingContentStreamer::Get().TrimIcons(); }));
+
+FCraftingContentStreamer& FCraftingContentStreamer::Get()
+{
+	if (Instance == nullptr)
+	{
+		Instance = new FCraftingContentStreamer();
+	}
+	return *Instance;
+}
+
+void FCraftingContentStreamer::Shutdown()
+{
+	delete Instance;
+	Instance = nullptr;
+}
+
+FCraftingContentStreamer::FCraftingContentStreamer()
+	: StartSeconds(GStartTime)
+	, FirstFrameSeconds(0)
+	, LoadSeconds(0)
+	, NumRequests(0)
+{
+	MemoryTrimHandle = FCoreDelegates::GetMemoryTrimDelegate().AddLambda([this]()
+	{
+		TrimIcons();
+	});
+}
+
+FCraftingContentStreamer::~FCraftingContentStreamer()
+{
+	FCoreDelegates::GetMemoryTrimDelegate().Remove(MemoryTrimHandle);
+}
+
+void FCraftingContentStreamer::RequestAssets(TArray<FStringAssetReference>&& Assets, int32 Priority, FSimpleDelegate OnLoaded)
+{
+	// nothing to wait for if everything is in memory already
+	Assets.RemoveAll([](const FStringAssetReference& Asset) { return Asset.IsNull() || Asset.ResolveObject() != nullptr; });
+	if (Assets.Num() == 0)
+	{
+		OnLoaded.ExecuteIfBound();
+		return;
+	}
+
+	++NumRequests;
+	const double RequestSeconds = FPlatformTime::Seconds();
+	Streamable.RequestAsyncLoad(Assets, FStreamableDelegate::CreateLambda([this, RequestSeconds, OnLoaded]()
+	{
+		LoadSeconds += FPlatformTime::Seconds() - RequestSeconds;
+		OnLoaded.ExecuteIfBound();
+	}), Priority);
+}
+
+void FCraftingContentStreamer::RequestIcons(const UCraftingItemCatalog* Catalog, const TArray<UClass*>& HeldClasses)
+{
+	if (Catalog == nullptr)
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	TArray<FStringAssetReference> Held;
+	TArray<FStringAssetReference> Rest;
+	for (const FItemImages& Item : Catalog->Items)
+	{
+		const FStringAssetReference Icon = Item.GetIcon().ToStringReference();
+		if (Icon.IsNull() || IconLastUsed.Contains(Icon))
+		{
+			continue;
+		}
+		IconLastUsed.Add(Icon, Now);
+
+		const bool bIsHeld = HeldClasses.ContainsByPredicate([&Item](UClass* HeldClass) { return Item.GetClassReference() == FStringAssetReference(HeldClass); });
+		(bIsHeld ? Held : Rest).Add(Icon);
+	}
+
+	RequestAssets(MoveTemp(Held), PriorityHeld, FSimpleDelegate());
+	RequestAssets(MoveTemp(Rest), PriorityBackground, FSimpleDelegate());
+}
+
+void FCraftingContentStreamer::RequestPickupClasses(const TArray<FStringAssetReference>& Classes, int32 Priority, FSimpleDelegate OnLoaded)
+{
+	TArray<FStringAssetReference> Assets = Classes;
+	RequestAssets(MoveTemp(Assets), Priority, OnLoaded);
+}
+
+UTexture2D* FCraftingContentStreamer::GetIcon(const TAssetPtr<UTexture2D>& Icon)
+{
+	if (Icon.IsNull())
+	{
+		return nullptr;
+	}
+
+	const FStringAssetReference Reference = Icon.ToStringReference();
+	const bool bWasRequested = IconLastUsed.Contains(Reference);
+	IconLastUsed.Add(Reference, FPlatformTime::Seconds());
+
+	UTexture2D* Texture = Icon.Get();
+	if (Texture == nullptr && !bWasRequested)
+	{
+		TArray<FStringAssetReference> Assets;
+		Assets.Add(Reference);
+		RequestAssets(MoveTemp(Assets), PriorityVisible, FSimpleDelegate());
+	}
+	return Texture;
+}
+
+int32 FCraftingContentStreamer::TrimIcons()
+{
+	const double Now = FPlatformTime::Seconds();
+	int32 NumReleased = 0;
+	for (auto It = IconLastUsed.CreateIterator(); It; ++It)
+	{
+		// widgets still showing the icon hold their own reference, so releasing ours is always safe
+		if (Now - It.Value() > IconKeepAliveSeconds && It.Key().ResolveObject() != nullptr)
+		{
+			Streamable.Unload(It.Key());
+			It.RemoveCurrent();
+			++NumReleased;
+		}
+	}
+
+	UE_LOG(LogCrafting, Log, TEXT("Released %d crafting icons"), NumReleased);
+	return NumReleased;
+}
+
+void FCraftingContentStreamer::NotifyFirstFrame()
+{
+	if (FirstFrameSeconds == 0)
+	{
+		FirstFrameSeconds = FPlatformTime::Seconds();
+		UE_LOG(LogCrafting, Log, TEXT("First frame %.2f s after start"), FirstFrameSeconds - StartSeconds);
+	}
+}
+
+SIZE_T FCraftingContentStreamer::GetIconMemory(int32& OutNumIcons) const
+{
+	OutNumIcons = 0;
+	SIZE_T IconBytes = 0;
+	for (const TPair<FStringAssetReference, double>& Pair : IconLastUsed)
+	{
+		if (UTexture2D* Texture = Cast<UTexture2D>(Pair.Key.ResolveObject()))
+		{
+			++OutNumIcons;
+			IconBytes += Texture->CalcTextureMemorySizeEnum(TMC_ResidentMips);
+		}
+	}
+	return IconBytes;
+}
+
+void FCraftingContentStreamer::DumpReport() const
+{
+	int32 NumLoadedIcons = 0;
+	const SIZE_T IconBytes = GetIconMemory(NumLoadedIcons);
+
+	SIZE_T AllTextureBytes = 0;
+	for (TObjectIterator<UTexture2D> It; It; ++It)
+	{
+		AllTextureBytes += It->CalcTextureMemorySizeEnum(TMC_ResidentMips);
+	}
+
+	UE_LOG(LogCrafting, Display, TEXT("Crafting content:"));
+	UE_LOG(LogCrafting, Display, TEXT("  first frame     %.2f s after start"), FirstFrameSeconds > 0 ? FirstFrameSeconds - StartSeconds : -1.0);
+	UE_LOG(LogCrafting, Display, TEXT("  async requests  %d, %.2f s spent waiting in total"), NumRequests, LoadSeconds);
+	UE_LOG(LogCrafting, Display, TEXT("  icons           %d resident, %.1f KB"), NumLoadedIcons, IconBytes / 1024.0);
+	UE_LOG(LogCrafting, Display, TEXT("  all textures    %.1f MB resident"), AllTextureBytes / (1024.0 * 1024.0));
+}
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Engine/StreamableManager.h"
+
+class UCraftingItemCatalog;
+
+/**
+ * Streams the crafting content referenced softly by UCraftingItemCatalog.
+ *
+ * Icons are requested when an inventory opens for the first time, the ones the player holds with a higher
+ * priority than the rest of the catalog. Pickup classes are requested by whatever is about to spawn them.
+ * Icons that were not drawn for a while are released when the platform reports memory pressure.
+ */
+class FCraftingContentStreamer
+{
+public:
+	enum EPriority
+	{
+		PriorityBackground = 0,
+		PriorityVisible = 50,
+		PriorityHeld = 100
+	};
+
+	static FCraftingContentStreamer& Get();
+	static void Shutdown();
+
+	/** Streams every icon of the catalog, icons of HeldClasses first */
+	void RequestIcons(const UCraftingItemCatalog* Catalog, const TArray<UClass*>& HeldClasses);
+
+	/** Streams any assets, OnLoaded runs once all of them are in memory */
+	void RequestAssets(TArray<FStringAssetReference>&& Assets, int32 Priority, FSimpleDelegate OnLoaded);
+
+	/** Streams the pickup classes, OnLoaded runs once all of them are in memory */
+	void RequestPickupClasses(const TArray<FStringAssetReference>& Classes, int32 Priority, FSimpleDelegate OnLoaded);
+
+	/** Returns the icon if it is loaded and keeps it alive, otherwise requests it and returns null */
+	UTexture2D* GetIcon(const TAssetPtr<UTexture2D>& Icon);
+
+	/** Releases icons that were not used for IconKeepAliveSeconds, returns how many were released */
+	int32 TrimIcons();
+
+	/** Logs load timings and the memory held by the streamed icons */
+	void DumpReport() const;
+
+	/** Resident memory of the loaded icons */
+	SIZE_T GetIconMemory(int32& OutNumIcons) const;
+
+	/** Marks the first rendered frame, the report uses it as the end of the boot */
+	void NotifyFirstFrame();
+
+	FStreamableManager& GetStreamableManager() { return Streamable; }
+
+private:
+	FCraftingContentStreamer();
+	~FCraftingContentStreamer();
+
+	FStreamableManager Streamable;
+
+	/** Real time an icon was requested or drawn last */
+	TMap<FStringAssetReference, double> IconLastUsed;
+
+	double StartSeconds;
+	double FirstFrameSeconds;
+	double LoadSeconds;
+	int32 NumRequests;
+
+	FDelegateHandle MemoryTrimHandle;
+
+	static FCraftingContentStreamer* Instance;
+};
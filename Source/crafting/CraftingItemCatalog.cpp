@@ -0,0 +1,10 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingItemCatalog.h"
+
+const FItemImages* UCraftingItemCatalog::FindItem(UClass* ItemClass) const
+{
+	const FStringAssetReference ClassReference(ItemClass);
+	return Items.FindByPredicate([&ClassReference](const FItemImages& Item) { return Item.GetClassReference() == ClassReference; });
+}
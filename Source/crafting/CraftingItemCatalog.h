@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Engine/DataAsset.h"
+#include "PickupObject.h"
+#include "CraftingItemCatalog.generated.h"
+
+USTRUCT(BlueprintType)
+struct FItemImages
+{
+	GENERATED_BODY()
+
+	/** Hard references the game instance blueprint and the widgets still use, leave empty in catalog entries */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+		TSubclassOf<class APickupObject> Class;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+		UTexture2D *Texture;
+
+	/** Soft references, loading the entry loads neither the pickup nor its icon */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+		TAssetSubclassOf<class APickupObject> SoftClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+		TAssetPtr<UTexture2D> Icon;
+
+	/** The soft reference when set, the hard one otherwise */
+	FStringAssetReference GetClassReference() const { return SoftClass.IsNull() ? FStringAssetReference(Class.Get()) : SoftClass.ToStringReference(); }
+	TAssetPtr<UTexture2D> GetIcon() const { return Icon.IsNull() ? TAssetPtr<UTexture2D>(Texture) : Icon; }
+};
+
+/**
+ * Every craftable item and its icon. Only soft references are kept, so holding the catalog loads nothing,
+ * the content is streamed in through FCraftingContentStreamer when it is first needed.
+ */
+UCLASS(BlueprintType)
+class CRAFTING_API UCraftingItemCatalog : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Item")
+		TArray<FItemImages> Items;
+
+	const FItemImages* FindItem(UClass* ItemClass) const;
+};
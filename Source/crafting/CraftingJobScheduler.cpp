@@ -0,0 +1,215 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingJobScheduler.h"
+#include "CraftingStation.h"
+#include "CraftingJournal.h"
+#include "CraftingMetrics.h"
+#include "craftingCharacter.h"
+#include "HAL/RunnableThread.h"
+
+DECLARE_CYCLE_STAT(TEXT("Process Completed Crafts"), STAT_ProcessCompletedCrafts, STATGROUP_Crafting);
+
+FCraftingJobScheduler::FCraftingJobScheduler()
+	: WorldTime(0)
+	, NextFinishTime(MAX_dbl)
+{
+	WakeUp = FPlatformProcess::GetSynchEventFromPool();
+	Thread = FRunnableThread::Create(this, TEXT("CraftingJobScheduler"), 0, TPri_BelowNormal);
+}
+
+FCraftingJobScheduler::~FCraftingJobScheduler()
+{
+	if (Thread != nullptr)
+	{
+		Thread->Kill(true);
+		delete Thread;
+	}
+	FPlatformProcess::ReturnSynchEventToPool(WakeUp);
+}
+
+void FCraftingJobScheduler::Submit(const FCraftingJob& Job, double InWorldTime)
+{
+	check(IsInGameThread());
+	FCraftingJob Queued = Job;
+	Queued.SubmitTime = InWorldTime;
+	Submitted.Enqueue(Queued);
+	WakeUp->Trigger();
+}
+
+void FCraftingJobScheduler::StartNextJob(uint32 StationId, FStationQueue& Queue, double Now)
+{
+	if (Queue.Head < Queue.Jobs.Num())
+	{
+		Queue.bIsCrafting = true;
+		Running.HeapPush(FRunningJob{ Now + Queue.Jobs[Queue.Head].CraftTime, StationId });
+	}
+	else
+	{
+		Queue.bIsCrafting = false;
+		Queue.Jobs.Reset();
+		Queue.Head = 0;
+	}
+}
+
+uint32 FCraftingJobScheduler::Run()
+{
+	while (StopRequested.GetValue() == 0)
+	{
+		double Now;
+		{
+			FScopeLock Lock(&TimeLock);
+			Now = WorldTime;
+		}
+
+		FCraftingJob Job;
+		while (Submitted.Dequeue(Job))
+		{
+			FStationQueue& Queue = Stations.FindOrAdd(Job.StationId);
+			Queue.Jobs.Add(Job);
+			if (!Queue.bIsCrafting)
+			{
+				StartNextJob(Job.StationId, Queue, Job.SubmitTime);
+			}
+		}
+
+		while (Running.Num() > 0 && Running.HeapTop().FinishTime <= Now)
+		{
+			FRunningJob Finished;
+			Running.HeapPop(Finished, false);
+
+			FStationQueue& Queue = Stations.FindChecked(Finished.StationId);
+			Completed.Enqueue(Queue.Jobs[Queue.Head]);
+			++Queue.Head;
+
+			// drop the finished prefix now and then instead of shifting on every job
+			if (Queue.Head > 64 && Queue.Head * 2 > Queue.Jobs.Num())
+			{
+				Queue.Jobs.RemoveAt(0, Queue.Head, false);
+				Queue.Head = 0;
+			}
+
+			// the next job starts when this one was due, not when the worker noticed
+			StartNextJob(Finished.StationId, Queue, Finished.FinishTime);
+		}
+
+		// idle stations would otherwise accumulate forever
+		if (Running.Num() == 0 && Stations.Num() > 0)
+		{
+			Stations.Reset();
+		}
+
+		// world time only moves when the game thread hands it in, which wakes the worker once the next job is due
+		bool bIsDue;
+		{
+			FScopeLock Lock(&TimeLock);
+			NextFinishTime = Running.Num() > 0 ? Running.HeapTop().FinishTime : MAX_dbl;
+			bIsDue = NextFinishTime <= WorldTime;
+		}
+		if (!bIsDue)
+		{
+			WakeUp->Wait();
+		}
+	}
+	return 0;
+}
+
+void FCraftingJobScheduler::Stop()
+{
+	StopRequested.Increment();
+	WakeUp->Trigger();
+}
+
+int32 FCraftingJobScheduler::FinishAllJobs()
+{
+	check(IsInGameThread());
+	if (Thread != nullptr)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	// the ingredients were taken when the jobs were queued, every one of them still pays out
+	FCraftingJob Job;
+	while (Submitted.Dequeue(Job))
+	{
+		Stations.FindOrAdd(Job.StationId).Jobs.Add(Job);
+	}
+	for (TPair<uint32, FStationQueue>& Pair : Stations)
+	{
+		FStationQueue& Queue = Pair.Value;
+		for (int32 i = Queue.Head; i < Queue.Jobs.Num(); i++)
+		{
+			Completed.Enqueue(Queue.Jobs[i]);
+		}
+	}
+	Stations.Reset();
+	Running.Reset();
+
+	double Now;
+	{
+		FScopeLock Lock(&TimeLock);
+		Now = WorldTime;
+	}
+	return ProcessCompletedJobs(Now);
+}
+
+int32 FCraftingJobScheduler::ProcessCompletedJobs(double InWorldTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProcessCompletedCrafts);
+	check(IsInGameThread());
+
+	{
+		FScopeLock Lock(&TimeLock);
+		WorldTime = InWorldTime;
+		if (NextFinishTime <= WorldTime)
+		{
+			WakeUp->Trigger();
+		}
+	}
+
+	// merge everything that finished since last frame into one update per crafter
+	TMap<AcraftingCharacter*, TArray<FInventoryDelta>> Results;
+	int32 NumCompleted = 0;
+
+	FCraftingJob Job;
+	while (Completed.Dequeue(Job))
+	{
+		++NumCompleted;
+
+		if (ACraftingStation* Station = Job.Station.Get())
+		{
+			Station->OnJobFinished();
+		}
+
+		AcraftingCharacter* Crafter = Job.Crafter.Get();
+		if (Crafter == nullptr || Job.Result == nullptr)
+		{
+			continue;
+		}
+
+		TArray<FInventoryDelta>& Deltas = Results.FindOrAdd(Crafter);
+		FInventoryDelta* Existing = Deltas.FindByPredicate([&Job](const FInventoryDelta& Delta) { return Delta.Class == Job.Result; });
+		if (Existing != nullptr)
+		{
+			Existing->Number += Job.ResultNumber;
+		}
+		else
+		{
+			Deltas.Add(FInventoryDelta{ Job.Result, Job.ResultNumber });
+		}
+
+		FCraftingMetrics::Get().CountCraft();
+		if (FCraftingJournal* Journal = FCraftingJournal::Get())
+		{
+			Journal->Record(ECraftingJournalEvent::Craft, Crafter->GetJournalPlayerId(), Job.Result, Job.ResultNumber);
+		}
+	}
+
+	for (TPair<AcraftingCharacter*, TArray<FInventoryDelta>>& Pair : Results)
+	{
+		Pair.Key->AddCraftResults(Pair.Value);
+	}
+	return NumCompleted;
+}
@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "HAL/Runnable.h"
+#include "Containers/Queue.h"
+
+class ACraftingStation;
+class AcraftingCharacter;
+
+struct FCraftingJob
+{
+	/** Only carried through the worker, it never dereferences them */
+	TWeakObjectPtr<ACraftingStation> Station;
+	TWeakObjectPtr<AcraftingCharacter> Crafter;
+
+	TSubclassOf<class APickupObject> Result;
+	int32 ResultNumber;
+	uint32 StationId;
+	float CraftTime;
+
+	/** World time the job was submitted at, set by Submit */
+	double SubmitTime;
+};
+
+/**
+ * Runs the timers of all queued crafting jobs on a worker thread.
+ *
+ * Every station crafts its jobs one after another, so only the job at the head of each station queue
+ * sits in a min-heap ordered by finish time. Times are world seconds handed in by the game thread, so
+ * pause and time dilation stretch the crafts. The worker sleeps until the world reaches the earliest
+ * finish time or until new jobs arrive, no job is ever ticked. Finished jobs are handed back through a
+ * queue that the game thread drains once per frame in ProcessCompletedJobs, which applies one inventory
+ * update per crafter.
+ */
+class FCraftingJobScheduler : public FRunnable
+{
+public:
+	FCraftingJobScheduler();
+	virtual ~FCraftingJobScheduler();
+
+	/** Game thread only */
+	void Submit(const FCraftingJob& Job, double InWorldTime);
+
+	/** Game thread only, returns the number of jobs that finished by InWorldTime since the last call */
+	int32 ProcessCompletedJobs(double InWorldTime);
+
+	/** Game thread only, stops the worker and hands out the results of every job still queued or running, returns their number */
+	int32 FinishAllJobs();
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	struct FStationQueue
+	{
+		TArray<FCraftingJob> Jobs;
+		int32 Head = 0;
+		bool bIsCrafting = false;
+	};
+
+	struct FRunningJob
+	{
+		double FinishTime;
+		uint32 StationId;
+
+		bool operator<(const FRunningJob& Other) const { return FinishTime < Other.FinishTime; }
+	};
+
+	void StartNextJob(uint32 StationId, FStationQueue& Queue, double Now);
+
+	// worker thread state
+	TMap<uint32, FStationQueue> Stations;
+	TArray<FRunningJob> Running;
+
+	TQueue<FCraftingJob, EQueueMode::Spsc> Submitted;
+	TQueue<FCraftingJob, EQueueMode::Spsc> Completed;
+
+	FEvent* WakeUp;
+	FRunnableThread* Thread;
+	FThreadSafeCounter StopRequested;
+
+	/** The world time last handed in and the earliest finish time the worker waits for, guarded by TimeLock */
+	FCriticalSection TimeLock;
+	double WorldTime;
+	double NextFinishTime;
+};
@@ -0,0 +1,237 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingJournal.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+
+FCraftingJournal* FCraftingJournal::Instance = nullptr;
+
+/** How long the writer sleeps between batches when the ring is not filling up */
+static const uint32 JournalFlushIntervalMs = 100;
+
+FCraftingJournal* FCraftingJournal::Get()
+{
+	static bool bDisabled = FParse::Param(FCommandLine::Get(), TEXT("NoCraftingJournal"));
+	if (Instance == nullptr && !bDisabled)
+	{
+		check(IsInGameThread());
+		const FString Name = FString::Printf(TEXT("crafting-%s.cjl"), *FDateTime::Now().ToString());
+		Instance = new FCraftingJournal(FPaths::GameSavedDir() / TEXT("Journal") / Name);
+	}
+	return Instance;
+}
+
+void FCraftingJournal::Shutdown()
+{
+	if (Instance != nullptr)
+	{
+		delete Instance;
+		Instance = nullptr;
+	}
+}
+
+FCraftingJournal::FCraftingJournal(const FString& InFilename)
+	: Head(0)
+	, Tail(0)
+	, NumDropped(0)
+	, bWakeUpSignalled(false)
+	, StartSeconds(FPlatformTime::Seconds())
+	, Filename(InFilename)
+	, File(nullptr)
+	, Thread(nullptr)
+{
+	Ring = (FCraftingJournalRecord*)FMemory::Malloc(RingSize * sizeof(FCraftingJournalRecord), PLATFORM_CACHE_LINE_SIZE);
+	WakeUp = FPlatformProcess::GetSynchEventFromPool();
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Filename));
+	File = PlatformFile.OpenWrite(*Filename);
+	if (File == nullptr)
+	{
+		UE_LOG(LogCrafting, Warning, TEXT("Could not open crafting journal '%s', events will be discarded"), *Filename);
+	}
+	else
+	{
+		TArray<uint8> Header;
+		FMemoryWriter Writer(Header);
+		uint32 FileMagic = Magic;
+		uint16 FileVersion = Version;
+		uint16 RecordSize = sizeof(FCraftingJournalRecord);
+		FDateTime StartTime = FDateTime::UtcNow();
+		Writer << FileMagic << FileVersion << RecordSize << StartTime;
+		File->Write(Header.GetData(), Header.Num());
+	}
+
+	Thread = FRunnableThread::Create(this, TEXT("CraftingJournal"), 0, TPri_BelowNormal);
+}
+
+FCraftingJournal::~FCraftingJournal()
+{
+	if (Thread != nullptr)
+	{
+		Thread->Kill(true);
+		delete Thread;
+	}
+
+	delete File;
+	FPlatformProcess::ReturnSynchEventToPool(WakeUp);
+	FMemory::Free(Ring);
+}
+
+uint16 FCraftingJournal::GetItemId(UClass* ItemClass)
+{
+	if (ItemClass == nullptr)
+	{
+		return 0;
+	}
+
+	uint16* Id = ItemIds.Find(ItemClass);
+	if (Id != nullptr)
+	{
+		return *Id;
+	}
+
+	if (ItemIds.Num() >= MAX_uint16)
+	{
+		return 0;
+	}
+
+	// the name is queued before the record using it is published, so the writer always sees it first
+	uint16 NewId = ItemIds.Num() + 1;
+	ItemIds.Add(ItemClass, NewId);
+	PendingNames.Enqueue(TPairInitializer<uint16, FString>(NewId, ItemClass->GetPathName()));
+	return NewId;
+}
+
+void FCraftingJournal::Record(ECraftingJournalEvent Type, uint32 PlayerId, UClass* ItemClass, int32 Value)
+{
+	checkSlow(IsInGameThread());
+
+	const uint64 Microseconds = (uint64)((FPlatformTime::Seconds() - StartSeconds) * 1000000.0);
+	uint32 CurrentHead = Head;
+	const uint32 CurrentTail = Tail;
+
+	// acquire, the slots the writer released must not be overwritten before its Tail update is seen
+	FPlatformMisc::MemoryBarrier();
+	const uint32 Used = CurrentHead - CurrentTail;
+	if (Used < FlushThreshold)
+	{
+		bWakeUpSignalled = false;
+	}
+
+	// keep one slot for the Dropped record so the gap is visible in the journal
+	if (Used >= RingSize - 1 || (NumDropped > 0 && Used >= RingSize - 2))
+	{
+		++NumDropped;
+		return;
+	}
+
+	if (NumDropped > 0)
+	{
+		FCraftingJournalRecord& Dropped = Ring[CurrentHead & RingMask];
+		FMemory::Memzero(Dropped);
+		Dropped.Microseconds = Microseconds;
+		Dropped.Type = ECraftingJournalEvent::Dropped;
+		Dropped.Value = NumDropped;
+		++CurrentHead;
+		NumDropped = 0;
+	}
+
+	FCraftingJournalRecord& Entry = Ring[CurrentHead & RingMask];
+	Entry.Microseconds = Microseconds;
+	Entry.PlayerId = PlayerId;
+	Entry.Value = Value;
+	Entry.ItemId = GetItemId(ItemClass);
+	Entry.Type = Type;
+	FMemory::Memzero(Entry.Reserved);
+	++CurrentHead;
+
+	// publish the records only after they are fully written
+	FPlatformMisc::MemoryBarrier();
+	Head = CurrentHead;
+
+	// a Dropped record can step over the threshold, so compare with >= and signal once per fill
+	if (!bWakeUpSignalled && CurrentHead - CurrentTail >= FlushThreshold)
+	{
+		bWakeUpSignalled = true;
+		WakeUp->Trigger();
+	}
+}
+
+void FCraftingJournal::Flush()
+{
+	WakeUp->Trigger();
+}
+
+int32 FCraftingJournal::Drain(TArray<uint8>& Batch)
+{
+	Batch.Reset();
+	FMemoryWriter Writer(Batch);
+
+	// read head before the names, every record up to it had its name queued already
+	const uint32 CurrentHead = Head;
+	const uint32 CurrentTail = Tail;
+	FPlatformMisc::MemoryBarrier();
+
+	TPair<uint16, FString> Name;
+	while (PendingNames.Dequeue(Name))
+	{
+		uint8 Chunk = ChunkClassName;
+		Writer << Chunk << Name.Key << Name.Value;
+	}
+
+	uint32 Count = CurrentHead - CurrentTail;
+	if (Count > 0)
+	{
+		uint8 Chunk = ChunkRecords;
+		Writer << Chunk << Count;
+
+		// the ring may wrap, copy it out in at most two runs
+		const uint32 First = CurrentTail & RingMask;
+		const uint32 FirstRun = FMath::Min(Count, RingSize - First);
+		Writer.Serialize(Ring + First, FirstRun * sizeof(FCraftingJournalRecord));
+		Writer.Serialize(Ring, (Count - FirstRun) * sizeof(FCraftingJournalRecord));
+
+		FPlatformMisc::MemoryBarrier();
+		Tail = CurrentHead;
+	}
+
+	return Batch.Num();
+}
+
+void FCraftingJournal::WriteBatch(TArray<uint8>& Batch)
+{
+	if (File != nullptr && Batch.Num() > 0)
+	{
+		File->Write(Batch.GetData(), Batch.Num());
+	}
+}
+
+uint32 FCraftingJournal::Run()
+{
+	TArray<uint8> Batch;
+	while (StopRequested.GetValue() == 0)
+	{
+		WakeUp->Wait(JournalFlushIntervalMs);
+		if (Drain(Batch) > 0)
+		{
+			WriteBatch(Batch);
+		}
+	}
+
+	// whatever was recorded before the stop request still goes to disk
+	if (Drain(Batch) > 0)
+	{
+		WriteBatch(Batch);
+	}
+	return 0;
+}
+
+void FCraftingJournal::Stop()
+{
+	StopRequested.Increment();
+	WakeUp->Trigger();
+}
@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "HAL/Runnable.h"
+#include "Containers/Queue.h"
+
+enum class ECraftingJournalEvent : uint8
+{
+	Pickup,
+	Craft,
+	ItemChanged,
+	Dropped
+};
+
+/**
+ * Fixed size record, Microseconds are counted from the start of the journal. Value is the new stack size for ItemChanged,
+ * the crafted amount for Craft and the lost record count for Dropped. PlayerId is stable across sessions, see GetStableId.
+ */
+struct FCraftingJournalRecord
+{
+	uint64 Microseconds;
+	uint32 PlayerId;
+	int32 Value;
+	uint16 ItemId;
+	ECraftingJournalEvent Type;
+	uint8 Reserved[5];
+};
+static_assert(sizeof(FCraftingJournalRecord) == 24, "Journal records are part of the file format");
+
+/**
+ * Append-only binary journal of pickups, crafts and inventory changes.
+ *
+ * Record() is called on the game thread and only copies the record into a single producer single consumer
+ * ring buffer. A writer thread drains the ring in batches and appends them to Saved/Journal. Item classes are
+ * written once as a name table chunk the first time they show up, records only carry the 16 bit id.
+ * When the writer falls behind records are dropped and a Dropped record with the lost count is written instead.
+ */
+class FCraftingJournal : public FRunnable
+{
+public:
+	static const uint32 Magic = 0x4C4A4343; // 'CCJL'
+	static const uint16 Version = 1;
+
+	enum EChunk : uint8
+	{
+		ChunkClassName = 0,
+		ChunkRecords = 1
+	};
+
+	/** Returns the running journal, or null when it is disabled with -NoCraftingJournal */
+	static FCraftingJournal* Get();
+	static void Shutdown();
+
+	void Record(ECraftingJournalEvent Type, uint32 PlayerId, UClass* ItemClass, int32 Value);
+
+	/** Id of a player or container that stays the same across sessions, unlike GetUniqueID: a hash of its stable name */
+	static uint32 GetStableId(const FString& StableName) { return FCrc::StrCrc32(*StableName); }
+
+	const FString& GetFilename() const { return Filename; }
+
+	/** Wakes the writer thread if it is sleeping, used before reading the file back */
+	void Flush();
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	explicit FCraftingJournal(const FString& InFilename);
+	virtual ~FCraftingJournal();
+
+	uint16 GetItemId(UClass* ItemClass);
+	int32 Drain(TArray<uint8>& Batch);
+	void WriteBatch(TArray<uint8>& Batch);
+
+	static const uint32 RingSize = 1 << 16;
+	static const uint32 RingMask = RingSize - 1;
+
+	/** Flush once this many records are waiting, otherwise the writer wakes up on its interval */
+	static const uint32 FlushThreshold = RingSize / 4;
+
+	FCraftingJournalRecord* Ring;
+	volatile uint32 Head; // written by the game thread only
+	volatile uint32 Tail; // written by the writer thread only
+	uint32 NumDropped;
+
+	/** Set once the writer was woken for the current fill of the ring, game thread only */
+	bool bWakeUpSignalled;
+
+	// game thread side of the class id table
+	TMap<UClass*, uint16> ItemIds;
+
+	// class names waiting to be written before the records that use them
+	TQueue<TPair<uint16, FString>, EQueueMode::Spsc> PendingNames;
+
+	double StartSeconds;
+	FString Filename;
+	IFileHandle* File;
+	FEvent* WakeUp;
+	FRunnableThread* Thread;
+	FThreadSafeCounter StopRequested;
+
+	static FCraftingJournal* Instance;
+};
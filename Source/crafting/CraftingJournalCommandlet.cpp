@@ -0,0 +1,178 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingJournalCommandlet.h"
+#include "CraftingJournal.h"
+#include "PickupCommon.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+
+static const TCHAR* JournalEventNames[] = { TEXT("Pickup"), TEXT("Craft"), TEXT("ItemChanged"), TEXT("Dropped") };
+
+UCraftingJournalCommandlet::UCraftingJournalCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UCraftingJournalCommandlet::Main(const FString& Params)
+{
+	FString JournalPath;
+	FString CsvPath;
+	int32 NumEvents = 0;
+
+	if (FParse::Value(*Params, TEXT("Bench="), NumEvents) && NumEvents > 0)
+	{
+		return Benchmark(NumEvents);
+	}
+	if (FParse::Value(*Params, TEXT("Journal="), JournalPath))
+	{
+		FParse::Value(*Params, TEXT("Csv="), CsvPath);
+		return Decode(JournalPath, CsvPath);
+	}
+
+	UE_LOG(LogCrafting, Error, TEXT("Usage: -run=CraftingJournal -Journal=<file.cjl> [-Csv=<out.csv>] | -Bench=<count>"));
+	return 1;
+}
+
+int32 UCraftingJournalCommandlet::Decode(const FString& JournalPath, const FString& CsvPath)
+{
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *JournalPath))
+	{
+		UE_LOG(LogCrafting, Error, TEXT("Could not read journal '%s'"), *JournalPath);
+		return 1;
+	}
+
+	FMemoryReader Reader(FileData);
+	uint32 FileMagic = 0;
+	uint16 FileVersion = 0;
+	uint16 RecordSize = 0;
+	FDateTime StartTime;
+	Reader << FileMagic << FileVersion << RecordSize << StartTime;
+	if (Reader.IsError() || FileMagic != FCraftingJournal::Magic || FileVersion > FCraftingJournal::Version || RecordSize != sizeof(FCraftingJournalRecord))
+	{
+		UE_LOG(LogCrafting, Error, TEXT("'%s' is not a crafting journal this build can read"), *JournalPath);
+		return 1;
+	}
+
+	TMap<uint16, FString> ItemNames;
+	int64 EventCounts[ARRAY_COUNT(JournalEventNames)] = { 0 };
+	int64 NumLost = 0;
+	uint64 LastMicroseconds = 0;
+
+	FString Csv;
+	const bool bWriteCsv = !CsvPath.IsEmpty();
+	if (bWriteCsv)
+	{
+		Csv = TEXT("Seconds,Event,Player,Item,Value\n");
+	}
+
+	while (!Reader.AtEnd() && !Reader.IsError())
+	{
+		uint8 Chunk = 0;
+		Reader << Chunk;
+
+		if (Chunk == FCraftingJournal::ChunkClassName)
+		{
+			uint16 Id = 0;
+			FString Name;
+			Reader << Id << Name;
+			ItemNames.Add(Id, Name);
+		}
+		else if (Chunk == FCraftingJournal::ChunkRecords)
+		{
+			uint32 Count = 0;
+			Reader << Count;
+			if ((int64)Count * RecordSize > Reader.TotalSize() - Reader.Tell())
+			{
+				UE_LOG(LogCrafting, Warning, TEXT("Journal is truncated, the last batch is incomplete"));
+				break;
+			}
+
+			for (uint32 i = 0; i < Count; i++)
+			{
+				FCraftingJournalRecord Record;
+				Reader.Serialize(&Record, sizeof(Record));
+
+				const uint8 Type = (uint8)Record.Type;
+				if (Type >= ARRAY_COUNT(JournalEventNames))
+				{
+					continue;
+				}
+				++EventCounts[Type];
+				LastMicroseconds = Record.Microseconds;
+				if (Record.Type == ECraftingJournalEvent::Dropped)
+				{
+					NumLost += Record.Value;
+				}
+
+				if (bWriteCsv)
+				{
+					const FString* ItemName = ItemNames.Find(Record.ItemId);
+					Csv += FString::Printf(TEXT("%.6f,%s,%u,%s,%d\n"), Record.Microseconds / 1000000.0, JournalEventNames[Type],
+						Record.PlayerId, ItemName != nullptr ? **ItemName : TEXT(""), Record.Value);
+				}
+			}
+		}
+		else
+		{
+			UE_LOG(LogCrafting, Warning, TEXT("Unknown chunk %d, stopping"), Chunk);
+			break;
+		}
+	}
+
+	UE_LOG(LogCrafting, Display, TEXT("Journal started %s, spans %.1f s, %d item classes"), *StartTime.ToString(), LastMicroseconds / 1000000.0, ItemNames.Num());
+	for (int32 i = 0; i < ARRAY_COUNT(JournalEventNames); i++)
+	{
+		UE_LOG(LogCrafting, Display, TEXT("  %-12s %lld"), JournalEventNames[i], EventCounts[i]);
+	}
+	if (NumLost > 0)
+	{
+		UE_LOG(LogCrafting, Warning, TEXT("  %lld records were dropped because the writer fell behind"), NumLost);
+	}
+
+	if (bWriteCsv && !FFileHelper::SaveStringToFile(Csv, *CsvPath))
+	{
+		UE_LOG(LogCrafting, Error, TEXT("Could not write '%s'"), *CsvPath);
+		return 1;
+	}
+	return 0;
+}
+
+int32 UCraftingJournalCommandlet::Benchmark(int32 NumEvents)
+{
+	FCraftingJournal* Journal = FCraftingJournal::Get();
+	if (Journal == nullptr)
+	{
+		UE_LOG(LogCrafting, Error, TEXT("The journal is disabled on the command line"));
+		return 1;
+	}
+
+	// record in bursts that fit in the ring, letting the writer catch up in between like it would across frames
+	const int32 Burst = 4096;
+	UClass* ItemClass = APickupCommon::StaticClass();
+	double RecordingSeconds = 0;
+
+	for (int32 Done = 0; Done < NumEvents; Done += Burst)
+	{
+		const int32 Count = FMath::Min(Burst, NumEvents - Done);
+		const double Start = FPlatformTime::Seconds();
+		for (int32 i = 0; i < Count; i++)
+		{
+			Journal->Record(ECraftingJournalEvent::ItemChanged, 1, ItemClass, i);
+		}
+		RecordingSeconds += FPlatformTime::Seconds() - Start;
+
+		Journal->Flush();
+		FPlatformProcess::Sleep(0.005f);
+	}
+
+	const double NanosecondsPerEvent = RecordingSeconds * 1000000000.0 / NumEvents;
+	UE_LOG(LogCrafting, Display, TEXT("Recorded %d events, %.1f ns per event, journal '%s'"), NumEvents, NanosecondsPerEvent, *Journal->GetFilename());
+
+	FCraftingJournal::Shutdown();
+	return NanosecondsPerEvent < 1000.0 ? 0 : 1;
+}
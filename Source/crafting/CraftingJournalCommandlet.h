@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "CraftingJournalCommandlet.generated.h"
+
+/**
+ * Offline reader for the crafting journal.
+ *
+ *   -run=CraftingJournal -Journal=<file.cjl> [-Csv=<out.csv>]   decodes a journal, prints a summary and optionally dumps every record
+ *   -run=CraftingJournal -Bench=<count>                         records count events and reports the recording cost per event
+ */
+UCLASS()
+class UCraftingJournalCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UCraftingJournalCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	int32 Decode(const FString& JournalPath, const FString& CsvPath);
+	int32 Benchmark(int32 NumEvents);
+};
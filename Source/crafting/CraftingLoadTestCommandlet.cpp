@@ -0,0 +1,1234 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingLoadTestCommandlet.h"
+#include "CraftingRecipe.h"
+#include "CraftingRecipeMatcher.h"
+#include "CraftabilityKernel.h"
+#include "craftingCharacter.h"
+#include "PickupCommon.h"
+#include "PickupRare.h"
+#include "PickupRelevancyGrid.h"
+#include "PickupMagnet.h"
+#include "CraftingMetrics.h"
+#include "CraftingMemory.h"
+#include "GridInventory.h"
+#include "craftingProjectile.h"
+#include "Engine/ObjectLibrary.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/MemoryBase.h"
+
+/** Raw timings of one kind of operation, kept unaggregated so any percentile can be reported */
+struct FOperationTimings
+{
+	explicit FOperationTimings(const TCHAR* InName)
+		: Name(InName)
+	{
+	}
+
+	FORCEINLINE void Add(uint32 StartCycles)
+	{
+		const uint32 Elapsed = FPlatformTime::Cycles() - StartCycles;
+		Cycles.Add(Elapsed);
+		TotalCycles += Elapsed;
+	}
+
+	void Report(FString& Csv) const
+	{
+		if (Cycles.Num() == 0)
+		{
+			UE_LOG(LogCrafting, Display, TEXT("  %-16s no samples"), *Name);
+			return;
+		}
+
+		TArray<uint32> Sorted = Cycles;
+		Sorted.Sort();
+
+		uint64 TotalCycles = 0;
+		for (uint32 Sample : Sorted)
+		{
+			TotalCycles += Sample;
+		}
+
+		auto Microseconds = [&Sorted](double Percentile)
+		{
+			const int32 Index = FMath::Min(Sorted.Num() - 1, (int32)(Percentile * Sorted.Num()));
+			return FPlatformTime::ToMilliseconds(Sorted[Index]) * 1000.0;
+		};
+
+		const double BusySeconds = TotalCycles * FPlatformTime::GetSecondsPerCycle();
+		const double OpsPerSecond = BusySeconds > 0 ? Sorted.Num() / BusySeconds : 0;
+
+		UE_LOG(LogCrafting, Display, TEXT("  %-16s %10d ops %12.0f ops/s  p50 %8.3f us  p99 %8.3f us  p99.9 %8.3f us  max %8.3f us"),
+			*Name, Sorted.Num(), OpsPerSecond, Microseconds(0.5), Microseconds(0.99), Microseconds(0.999), Microseconds(1.0));
+		Csv += FString::Printf(TEXT("%s,%d,%.0f,%.3f,%.3f,%.3f,%.3f\n"),
+			*Name, Sorted.Num(), OpsPerSecond, Microseconds(0.5), Microseconds(0.99), Microseconds(0.999), Microseconds(1.0));
+	}
+
+	FString Name;
+	TArray<uint32> Cycles;
+
+	/** Cycles of every operation timed since the suite reset it, loading and world setup are not part of it */
+	static uint64 TotalCycles;
+};
+
+uint64 FOperationTimings::TotalCycles = 0;
+
+/**
+ * Forwards to the allocator it was put in front of and counts the allocations made on the game thread.
+ * Installed into GMalloc for the suite and taken out again after it. The instance itself is never deleted,
+ * other threads may still be inside a call when GMalloc is restored.
+ */
+class FCountingMalloc : public FMalloc
+{
+public:
+	explicit FCountingMalloc(FMalloc* InInner)
+		: Inner(InInner)
+		, NumAllocations(0)
+		, bCounting(false)
+	{
+	}
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return Inner->Malloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		if (Count > 0)
+		{
+			CountAllocation();
+		}
+		return Inner->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override { Inner->Free(Original); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+	virtual void Trim() override { Inner->Trim(); }
+	virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual void UpdateStats() override { Inner->UpdateStats(); }
+	virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+	virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+	virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+	virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+	virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+	static FCountingMalloc& Install()
+	{
+		static FCountingMalloc* Instance = nullptr;
+		if (Instance == nullptr)
+		{
+			Instance = new FCountingMalloc(GMalloc);
+		}
+		if (GMalloc == Instance->Inner)
+		{
+			GMalloc = Instance;
+		}
+		return *Instance;
+	}
+
+	void Uninstall()
+	{
+		bCounting = false;
+		if (GMalloc == this)
+		{
+			GMalloc = Inner;
+		}
+	}
+
+	void Start()
+	{
+		NumAllocations = 0;
+		bCounting = true;
+	}
+
+	int64 Stop()
+	{
+		bCounting = false;
+		return NumAllocations;
+	}
+
+private:
+	FORCEINLINE void CountAllocation()
+	{
+		// only the game thread writes the counter, workers and the render thread are not part of the budget
+		if (bCounting && IsInGameThread())
+		{
+			++NumAllocations;
+		}
+	}
+
+	FMalloc* Inner;
+	int64 NumAllocations;
+	volatile bool bCounting;
+};
+
+UCraftingLoadTestCommandlet::UCraftingLoadTestCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+
+	RecipeBook = nullptr;
+}
+
+int32 UCraftingLoadTestCommandlet::Main(const FString& Params)
+{
+	FString Scenario = TEXT("Crafters");
+	FParse::Value(*Params, TEXT("Scenario="), Scenario);
+
+	Report = TEXT("Operation,Count,OpsPerSecond,P50us,P99us,P999us,MaxUs\n");
+
+	const bool bSuccess = Scenario == TEXT("Suite") ? RunSuite(Params) : RunScenario(Scenario, Params);
+
+	FString ReportPath;
+	if (FParse::Value(*Params, TEXT("Report="), ReportPath) && !FFileHelper::SaveStringToFile(Report, *ReportPath))
+	{
+		UE_LOG(LogCrafting, Error, TEXT("Could not write '%s'"), *ReportPath);
+		return 1;
+	}
+	return bSuccess ? 0 : 1;
+}
+
+bool UCraftingLoadTestCommandlet::RunScenario(const FString& Scenario, const FString& Params)
+{
+	if (Scenario == TEXT("Crafters"))
+	{
+		return RunCrafters(Params);
+	}
+	else if (Scenario == TEXT("Wildcards"))
+	{
+		return RunWildcards(Params);
+	}
+	else if (Scenario == TEXT("Craftability"))
+	{
+		return RunCraftability(Params);
+	}
+	else if (Scenario == TEXT("Relevancy"))
+	{
+		return RunRelevancy(Params);
+	}
+	else if (Scenario == TEXT("Grid"))
+	{
+		return RunGrid(Params);
+	}
+	else if (Scenario == TEXT("Magnet"))
+	{
+		return RunMagnet(Params);
+	}
+	else if (Scenario == TEXT("Projectiles"))
+	{
+		return RunProjectiles(Params);
+	}
+
+	UE_LOG(LogCrafting, Error, TEXT("Unknown scenario '%s'"), *Scenario);
+	return false;
+}
+
+void UCraftingLoadTestCommandlet::LoadPickupClasses(const FString& Params)
+{
+	FString PickupPath = TEXT("/Game/FirstPersonCPP/Blueprints/Pickups");
+	FParse::Value(*Params, TEXT("PickupPath="), PickupPath);
+
+	UObjectLibrary* Library = UObjectLibrary::CreateLibrary(APickupObject::StaticClass(), true, GIsEditor);
+	Library->LoadBlueprintsFromPath(PickupPath);
+
+	TArray<UBlueprintGeneratedClass*> Classes;
+	Library->GetObjects<UBlueprintGeneratedClass>(Classes);
+	PickupClasses.Reset();
+	for (UBlueprintGeneratedClass* Class : Classes)
+	{
+		if (!Class->HasAnyClassFlags(CLASS_Abstract))
+		{
+			PickupClasses.Add(Class);
+		}
+	}
+
+	if (PickupClasses.Num() == 0)
+	{
+		UE_LOG(LogCrafting, Warning, TEXT("No pickup blueprints under '%s', using the native pickup classes"), *PickupPath);
+		PickupClasses.Add(APickupCommon::StaticClass());
+		PickupClasses.Add(APickupRare::StaticClass());
+	}
+}
+
+void UCraftingLoadTestCommandlet::LoadRecipes(const FString& Params, FRandomStream& Random)
+{
+	FString RecipesPath;
+	if (FParse::Value(*Params, TEXT("Recipes="), RecipesPath))
+	{
+		RecipeBook = LoadObject<UCraftingRecipeBook>(nullptr, *RecipesPath);
+		if (RecipeBook != nullptr)
+		{
+			return;
+		}
+		UE_LOG(LogCrafting, Warning, TEXT("Could not load recipe book '%s', generating recipes"), *RecipesPath);
+	}
+
+	int32 NumRecipes = 64;
+	FParse::Value(*Params, TEXT("NumRecipes="), NumRecipes);
+
+	RecipeBook = NewObject<UCraftingRecipeBook>(GetTransientPackage());
+	for (int32 i = 0; i < NumRecipes; i++)
+	{
+		FCraftingRecipe& Recipe = RecipeBook->Recipes[RecipeBook->Recipes.AddDefaulted()];
+		const int32 NumIngredients = Random.RandRange(1, 3);
+		for (int32 j = 0; j < NumIngredients; j++)
+		{
+			FRecipeIngredient Ingredient;
+			Ingredient.Class = PickupClasses[Random.RandHelper(PickupClasses.Num())];
+			Ingredient.Number = Random.RandRange(1, 3);
+			Recipe.Ingredients.Add(Ingredient);
+		}
+		Recipe.Result = PickupClasses[Random.RandHelper(PickupClasses.Num())];
+	}
+}
+
+bool UCraftingLoadTestCommandlet::RunCrafters(const FString& Params)
+{
+	int32 NumPlayers = 1000;
+	float SimulatedSeconds = 60.0f;
+	float PickupRate = 2.0f;
+	float DropRate = 0.5f;
+	float CraftRate = 0.5f;
+	int32 Seed = 1;
+	FParse::Value(*Params, TEXT("Players="), NumPlayers);
+	FParse::Value(*Params, TEXT("Seconds="), SimulatedSeconds);
+	FParse::Value(*Params, TEXT("PickupRate="), PickupRate);
+	FParse::Value(*Params, TEXT("DropRate="), DropRate);
+	FParse::Value(*Params, TEXT("CraftRate="), CraftRate);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+
+	FRandomStream Random(Seed);
+	LoadPickupClasses(Params);
+	LoadRecipes(Params, Random);
+	if (RecipeBook->Recipes.Num() == 0)
+	{
+		UE_LOG(LogCrafting, Error, TEXT("No recipes to craft"));
+		return false;
+	}
+
+	// a bare game world, the virtual players never get a controller, a viewport or BeginPlay
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	const uint64 StartMemory = FPlatformMemory::GetStats().UsedPhysical;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	TArray<AcraftingCharacter*> Players;
+	FOperationTimings SpawnTimings(TEXT("Spawn"));
+	for (int32 i = 0; i < NumPlayers; i++)
+	{
+		const uint32 Start = FPlatformTime::Cycles();
+		Players.Add(World->SpawnActor<AcraftingCharacter>(AcraftingCharacter::StaticClass(), FVector(i * 200.0f, 0, 0), FRotator::ZeroRotator, SpawnParams));
+		SpawnTimings.Add(Start);
+	}
+	const uint64 SpawnedMemory = FPlatformMemory::GetStats().UsedPhysical;
+
+	FOperationTimings PickupTimings(TEXT("Pickup"));
+	FOperationTimings DropTimings(TEXT("Drop"));
+	FOperationTimings CraftTimings(TEXT("Craft"));
+	int32 NumCrafted = 0;
+
+	const float DeltaSeconds = 1.0f / 30.0f;
+	const int32 NumFrames = FMath::CeilToInt(SimulatedSeconds / DeltaSeconds);
+	const double StartSeconds = FPlatformTime::Seconds();
+
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		for (AcraftingCharacter* Player : Players)
+		{
+			// expected rate per frame, rounded randomly so fractional rates average out
+			const int32 NumPickups = FMath::FloorToInt(PickupRate * DeltaSeconds + Random.FRand());
+			for (int32 i = 0; i < NumPickups; i++)
+			{
+				APickupObject* Pickup = PickupClasses[Random.RandHelper(PickupClasses.Num())]->GetDefaultObject<APickupObject>();
+				const uint32 Start = FPlatformTime::Cycles();
+				Player->IncreaseItemNumber(Pickup);
+				PickupTimings.Add(Start);
+			}
+
+			const int32 NumDrops = FMath::FloorToInt(DropRate * DeltaSeconds + Random.FRand());
+			for (int32 i = 0; i < NumDrops; i++)
+			{
+				APickupObject* Pickup = PickupClasses[Random.RandHelper(PickupClasses.Num())]->GetDefaultObject<APickupObject>();
+				const uint32 Start = FPlatformTime::Cycles();
+				Player->DecreaseItemNumber(Pickup);
+				DropTimings.Add(Start);
+			}
+
+			const int32 NumCrafts = FMath::FloorToInt(CraftRate * DeltaSeconds + Random.FRand());
+			for (int32 i = 0; i < NumCrafts; i++)
+			{
+				const FCraftingRecipe& Recipe = RecipeBook->Recipes[Random.RandHelper(RecipeBook->Recipes.Num())];
+				const uint32 Start = FPlatformTime::Cycles();
+				TArray<FInventoryDelta> Deltas;
+				if (FRecipeMatcher::Match(Recipe, Player->GetCurrentItems(), 1, &Deltas))
+				{
+					Deltas.Add(FInventoryDelta{ Recipe.Result, Recipe.ResultNumber });
+					Player->ApplyInventoryDeltas(Deltas);
+					++NumCrafted;
+				}
+				CraftTimings.Add(Start);
+			}
+		}
+	}
+
+	const double WallSeconds = FPlatformTime::Seconds() - StartSeconds;
+	const uint64 EndMemory = FPlatformMemory::GetStats().UsedPhysical;
+
+	SIZE_T InventoryBytes = 0;
+	int32 NumStacks = 0;
+	for (AcraftingCharacter* Player : Players)
+	{
+		InventoryBytes += FCraftingMemory::GetItemsAllocatedSize(Player->GetCurrentItems());
+		NumStacks += Player->GetCurrentItems().Num();
+	}
+
+	UE_LOG(LogCrafting, Display, TEXT("Crafters: %d players, %d pickup classes, %d recipes, %.0f simulated s in %.2f s wall"),
+		NumPlayers, PickupClasses.Num(), RecipeBook->Recipes.Num(), SimulatedSeconds, WallSeconds);
+	SpawnTimings.Report(Report);
+	PickupTimings.Report(Report);
+	DropTimings.Report(Report);
+	CraftTimings.Report(Report);
+	UE_LOG(LogCrafting, Display, TEXT("  %d of %d craft attempts succeeded"), NumCrafted, CraftTimings.Cycles.Num());
+	UE_LOG(LogCrafting, Display, TEXT("  memory: spawn +%.1f MB, simulation +%.1f MB, inventories %.1f KB in %d stacks"),
+		(int64)(SpawnedMemory - StartMemory) / (1024.0 * 1024.0), (int64)(EndMemory - SpawnedMemory) / (1024.0 * 1024.0), InventoryBytes / 1024.0, NumStacks);
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return true;
+}
+
+bool UCraftingLoadTestCommandlet::RunWildcards(const FString& Params)
+{
+	int32 NumStacks = 1000;
+	int32 MaxSlots = 9;
+	int32 Iterations = 200;
+	int32 Seed = 1;
+	FParse::Value(*Params, TEXT("Stacks="), NumStacks);
+	FParse::Value(*Params, TEXT("MaxSlots="), MaxSlots);
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+
+	FRandomStream Random(Seed);
+	LoadPickupClasses(Params);
+
+	// a large synthetic inventory, the matcher treats every stack on its own so classes may repeat
+	TArray<FPickupItem> Items;
+	for (int32 i = 0; i < NumStacks; i++)
+	{
+		Items.Add(AcraftingCharacter::MakePickupItem(PickupClasses[Random.RandHelper(PickupClasses.Num())], Random.RandRange(1, 20)));
+	}
+
+	UE_LOG(LogCrafting, Display, TEXT("Wildcards: %d stacks, %d pickup classes, %d iterations per recipe size"), NumStacks, PickupClasses.Num(), Iterations);
+	for (int32 NumSlots = 1; NumSlots <= MaxSlots; NumSlots++)
+	{
+		FOperationTimings MatchTimings(*FString::Printf(TEXT("Match %d slots"), NumSlots));
+		FOperationTimings MaxCountTimings(*FString::Printf(TEXT("MaxCount %d slots"), NumSlots));
+		int32 NumMatched = 0;
+
+		for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			FCraftingRecipe Recipe;
+			for (int32 Slot = 0; Slot < NumSlots; Slot++)
+			{
+				FRecipeIngredient Ingredient;
+				Ingredient.Match = Random.FRand() < 0.7f ? EIngredientMatch::Category : EIngredientMatch::AnyCommon;
+				Ingredient.Category = (ECommonType)Random.RandHelper((int32)ECommonType::Count);
+				Ingredient.Number = Random.RandRange(1, 4);
+				Recipe.Ingredients.Add(Ingredient);
+			}
+
+			TArray<FInventoryDelta> Consumed;
+			uint32 Start = FPlatformTime::Cycles();
+			NumMatched += FRecipeMatcher::Match(Recipe, Items, 1, &Consumed) ? 1 : 0;
+			MatchTimings.Add(Start);
+
+			Start = FPlatformTime::Cycles();
+			FRecipeMatcher::GetMaxCraftCount(Recipe, Items);
+			MaxCountTimings.Add(Start);
+		}
+
+		MatchTimings.Report(Report);
+		MaxCountTimings.Report(Report);
+		UE_LOG(LogCrafting, Display, TEXT("  %d of %d recipes matched"), NumMatched, Iterations);
+	}
+	return true;
+}
+
+bool UCraftingLoadTestCommandlet::RunCraftability(const FString& Params)
+{
+	int32 NumPlayers = 10000;
+	int32 Iterations = 20;
+	int32 Seed = 1;
+	FParse::Value(*Params, TEXT("Players="), NumPlayers);
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+
+	FRandomStream Random(Seed);
+	LoadPickupClasses(Params);
+	LoadRecipes(Params, Random);
+	const TArray<FCraftingRecipe>& Recipes = RecipeBook->Recipes;
+
+	// one stack per class, like AcraftingCharacter keeps them
+	TArray<TArray<FPickupItem>> Inventories;
+	Inventories.SetNum(NumPlayers);
+	for (TArray<FPickupItem>& Items : Inventories)
+	{
+		for (UClass* PickupClass : PickupClasses)
+		{
+			if (Random.FRand() < 0.6f)
+			{
+				Items.Add(AcraftingCharacter::MakePickupItem(PickupClass, Random.RandRange(1, 20)));
+			}
+		}
+	}
+
+	FCraftabilityKernel Kernel;
+	Kernel.SetRecipes(Recipes);
+	Kernel.SetNumPlayers(NumPlayers);
+
+	FOperationTimings PackTimings(TEXT("Pack player"));
+	for (int32 Player = 0; Player < NumPlayers; Player++)
+	{
+		const uint32 Start = FPlatformTime::Cycles();
+		Kernel.SetPlayerItems(Player, Inventories[Player]);
+		PackTimings.Add(Start);
+	}
+
+	FOperationTimings KernelTimings(TEXT("Kernel batch"));
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		const uint32 Start = FPlatformTime::Cycles();
+		Kernel.Evaluate();
+		KernelTimings.Add(Start);
+	}
+
+	// the per player path of AcraftingCharacter::GetMaxCraftCount, one recipe at a time
+	FOperationTimings ScalarTimings(TEXT("Scalar batch"));
+	int64 ScalarChecksum = 0;
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		const uint32 Start = FPlatformTime::Cycles();
+		for (const TArray<FPickupItem>& Items : Inventories)
+		{
+			for (const FCraftingRecipe& Recipe : Recipes)
+			{
+				if (FRecipeMatcher::HasWildcards(Recipe))
+				{
+					ScalarChecksum += FRecipeMatcher::GetMaxCraftCount(Recipe, Items);
+					continue;
+				}
+
+				int32 MaxCount = MAX_int32;
+				for (const FRecipeIngredient& Ingredient : Recipe.Ingredients)
+				{
+					const FPickupItem* Item = Items.FindByPredicate([&Ingredient](const FPickupItem& It) { return It.Class == Ingredient.Class; });
+					MaxCount = Ingredient.Number > 0 ? FMath::Min(MaxCount, (Item != nullptr ? Item->Number : 0) / Ingredient.Number) : MaxCount;
+				}
+				ScalarChecksum += MaxCount;
+			}
+		}
+		ScalarTimings.Add(Start);
+	}
+
+	// the matcher is the reference, it also handles items listed twice in one recipe
+	int32 NumMismatches = 0;
+	for (int32 Player = 0; Player < FMath::Min(NumPlayers, 64); Player++)
+	{
+		for (int32 Recipe = 0; Recipe < Recipes.Num(); Recipe++)
+		{
+			const int32 Expected = Recipes[Recipe].Ingredients.Num() > 0 ? FRecipeMatcher::GetMaxCraftCount(Recipes[Recipe], Inventories[Player]) : 0;
+			if (FMath::Min(Kernel.GetMaxCraftCount(Player, Recipe), FCraftabilityKernel::MaxItemCount) != FMath::Min(Expected, FCraftabilityKernel::MaxItemCount)
+				|| Kernel.CanCraft(Player, Recipe) != (Expected > 0))
+			{
+				++NumMismatches;
+			}
+		}
+	}
+
+	auto EvaluationsPerSecond = [NumPlayers, &Recipes](const FOperationTimings& Timings)
+	{
+		uint64 TotalCycles = 0;
+		for (uint32 Sample : Timings.Cycles)
+		{
+			TotalCycles += Sample;
+		}
+		const double Seconds = TotalCycles * FPlatformTime::GetSecondsPerCycle();
+		return Seconds > 0 ? (double)NumPlayers * Recipes.Num() * Timings.Cycles.Num() / Seconds : 0;
+	};
+
+	UE_LOG(LogCrafting, Display, TEXT("Craftability: %d players, %d recipes, %d item ids, %d iterations"), NumPlayers, Recipes.Num(), Kernel.GetNumItemIds(), Iterations);
+	PackTimings.Report(Report);
+	KernelTimings.Report(Report);
+	ScalarTimings.Report(Report);
+	UE_LOG(LogCrafting, Display, TEXT("  kernel %.0f recipes x players/s, scalar %.0f recipes x players/s (checksum %lld)"),
+		EvaluationsPerSecond(KernelTimings), EvaluationsPerSecond(ScalarTimings), ScalarChecksum);
+
+	if (NumMismatches > 0)
+	{
+		UE_LOG(LogCrafting, Error, TEXT("  kernel disagrees with the recipe matcher on %d results"), NumMismatches);
+		return false;
+	}
+	return true;
+}
+
+bool UCraftingLoadTestCommandlet::RunRelevancy(const FString& Params)
+{
+	int32 NumPickups = 20000;
+	int32 NumViewers = 32;
+	float SimulatedSeconds = 30.0f;
+	float NetRate = 30.0f;
+	float CollectRate = 1.0f;
+	float MoveRate = 1.0f;
+	float WorldSize = 100000.0f;
+	int32 Seed = 1;
+	FParse::Value(*Params, TEXT("Pickups="), NumPickups);
+	FParse::Value(*Params, TEXT("Viewers="), NumViewers);
+	FParse::Value(*Params, TEXT("Seconds="), SimulatedSeconds);
+	FParse::Value(*Params, TEXT("NetRate="), NetRate);
+	FParse::Value(*Params, TEXT("CollectRate="), CollectRate);
+	FParse::Value(*Params, TEXT("MoveRate="), MoveRate);
+	FParse::Value(*Params, TEXT("WorldSize="), WorldSize);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+
+	FRandomStream Random(Seed);
+	LoadPickupClasses(Params);
+
+	// a bare game world without a net driver, the viewers stand in for the connections of 32 clients
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	auto RandomLocation = [&Random, WorldSize]() { return FVector(Random.FRandRange(0, WorldSize), Random.FRandRange(0, WorldSize), 0); };
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	FPickupRelevancyGrid Grid;
+	TArray<APickupObject*> Pickups;
+	for (int32 i = 0; i < NumPickups; i++)
+	{
+		UClass* PickupClass = PickupClasses[Random.RandHelper(PickupClasses.Num())];
+		APickupObject* Pickup = World->SpawnActor<APickupObject>(PickupClass, RandomLocation(), FRotator::ZeroRotator, SpawnParams);
+		if (Pickup != nullptr)
+		{
+			Pickups.Add(Pickup);
+			Grid.Add(Pickup);
+		}
+	}
+
+	struct FViewer
+	{
+		FVector Location;
+		FVector Velocity;
+		FIntPoint Cell;
+	};
+	TArray<FViewer> Viewers;
+	for (int32 i = 0; i < NumViewers; i++)
+	{
+		FVector Direction = Random.VRand();
+		Direction.Z = 0;
+		const FVector Location = RandomLocation();
+		Viewers.Add(FViewer{ Location, Direction.GetSafeNormal() * 600.0f, FPickupRelevancyGrid::GetCell(Location) });
+	}
+
+	const float CullDistanceSquared = GetDefault<APickupObject>()->NetCullDistanceSquared;
+	FOperationTimings AllTimings(TEXT("Net tick all"));
+	FOperationTimings DormantTimings(TEXT("Net tick dormant"));
+	int64 NumRelevantAll = 0;
+	int64 NumUpdatesDormant = 0;
+
+	const float DeltaSeconds = 1.0f / NetRate;
+	const int32 NumTicks = FMath::CeilToInt(SimulatedSeconds * NetRate);
+	TArray<APickupObject*> Awake;
+	TArray<FIntPoint> CollectedCells;
+	TArray<APickupObject*> Entered;
+
+	for (int32 NetTick = 0; NetTick < NumTicks; NetTick++)
+	{
+		for (FViewer& Viewer : Viewers)
+		{
+			Viewer.Location += Viewer.Velocity * DeltaSeconds;
+			if (Viewer.Location.X < 0 || Viewer.Location.X > WorldSize)
+			{
+				Viewer.Velocity.X = -Viewer.Velocity.X;
+			}
+			if (Viewer.Location.Y < 0 || Viewer.Location.Y > WorldSize)
+			{
+				Viewer.Velocity.Y = -Viewer.Velocity.Y;
+			}
+		}
+
+		// collections and moves of this tick, both wake the pickup up
+		Awake.Reset();
+		CollectedCells.Reset();
+		const int32 NumCollects = FMath::FloorToInt(CollectRate * NumViewers * DeltaSeconds + Random.FRand());
+		for (int32 i = 0; i < NumCollects && Pickups.Num() > 0; i++)
+		{
+			const int32 Index = Random.RandHelper(Pickups.Num());
+			APickupObject* Pickup = Pickups[Index];
+			Grid.Remove(Pickup);
+			CollectedCells.Add(Pickup->GetRelevancyCell());
+			Pickup->FlushNetDormancy();
+			Pickup->Destroy();
+			Pickups.RemoveAtSwap(Index);
+		}
+		const int32 NumMoves = FMath::FloorToInt(MoveRate * NumViewers * DeltaSeconds + Random.FRand());
+		for (int32 i = 0; i < NumMoves && Pickups.Num() > 0; i++)
+		{
+			APickupObject* Pickup = Pickups[Random.RandHelper(Pickups.Num())];
+			const FIntPoint OldCell = Pickup->GetRelevancyCell();
+			Pickup->MoveTo(Pickup->GetActorLocation() + FVector(Random.FRandRange(-500, 500), Random.FRandRange(-500, 500), 0));
+			Grid.Update(Pickup, OldCell);
+			Awake.Add(Pickup);
+		}
+
+		// every pickup is considered for every connection, what the net driver does without dormancy
+		{
+			const uint32 Start = FPlatformTime::Cycles();
+			for (const FViewer& Viewer : Viewers)
+			{
+				for (const APickupObject* Pickup : Pickups)
+				{
+					if (FVector::DistSquared(Viewer.Location, Pickup->GetActorLocation()) <= CullDistanceSquared)
+					{
+						++NumRelevantAll;
+					}
+				}
+			}
+			AllTimings.Add(Start);
+		}
+
+		// dormant pickups are skipped, only woken ones and the ones a viewer starts to see are looked at
+		{
+			const uint32 Start = FPlatformTime::Cycles();
+			for (FViewer& Viewer : Viewers)
+			{
+				const FIntPoint ViewerCell = FPickupRelevancyGrid::GetCell(Viewer.Location);
+				for (const APickupObject* Pickup : Awake)
+				{
+					if (Pickup->IsNetRelevantFor(nullptr, nullptr, Viewer.Location))
+					{
+						++NumUpdatesDormant;
+					}
+				}
+				for (const FIntPoint& Cell : CollectedCells)
+				{
+					if (FPickupRelevancyGrid::IsCellRelevant(ViewerCell, Cell))
+					{
+						++NumUpdatesDormant;
+					}
+				}
+				if (ViewerCell != Viewer.Cell)
+				{
+					Entered.Reset();
+					Grid.GetRelevantPickups(Viewer.Location, Entered);
+					for (const APickupObject* Pickup : Entered)
+					{
+						if (!FPickupRelevancyGrid::IsCellRelevant(Viewer.Cell, Pickup->GetRelevancyCell()))
+						{
+							++NumUpdatesDormant;
+						}
+					}
+					Viewer.Cell = ViewerCell;
+				}
+			}
+			DormantTimings.Add(Start);
+		}
+	}
+
+	auto MillisecondsPerTick = [](const FOperationTimings& Timings)
+	{
+		uint64 TotalCycles = 0;
+		for (uint32 Sample : Timings.Cycles)
+		{
+			TotalCycles += Sample;
+		}
+		return Timings.Cycles.Num() > 0 ? FPlatformTime::ToMilliseconds(TotalCycles) / Timings.Cycles.Num() : 0.0;
+	};
+
+	UE_LOG(LogCrafting, Display, TEXT("Relevancy: %d pickups, %d viewers, %d net ticks, %d pickups left"), NumPickups, NumViewers, NumTicks, Pickups.Num());
+	AllTimings.Report(Report);
+	DormantTimings.Report(Report);
+	UE_LOG(LogCrafting, Display, TEXT("  all: %.3f ms per net tick, %.1f relevant pairs per tick"), MillisecondsPerTick(AllTimings), (double)NumRelevantAll / NumTicks);
+	UE_LOG(LogCrafting, Display, TEXT("  dormant: %.3f ms per net tick, %.1f updates and channel opens per tick"), MillisecondsPerTick(DormantTimings), (double)NumUpdatesDormant / NumTicks);
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return true;
+}
+
+bool UCraftingLoadTestCommandlet::RunGrid(const FString& Params)
+{
+	int32 GridWidth = 20;
+	int32 GridHeight = 50;
+	int32 Iterations = 200;
+	int32 Seed = 1;
+	FParse::Value(*Params, TEXT("GridWidth="), GridWidth);
+	FParse::Value(*Params, TEXT("GridHeight="), GridHeight);
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+
+	FRandomStream Random(Seed);
+	LoadPickupClasses(Params);
+
+	// the pickup blueprints are mostly 1x1, random shapes give the packer something to do
+	TArray<FGridItemShape> Shapes;
+	for (int32 i = 0; i < PickupClasses.Num(); i++)
+	{
+		Shapes.Add(FGridItemShape{ Random.RandRange(1, 3), Random.RandRange(1, 3), Random.RandRange(1, 20) });
+	}
+
+	FGridInventory Grid;
+
+	// a layout where the bitmap fallback used to place a stack under a skyline segment that still claimed the cells
+	if (PickupClasses.Num() >= 4)
+	{
+		const FGridItemShape ReproShapes[] = { { 3, 4, 1 }, { 4, 1, 1 }, { 3, 1, 1 }, { 2, 1, 1 } };
+		Grid.Init(6, 5);
+		for (int32 i = 0; i < ARRAY_COUNT(ReproShapes); i++)
+		{
+			Grid.Add(PickupClasses[i], 1, ReproShapes[i]);
+		}
+		Grid.Sort();
+		if (Grid.HasOverlaps())
+		{
+			UE_LOG(LogCrafting, Error, TEXT("  sorting a 6x5 grid placed two stacks on the same cells"));
+			return false;
+		}
+	}
+
+	FOperationTimings PlaceTimings(TEXT("Grid place"));
+	FOperationTimings FitsTimings(TEXT("Grid fits"));
+	FOperationTimings RemoveTimings(TEXT("Grid remove"));
+	FOperationTimings SortTimings(TEXT("Grid sort"));
+	int64 FilledCells = 0;
+	int64 SortedCells = 0;
+	int32 NumSortFailures = 0;
+
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		Grid.Init(GridWidth, GridHeight);
+
+		// mass looting, keep adding until the first item bounces off
+		for (;;)
+		{
+			const int32 Item = Random.RandHelper(PickupClasses.Num());
+			const int32 Number = Random.RandRange(1, Shapes[Item].MaxStack);
+
+			uint32 Start = FPlatformTime::Cycles();
+			const bool bFits = Grid.CanAdd(PickupClasses[Item], Number, Shapes[Item]);
+			FitsTimings.Add(Start);
+			if (!bFits)
+			{
+				break;
+			}
+
+			Start = FPlatformTime::Cycles();
+			Grid.Add(PickupClasses[Item], Number, Shapes[Item]);
+			PlaceTimings.Add(Start);
+		}
+		FilledCells += GridWidth * GridHeight - Grid.GetFreeCells();
+
+		// take out a third of the stacks partly or fully, leaving holes and partial stacks behind
+		const int32 NumRemoves = Grid.GetStacks().Num() / 3;
+		for (int32 i = 0; i < NumRemoves && Grid.GetStacks().Num() > 0; i++)
+		{
+			const FInventoryGridStack& Stack = Grid.GetStacks()[Random.RandHelper(Grid.GetStacks().Num())];
+			UClass* ItemClass = Stack.Class;
+			const int32 Number = Random.RandRange(1, Stack.Number);
+			const uint32 Start = FPlatformTime::Cycles();
+			Grid.Remove(ItemClass, Number);
+			RemoveTimings.Add(Start);
+		}
+
+		const uint32 Start = FPlatformTime::Cycles();
+		if (!Grid.Sort())
+		{
+			++NumSortFailures;
+		}
+		SortTimings.Add(Start);
+		SortedCells += GridWidth * GridHeight - Grid.GetFreeCells();
+
+		if (Grid.HasOverlaps())
+		{
+			UE_LOG(LogCrafting, Error, TEXT("  iteration %d: stacks overlap after sorting"), Iteration);
+			return false;
+		}
+
+		if (Grid.GetOverflow() > 0)
+		{
+			UE_LOG(LogCrafting, Error, TEXT("  iteration %d: sorting left %d items without a cell"), Iteration, Grid.GetOverflow());
+			return false;
+		}
+	}
+
+	UE_LOG(LogCrafting, Display, TEXT("Grid: %dx%d cells, %d item shapes, %d fills"), GridWidth, GridHeight, Shapes.Num(), Iterations);
+	PlaceTimings.Report(Report);
+	FitsTimings.Report(Report);
+	RemoveTimings.Report(Report);
+	SortTimings.Report(Report);
+	UE_LOG(LogCrafting, Display, TEXT("  filled to %.1f%% before the first miss, %.1f%% used after removing and sorting, %d sorts kept the old layout"),
+		100.0 * FilledCells / ((double)GridWidth * GridHeight * Iterations), 100.0 * SortedCells / ((double)GridWidth * GridHeight * Iterations), NumSortFailures);
+	return true;
+}
+
+bool UCraftingLoadTestCommandlet::RunMagnet(const FString& Params)
+{
+	int32 NumPlayers = 8;
+	int32 BurstSize = 60;
+	float BurstInterval = 2.0f;
+	float SimulatedSeconds = 30.0f;
+	float Radius = 600.0f;
+	int32 Seed = 1;
+	FParse::Value(*Params, TEXT("Players="), NumPlayers);
+	FParse::Value(*Params, TEXT("Burst="), BurstSize);
+	FParse::Value(*Params, TEXT("BurstInterval="), BurstInterval);
+	FParse::Value(*Params, TEXT("Seconds="), SimulatedSeconds);
+	FParse::Value(*Params, TEXT("Radius="), Radius);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+
+	FRandomStream Random(Seed);
+	LoadPickupClasses(Params);
+	if (NumPlayers <= 0)
+	{
+		UE_LOG(LogCrafting, Error, TEXT("Magnet needs at least one player"));
+		return false;
+	}
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	TArray<AcraftingCharacter*> Players;
+	for (int32 i = 0; i < NumPlayers; i++)
+	{
+		AcraftingCharacter* Player = World->SpawnActor<AcraftingCharacter>(AcraftingCharacter::StaticClass(), FVector(i * 10000.0f, 0, 0), FRotator::ZeroRotator, SpawnParams);
+		Player->MagnetRadius = Radius;
+		Players.Add(Player);
+	}
+
+	// the players never begin play, the pickups do so they register with the relevancy grid the magnet searches
+	World->bBegunPlay = true;
+
+	TArray<APickupObject*> Burst;
+	auto DropCrate = [&]()
+	{
+		AcraftingCharacter* Player = Players[Random.RandHelper(Players.Num())];
+		Burst.Reset();
+		for (int32 i = 0; i < BurstSize; i++)
+		{
+			const float Angle = Random.FRandRange(0, 2 * PI);
+			const float Distance = Random.FRandRange(100.0f, Radius * 0.9f);
+			const FVector Location = Player->GetActorLocation() + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0) * Distance;
+			UClass* PickupClass = PickupClasses[Random.RandHelper(PickupClasses.Num())];
+			if (APickupObject* Pickup = World->SpawnActor<APickupObject>(PickupClass, Location, FRotator::ZeroRotator, SpawnParams))
+			{
+				Burst.Add(Pickup);
+			}
+		}
+		return Player;
+	};
+
+	const float DeltaSeconds = 1.0f / 30.0f;
+	const int32 NumFrames = FMath::CeilToInt(SimulatedSeconds / DeltaSeconds);
+	const int32 BurstFrames = FMath::Max(1, FMath::RoundToInt(BurstInterval / DeltaSeconds));
+
+	// every pickup of a crate collected in the frame it drops, as overlaps did one by one
+	FOperationTimings DirectTimings(TEXT("Frame direct"));
+	const int64 DirectBroadcastsStart = FCraftingMetrics::Get().GetCallbackBroadcasts();
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		AcraftingCharacter* Player = Frame % BurstFrames == 0 ? DropCrate() : nullptr;
+		const uint32 Start = FPlatformTime::Cycles();
+		if (Player != nullptr)
+		{
+			for (APickupObject* Pickup : Burst)
+			{
+				Player->IncreaseItemNumber(Pickup);
+				Pickup->Destroy();
+			}
+		}
+		DirectTimings.Add(Start);
+	}
+	const int64 DirectBroadcasts = FCraftingMetrics::Get().GetCallbackBroadcasts() - DirectBroadcastsStart;
+
+	// the same crates attracted and collected in batches, the tail frames let the last crate arrive
+	FOperationTimings MagnetTimings(TEXT("Frame magnet"));
+	const int64 MagnetBroadcastsStart = FCraftingMetrics::Get().GetCallbackBroadcasts();
+	int32 NumLeft = 0;
+	{
+		FPickupMagnet Magnet(World);
+		for (AcraftingCharacter* Player : Players)
+		{
+			Magnet.AddPlayer(Player);
+		}
+
+		const int32 NumTailFrames = FMath::CeilToInt(2.0f / DeltaSeconds);
+		for (int32 Frame = 0; Frame < NumFrames + NumTailFrames; Frame++)
+		{
+			if (Frame < NumFrames && Frame % BurstFrames == 0)
+			{
+				DropCrate();
+			}
+			const uint32 Start = FPlatformTime::Cycles();
+			Magnet.Tick(DeltaSeconds);
+			MagnetTimings.Add(Start);
+		}
+		NumLeft = Magnet.NumAttracted() + Magnet.NumQueued();
+	}
+	const int64 MagnetBroadcasts = FCraftingMetrics::Get().GetCallbackBroadcasts() - MagnetBroadcastsStart;
+
+	UE_LOG(LogCrafting, Display, TEXT("Magnet: %d players, crates of %d pickups every %.1f s, %.0f simulated s"),
+		NumPlayers, BurstSize, BurstInterval, SimulatedSeconds);
+	DirectTimings.Report(Report);
+	MagnetTimings.Report(Report);
+	UE_LOG(LogCrafting, Display, TEXT("  inventory broadcasts: %lld collecting directly, %lld through the magnet, %d pickups still in flight"),
+		DirectBroadcasts, MagnetBroadcasts, NumLeft);
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return true;
+}
+
+bool UCraftingLoadTestCommandlet::RunProjectiles(const FString& Params)
+{
+	int32 NumBursts = 20;
+	int32 BurstSize = 100;
+	int32 NumFrames = 30;
+	int32 Seed = 1;
+	FParse::Value(*Params, TEXT("Bursts="), NumBursts);
+	FParse::Value(*Params, TEXT("Burst="), BurstSize);
+	FParse::Value(*Params, TEXT("Frames="), NumFrames);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+
+	FRandomStream Random(Seed);
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	FOperationTimings SpawnTimings(TEXT("Burst spawn"));
+	FOperationTimings FlightTimings(TEXT("Burst frame"));
+	FOperationTimings DestroyTimings(TEXT("Burst destroy"));
+	TArray<AcraftingProjectile*> Projectiles;
+
+	// the world does not tick, the movement components are stepped by hand like the frames of a burst would
+	const float DeltaSeconds = 1.0f / 30.0f;
+	for (int32 Burst = 0; Burst < NumBursts; Burst++)
+	{
+		Projectiles.Reset();
+		{
+			const uint32 Start = FPlatformTime::Cycles();
+			for (int32 i = 0; i < BurstSize; i++)
+			{
+				const FRotator Rotation(Random.FRandRange(-10.0f, 30.0f), Random.FRandRange(0.0f, 360.0f), 0);
+				if (AcraftingProjectile* Projectile = World->SpawnActor<AcraftingProjectile>(AcraftingProjectile::StaticClass(), FVector(0, 0, 200.0f), Rotation, SpawnParams))
+				{
+					Projectiles.Add(Projectile);
+				}
+			}
+			SpawnTimings.Add(Start);
+		}
+
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			const uint32 Start = FPlatformTime::Cycles();
+			for (AcraftingProjectile* Projectile : Projectiles)
+			{
+				Projectile->GetProjectileMovement()->TickComponent(DeltaSeconds, LEVELTICK_All, nullptr);
+			}
+			FlightTimings.Add(Start);
+		}
+
+		const uint32 Start = FPlatformTime::Cycles();
+		for (AcraftingProjectile* Projectile : Projectiles)
+		{
+			Projectile->Destroy();
+		}
+		DestroyTimings.Add(Start);
+	}
+
+	UE_LOG(LogCrafting, Display, TEXT("Projectiles: %d bursts of %d projectiles, %d frames each"), NumBursts, BurstSize, NumFrames);
+	SpawnTimings.Report(Report);
+	FlightTimings.Report(Report);
+	DestroyTimings.Report(Report);
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return true;
+}
+
+bool UCraftingLoadTestCommandlet::RunSuite(const FString& Params)
+{
+	struct FSuiteEntry
+	{
+		const TCHAR* Name;
+		const TCHAR* Scenario;
+		const TCHAR* Params;
+	};
+
+	// the small and the large scale of every scenario, names are the keys of the baseline and must stay stable
+	static const FSuiteEntry Entries[] =
+	{
+		{ TEXT("Crafters.100"), TEXT("Crafters"), TEXT("-Players=100 -Seconds=10") },
+		{ TEXT("Crafters.1000"), TEXT("Crafters"), TEXT("-Players=1000 -Seconds=10") },
+		{ TEXT("Wildcards.100"), TEXT("Wildcards"), TEXT("-Stacks=100 -Iterations=100") },
+		{ TEXT("Wildcards.5000"), TEXT("Wildcards"), TEXT("-Stacks=5000 -Iterations=100") },
+		{ TEXT("Craftability.64"), TEXT("Craftability"), TEXT("-Players=100 -NumRecipes=64 -Iterations=20") },
+		{ TEXT("Craftability.1024"), TEXT("Craftability"), TEXT("-Players=100 -NumRecipes=1024 -Iterations=20") },
+		{ TEXT("Relevancy.5000"), TEXT("Relevancy"), TEXT("-Pickups=5000 -Seconds=10") },
+		{ TEXT("Relevancy.50000"), TEXT("Relevancy"), TEXT("-Pickups=50000 -Seconds=10") },
+		{ TEXT("Grid.10x10"), TEXT("Grid"), TEXT("-GridWidth=10 -GridHeight=10 -Iterations=100") },
+		{ TEXT("Grid.64x100"), TEXT("Grid"), TEXT("-GridWidth=64 -GridHeight=100 -Iterations=100") },
+		{ TEXT("Magnet.60"), TEXT("Magnet"), TEXT("-Burst=60 -Seconds=10") },
+		{ TEXT("Magnet.400"), TEXT("Magnet"), TEXT("-Burst=400 -Seconds=10") },
+		{ TEXT("Projectiles.50"), TEXT("Projectiles"), TEXT("-Burst=50 -Bursts=20") },
+		{ TEXT("Projectiles.500"), TEXT("Projectiles"), TEXT("-Burst=500 -Bursts=20") },
+	};
+
+	FString BaselinePath = FPaths::GameDir() / TEXT("Perf/CraftingPerfBaseline.csv");
+	float TimeThreshold = 0.2f;
+	float AllocThreshold = 0.05f;
+	int32 Repeats = 3;
+	FParse::Value(*Params, TEXT("Baseline="), BaselinePath);
+	FParse::Value(*Params, TEXT("TimeThreshold="), TimeThreshold);
+	FParse::Value(*Params, TEXT("AllocThreshold="), AllocThreshold);
+	FParse::Value(*Params, TEXT("Repeats="), Repeats);
+	const bool bUpdateBaseline = FParse::Param(*Params, TEXT("UpdateBaseline"));
+
+	struct FSuiteResult
+	{
+		double Milliseconds;
+		int64 Allocations;
+	};
+
+	// Scenario,GameThreadMs,Allocations
+	TMap<FString, FSuiteResult> Baseline;
+	FString BaselineText;
+	if (!bUpdateBaseline)
+	{
+		if (!FFileHelper::LoadFileToString(BaselineText, *BaselinePath))
+		{
+			UE_LOG(LogCrafting, Error, TEXT("No baseline at '%s', record one with -UpdateBaseline"), *BaselinePath);
+			return false;
+		}
+
+		TArray<FString> Lines;
+		BaselineText.ParseIntoArrayLines(Lines);
+		for (int32 i = 1; i < Lines.Num(); i++)
+		{
+			TArray<FString> Fields;
+			if (Lines[i].ParseIntoArray(Fields, TEXT(",")) == 3)
+			{
+				Baseline.Add(Fields[0], FSuiteResult{ FCString::Atod(*Fields[1]), FCString::Atoi64(*Fields[2]) });
+			}
+		}
+	}
+
+	FCountingMalloc& Allocations = FCountingMalloc::Install();
+	FString Results = TEXT("Scenario,GameThreadMs,Allocations\n");
+	TArray<FString> Regressions;
+	bool bSuccess = true;
+
+	for (const FSuiteEntry& Entry : Entries)
+	{
+		// the entry decides the scale, FParse finds its values before the ones of the command line
+		const FString EntryParams = FString(Entry.Params) + TEXT(" ") + Params;
+
+		FSuiteResult Best{ MAX_dbl, MAX_int64 };
+		for (int32 Repeat = 0; Repeat < FMath::Max(Repeats, 1); Repeat++)
+		{
+			// only the operations the scenario times itself count, blueprint loading and world creation vary too much
+			FOperationTimings::TotalCycles = 0;
+			Allocations.Start();
+			const bool bRan = RunScenario(Entry.Scenario, EntryParams);
+			const int64 NumAllocations = Allocations.Stop();
+			const double Milliseconds = FOperationTimings::TotalCycles * FPlatformTime::GetSecondsPerCycle() * 1000.0;
+
+			// the worlds of the run are gone, their memory must not count against the next one
+			CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+
+			if (!bRan)
+			{
+				Regressions.Add(FString::Printf(TEXT("%s failed to run"), Entry.Name));
+				bSuccess = false;
+				break;
+			}
+			Best.Milliseconds = FMath::Min(Best.Milliseconds, Milliseconds);
+			Best.Allocations = FMath::Min(Best.Allocations, NumAllocations);
+		}
+		if (Best.Allocations == MAX_int64)
+		{
+			continue;
+		}
+
+		Results += FString::Printf(TEXT("%s,%.3f,%lld\n"), Entry.Name, Best.Milliseconds, Best.Allocations);
+
+		const FSuiteResult* Base = Baseline.Find(Entry.Name);
+		if (Base == nullptr)
+		{
+			// nothing to compare with until a baseline was recorded on the reference machine, that is not a regression
+			if (bUpdateBaseline)
+			{
+				UE_LOG(LogCrafting, Display, TEXT("Suite %-18s %10.3f ms %12lld allocations"), Entry.Name, Best.Milliseconds, Best.Allocations);
+			}
+			else
+			{
+				UE_LOG(LogCrafting, Warning, TEXT("Suite %-18s %10.3f ms %12lld allocations  (no baseline, record one with -UpdateBaseline)"), Entry.Name, Best.Milliseconds, Best.Allocations);
+			}
+			continue;
+		}
+
+		const double TimeChange = Base->Milliseconds > 0 ? Best.Milliseconds / Base->Milliseconds - 1.0 : 0;
+		const double AllocChange = Base->Allocations > 0 ? (double)Best.Allocations / Base->Allocations - 1.0 : 0;
+		UE_LOG(LogCrafting, Display, TEXT("Suite %-18s %10.3f ms (%+6.1f%%) %12lld allocations (%+6.1f%%)"),
+			Entry.Name, Best.Milliseconds, TimeChange * 100.0, Best.Allocations, AllocChange * 100.0);
+
+		// a millisecond of noise on a scenario that takes a few is not a regression
+		if (TimeChange > TimeThreshold && Best.Milliseconds - Base->Milliseconds > 1.0)
+		{
+			Regressions.Add(FString::Printf(TEXT("%s takes %.1f ms, the baseline is %.1f ms"), Entry.Name, Best.Milliseconds, Base->Milliseconds));
+		}
+		if (AllocChange > AllocThreshold && Best.Allocations - Base->Allocations > 100)
+		{
+			Regressions.Add(FString::Printf(TEXT("%s makes %lld allocations, the baseline is %lld"), Entry.Name, Best.Allocations, Base->Allocations));
+		}
+	}
+
+	Allocations.Uninstall();
+
+	Report = Results;
+	const FString ResultsPath = FPaths::GameSavedDir() / TEXT("Perf/CraftingPerf.csv");
+	FFileHelper::SaveStringToFile(Results, *ResultsPath);
+
+	// a run that failed has no complete results, they must never become the reference
+	if (bUpdateBaseline && bSuccess)
+	{
+		if (!FFileHelper::SaveStringToFile(Results, *BaselinePath))
+		{
+			UE_LOG(LogCrafting, Error, TEXT("Could not write the baseline '%s'"), *BaselinePath);
+			return false;
+		}
+		UE_LOG(LogCrafting, Display, TEXT("Wrote the baseline '%s'"), *BaselinePath);
+	}
+
+	for (const FString& Regression : Regressions)
+	{
+		UE_LOG(LogCrafting, Error, TEXT("Regression: %s"), *Regression);
+	}
+	UE_LOG(LogCrafting, Display, TEXT("Suite: %d regressions, results in '%s'"), Regressions.Num(), *ResultsPath);
+	return bSuccess && Regressions.Num() == 0;
+}
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "CraftingLoadTestCommandlet.generated.h"
+
+/**
+ * Headless benchmark suite of the crafting system, nothing is rendered.
+ *
+ *   -run=CraftingLoadTest [-Scenario=Crafters] [-Report=<out.csv>]
+ *
+ * Crafters spawns virtual players that pick up random pickup classes, drop items and craft recipes:
+ *   -Players=<n> -Seconds=<simulated seconds> -PickupRate=<per player per second> -DropRate=<..> -CraftRate=<..>
+ *   -Seed=<n> -PickupPath=<content path with pickup blueprints> -Recipes=<recipe book asset> -NumRecipes=<generated recipes>
+ *
+ * Wildcards times the recipe matcher on recipes with 1 to MaxSlots category slots over a synthetic inventory:
+ *   -Stacks=<n> -MaxSlots=<n> -Iterations=<recipes per size> -Seed=<n> -PickupPath=<..>
+ *
+ * Craftability compares the batch kernel with evaluating recipes one by one for every player:
+ *   -Players=<n> -Iterations=<n> -Seed=<n> -PickupPath=<..> -Recipes=<..> -NumRecipes=<..>
+ *
+ * Relevancy times the replication consider pass of a server over static pickups and moving viewers, once checking
+ * every pickup against every viewer and once with dormant pickups skipped and FPickupRelevancyGrid relevancy:
+ *   -Pickups=<n> -Viewers=<n> -Seconds=<simulated seconds> -NetRate=<net ticks per second>
+ *   -CollectRate=<..> -MoveRate=<pickups per viewer per second> -WorldSize=<uu> -Seed=<n> -PickupPath=<..>
+ *
+ * Grid fills a grid inventory with items of random footprints and stack limits, asks whether more fit,
+ * takes random items out again and re-sorts it:
+ *   -GridWidth=<cells, at most 64> -GridHeight=<cells> -Iterations=<fills> -Seed=<n> -PickupPath=<..>
+ *
+ * Magnet drops crates of pickups around random players, once collecting each pickup in the frame it drops
+ * and once letting FPickupMagnet attract and collect them, and compares the frame times:
+ *   -Players=<n> -Burst=<pickups per crate> -BurstInterval=<seconds> -Seconds=<simulated seconds> -Radius=<uu> -Seed=<n> -PickupPath=<..>
+ *
+ * Projectiles fires bursts of projectiles, moves them for a number of frames and destroys them again:
+ *   -Bursts=<n> -Burst=<projectiles per burst> -Frames=<frames a burst flies> -Seed=<n>
+ *
+ * Suite runs the scenarios above at a small and a large scale, measures the time of the operations each run times
+ * itself and the number of game thread allocations, and compares them with the committed baseline. The run fails when
+ * a scenario got slower or allocates more than the thresholds allow, scenarios without a baseline row only warn;
+ * -Report then holds the suite results. -UpdateBaseline records a new baseline instead, only from a run where every
+ * scenario ran. Meant for CI, e.g.
+ *   UE4Editor-Cmd crafting.uproject -run=CraftingLoadTest -Scenario=Suite -nullrhi -unattended
+ *   -Baseline=<csv, defaults to Perf/CraftingPerfBaseline.csv in the project> -UpdateBaseline -Repeats=<runs per scenario, the best counts>
+ *   -TimeThreshold=<allowed time growth, 0.2 = 20%> -AllocThreshold=<allowed allocation growth>
+ * Other parameters like -PickupPath or -Recipes are passed on to the scenarios. The automation test
+ * Crafting.Perf.Suite runs the same suite from the session frontend.
+ *
+ * Every operation is timed on its own, the report lists throughput, tail latencies and memory growth.
+ */
+UCLASS()
+class UCraftingLoadTestCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UCraftingLoadTestCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	bool RunCrafters(const FString& Params);
+	bool RunWildcards(const FString& Params);
+	bool RunCraftability(const FString& Params);
+	bool RunRelevancy(const FString& Params);
+	bool RunGrid(const FString& Params);
+	bool RunMagnet(const FString& Params);
+	bool RunProjectiles(const FString& Params);
+	bool RunSuite(const FString& Params);
+
+	bool RunScenario(const FString& Scenario, const FString& Params);
+
+	void LoadPickupClasses(const FString& Params);
+	void LoadRecipes(const FString& Params, FRandomStream& Random);
+
+	UPROPERTY()
+		TArray<UClass*> PickupClasses;
+
+	UPROPERTY()
+		class UCraftingRecipeBook* RecipeBook;
+
+	/** Rows of the CSV report, one per measured operation */
+	FString Report;
+};
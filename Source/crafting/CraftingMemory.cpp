@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingMemory.h"
+#include "craftingCharacter.h"
+#include "CraftingRecipe.h"
+#include "CraftingContentStreamer.h"
+#include "CraftingWidgetComponent.h"
+#include "StorageContainer.h"
+#include "Blueprint/UserWidget.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Serialization/ArchiveCountMem.h"
+
+DECLARE_MEMORY_STAT(TEXT("Inventories"), STAT_CraftingMemInventories, STATGROUP_Crafting);
+DECLARE_MEMORY_STAT(TEXT("Recipes"), STAT_CraftingMemRecipes, STATGROUP_Crafting);
+DECLARE_MEMORY_STAT(TEXT("Pickups"), STAT_CraftingMemPickups, STATGROUP_Crafting);
+DECLARE_MEMORY_STAT(TEXT("Icons"), STAT_CraftingMemIcons, STATGROUP_Crafting);
+DECLARE_MEMORY_STAT(TEXT("Widgets"), STAT_CraftingMemWidgets, STATGROUP_Crafting);
+
+static FAutoConsoleCommand MemReportCommand(
+	TEXT("Crafting.MemReport"),
+	TEXT("Logs the memory used by inventories, recipes, pickups, icons and widgets and flags categories over budget"),
+	FConsoleCommandDelegate::CreateLambda([]() { FCraftingMemory::Report(); }));
+
+/** Only objects of running games count, not class defaults or the editor world */
+static bool IsInGame(const UObject* Object)
+{
+	const UWorld* World = Object->GetWorld();
+	return !Object->IsTemplate() && World != nullptr && World->IsGameWorld();
+}
+
+SIZE_T FCraftingMemory::GetItemsAllocatedSize(const TArray<FPickupItem>& Items)
+{
+	SIZE_T Size = Items.GetAllocatedSize();
+	for (const FPickupItem& Item : Items)
+	{
+		Size += Item.SName.GetAllocatedSize() + Item.Description.GetAllocatedSize();
+	}
+	return Size;
+}
+
+SIZE_T FCraftingMemory::GetObjectSize(UObject* Object)
+{
+	FArchiveCountMem CountMem(Object);
+	return Object->GetClass()->GetStructureSize() + CountMem.GetMax() + Object->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+}
+
+void FCraftingMemory::Measure(FCategory (&OutCategories)[NumCategories])
+{
+	FMemory::Memzero(OutCategories);
+	FCategory& Inventories = OutCategories[(int32)ECraftingMemoryCategory::Inventories];
+	FCategory& Recipes = OutCategories[(int32)ECraftingMemoryCategory::Recipes];
+	FCategory& Pickups = OutCategories[(int32)ECraftingMemoryCategory::Pickups];
+	FCategory& Icons = OutCategories[(int32)ECraftingMemoryCategory::Icons];
+	FCategory& Widgets = OutCategories[(int32)ECraftingMemoryCategory::Widgets];
+
+	for (TObjectIterator<AcraftingCharacter> It; It; ++It)
+	{
+		if (IsInGame(*It))
+		{
+			Inventories.Bytes += It->GetInventoryAllocatedSize();
+			++Inventories.Count;
+		}
+	}
+	for (TObjectIterator<AStorageContainer> It; It; ++It)
+	{
+		if (IsInGame(*It))
+		{
+			Inventories.Bytes += GetItemsAllocatedSize(It->GetItems());
+			++Inventories.Count;
+		}
+	}
+
+	for (TObjectIterator<UCraftingRecipeBook> It; It; ++It)
+	{
+		if (!It->IsTemplate())
+		{
+			Recipes.Bytes += GetObjectSize(*It) + It->GetIndexAllocatedSize();
+			++Recipes.Count;
+		}
+	}
+
+	TInlineComponentArray<UActorComponent*> Components;
+	for (TObjectIterator<APickupObject> It; It; ++It)
+	{
+		if (IsInGame(*It))
+		{
+			Pickups.Bytes += GetObjectSize(*It);
+			It->GetComponents(Components);
+			for (UActorComponent* Component : Components)
+			{
+				Pickups.Bytes += GetObjectSize(Component);
+			}
+			++Pickups.Count;
+		}
+	}
+
+	Icons.Bytes = FCraftingContentStreamer::Get().GetIconMemory(Icons.Count);
+
+	// the widget tree is outered to the user widget, the render target holds most of the memory
+	TArray<UObject*> WidgetObjects;
+	for (TObjectIterator<UCraftingWidgetComponent> It; It; ++It)
+	{
+		if (!IsInGame(*It))
+		{
+			continue;
+		}
+		Widgets.Bytes += GetObjectSize(*It);
+		if (UUserWidget* Widget = It->GetUserWidgetObject())
+		{
+			WidgetObjects.Reset();
+			WidgetObjects.Add(Widget);
+			GetObjectsWithOuter(Widget, WidgetObjects, true);
+			for (UObject* Object : WidgetObjects)
+			{
+				Widgets.Bytes += GetObjectSize(Object);
+			}
+			++Widgets.Count;
+		}
+		if (UTextureRenderTarget2D* RenderTarget = It->GetRenderTarget())
+		{
+			Widgets.Bytes += GetObjectSize(RenderTarget);
+		}
+	}
+
+	SET_MEMORY_STAT(STAT_CraftingMemInventories, Inventories.Bytes);
+	SET_MEMORY_STAT(STAT_CraftingMemRecipes, Recipes.Bytes);
+	SET_MEMORY_STAT(STAT_CraftingMemPickups, Pickups.Bytes);
+	SET_MEMORY_STAT(STAT_CraftingMemIcons, Icons.Bytes);
+	SET_MEMORY_STAT(STAT_CraftingMemWidgets, Widgets.Bytes);
+}
+
+bool FCraftingMemory::Report()
+{
+	FCategory Categories[NumCategories];
+	Measure(Categories);
+
+	SIZE_T TotalBytes = 0;
+	bool bWithinBudget = true;
+	UE_LOG(LogCrafting, Display, TEXT("Crafting memory:"));
+	for (int32 i = 0; i < NumCategories; i++)
+	{
+		const ECraftingMemoryCategory Category = (ECraftingMemoryCategory)i;
+		const SIZE_T Budget = GetBudget(Category);
+		const bool bOverBudget = Budget > 0 && Categories[i].Bytes > Budget;
+		bWithinBudget &= !bOverBudget;
+		TotalBytes += Categories[i].Bytes;
+
+		const FString BudgetText = Budget > 0 ? FString::Printf(TEXT("%.1f MB budget"), Budget / (1024.0 * 1024.0)) : FString(TEXT("no budget"));
+		if (bOverBudget)
+		{
+			UE_LOG(LogCrafting, Warning, TEXT("  %-12s %10.1f KB in %6d  %s  OVER BUDGET"), GetCategoryName(Category), Categories[i].Bytes / 1024.0, Categories[i].Count, *BudgetText);
+		}
+		else
+		{
+			UE_LOG(LogCrafting, Display, TEXT("  %-12s %10.1f KB in %6d  %s"), GetCategoryName(Category), Categories[i].Bytes / 1024.0, Categories[i].Count, *BudgetText);
+		}
+	}
+
+	const FPlatformMemoryStats Stats = FPlatformMemory::GetStats();
+	UE_LOG(LogCrafting, Display, TEXT("  total        %10.1f KB, %.2f%% of the %.1f MB used by the process"),
+		TotalBytes / 1024.0, Stats.UsedPhysical > 0 ? 100.0 * TotalBytes / Stats.UsedPhysical : 0.0, Stats.UsedPhysical / (1024.0 * 1024.0));
+	return bWithinBudget;
+}
+
+const TCHAR* FCraftingMemory::GetCategoryName(ECraftingMemoryCategory Category)
+{
+	switch (Category)
+	{
+	case ECraftingMemoryCategory::Inventories:	return TEXT("Inventories");
+	case ECraftingMemoryCategory::Recipes:		return TEXT("Recipes");
+	case ECraftingMemoryCategory::Pickups:		return TEXT("Pickups");
+	case ECraftingMemoryCategory::Icons:		return TEXT("Icons");
+	case ECraftingMemoryCategory::Widgets:		return TEXT("Widgets");
+	default:									return TEXT("Unknown");
+	}
+}
+
+SIZE_T FCraftingMemory::GetBudget(ECraftingMemoryCategory Category)
+{
+	float Megabytes = 0;
+	GConfig->GetFloat(TEXT("Crafting.MemoryBudgets"), GetCategoryName(Category), Megabytes, GGameIni);
+	return Megabytes > 0 ? (SIZE_T)(Megabytes * 1024 * 1024) : 0;
+}
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+enum class ECraftingMemoryCategory : uint8
+{
+	Inventories,
+	Recipes,
+	Pickups,
+	Icons,
+	Widgets,
+	Count
+};
+
+/**
+ * Memory report of the crafting system.
+ *
+ * The engine has no tagging of individual allocations, so every category is measured from the owners of
+ * its memory: container allocations and strings of inventories, serialized sizes of recipe books, pickup
+ * actors and their components, resident mips of icons and the widgets with their render targets. The last
+ * measurement is also published as memory stats of STATGROUP_Crafting. Measuring walks every object of a
+ * category, it is meant for the console and for reports, not for every frame.
+ *
+ *   Crafting.MemReport     logs the breakdown and flags the categories above their budget
+ *
+ * Budgets are megabytes in the [Crafting.MemoryBudgets] section of the game ini, 0 or missing is unlimited.
+ * Nothing depends on a renderer or a viewport, so the report works on dedicated servers and with -nullrhi.
+ */
+class FCraftingMemory
+{
+public:
+	static const int32 NumCategories = (int32)ECraftingMemoryCategory::Count;
+
+	struct FCategory
+	{
+		SIZE_T Bytes;
+		int32 Count;
+	};
+
+	static void Measure(FCategory (&OutCategories)[NumCategories]);
+
+	/** Logs the breakdown, returns false when a category is over its budget */
+	static bool Report();
+
+	static const TCHAR* GetCategoryName(ECraftingMemoryCategory Category);
+
+	/** Budget of the category in bytes, 0 is unlimited */
+	static SIZE_T GetBudget(ECraftingMemoryCategory Category);
+
+	/** Heap size of inventory stacks including their strings */
+	static SIZE_T GetItemsAllocatedSize(const TArray<struct FPickupItem>& Items);
+
+	/** Size of the object itself plus everything its properties allocate */
+	static SIZE_T GetObjectSize(UObject* Object);
+};
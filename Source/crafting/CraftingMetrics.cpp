@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingMetrics.h"
+#include "Async/Async.h"
+#include "Common/TcpListener.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+const uint32 FCraftingHistogram::BoundsMicroseconds[NumBounds] = { 1, 2, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 10000 };
+
+FTcpListener* FCraftingMetricsExporter::Listener = nullptr;
+
+static FAutoConsoleCommand StartMetricsCommand(
+	TEXT("Crafting.Metrics.Start"),
+	TEXT("Serves the crafting metrics on http://127.0.0.1:<port>/metrics, 9464 by default"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FCraftingMetricsExporter::Start(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : FCraftingMetricsExporter::DefaultPort);
+	}));
+
+static FAutoConsoleCommand StopMetricsCommand(
+	TEXT("Crafting.Metrics.Stop"),
+	TEXT("Stops serving the crafting metrics"),
+	FConsoleCommandDelegate::CreateStatic(&FCraftingMetricsExporter::Stop));
+
+static FAutoConsoleCommand ScrapeMetricsCommand(
+	TEXT("Crafting.Metrics.Scrape"),
+	TEXT("Scrapes the local crafting metrics endpoint once and logs what it served"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FCraftingMetricsExporter::Scrape(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : FCraftingMetricsExporter::DefaultPort);
+	}));
+
+void FCraftingHistogram::ObserveCycles(uint32 Cycles)
+{
+	const int64 Nanoseconds = (int64)(Cycles * FPlatformTime::GetSecondsPerCycle() * 1e9);
+	int32 Bucket = 0;
+	while (Bucket < NumBounds && Nanoseconds > BoundsMicroseconds[Bucket] * 1000ll)
+	{
+		++Bucket;
+	}
+
+	Buckets[Bucket].Increment();
+	Count.Increment();
+	SumNanoseconds.Add(Nanoseconds);
+}
+
+void FCraftingHistogram::Render(FString& Out, const TCHAR* Name, const TCHAR* Help) const
+{
+	Out += FString::Printf(TEXT("# HELP %s %s\n# TYPE %s histogram\n"), Name, Help, Name);
+
+	// Prometheus buckets are cumulative
+	int64 Cumulative = 0;
+	for (int32 i = 0; i < NumBounds; i++)
+	{
+		Cumulative += Buckets[i].GetValue();
+		Out += FString::Printf(TEXT("%s_bucket{le=\"%g\"} %lld\n"), Name, BoundsMicroseconds[i] / 1e6, Cumulative);
+	}
+	Cumulative += Buckets[NumBounds].GetValue();
+	Out += FString::Printf(TEXT("%s_bucket{le=\"+Inf\"} %lld\n"), Name, Cumulative);
+	Out += FString::Printf(TEXT("%s_sum %.9f\n%s_count %lld\n"), Name, SumNanoseconds.GetValue() / 1e9, Name, Count.GetValue());
+}
+
+FCraftingMetrics& FCraftingMetrics::Get()
+{
+	static FCraftingMetrics Metrics;
+	return Metrics;
+}
+
+FString FCraftingMetrics::Render() const
+{
+	FString Out;
+	auto RenderValue = [&Out](const TCHAR* Name, const TCHAR* Type, const TCHAR* Help, int64 Value)
+	{
+		Out += FString::Printf(TEXT("# HELP %s %s\n# TYPE %s %s\n%s %lld\n"), Name, Help, Name, Type, Name, Value);
+	};
+
+	RenderValue(TEXT("crafting_pickups_total"), TEXT("counter"), TEXT("Pickups collected by players, rate() gives pickups per second."), Pickups.GetValue());
+	RenderValue(TEXT("crafting_crafts_total"), TEXT("counter"), TEXT("Finished crafts of stations and crafting tables."), Crafts.GetValue());
+	RenderValue(TEXT("crafting_callback_broadcasts_total"), TEXT("counter"), TEXT("Inventory Callback broadcasts, each one redraws the inventory widgets."), CallbackBroadcasts.GetValue());
+	RenderValue(TEXT("crafting_pickup_actors"), TEXT("gauge"), TEXT("Pickup actors in play."), PickupActors.GetValue());
+	Out += TEXT("# HELP crafting_pickup_predictions_total Client predicted pickups answered by the server.\n# TYPE crafting_pickup_predictions_total counter\n");
+	Out += FString::Printf(TEXT("crafting_pickup_predictions_total{result=\"confirmed\"} %lld\n"), PredictionsConfirmed.GetValue());
+	Out += FString::Printf(TEXT("crafting_pickup_predictions_total{result=\"rejected\"} %lld\n"), PredictionsRejected.GetValue());
+	InventoryMutations.Render(Out, TEXT("crafting_inventory_mutation_seconds"), TEXT("Time spent in one inventory mutation."));
+	return Out;
+}
+
+bool FCraftingMetricsExporter::Start(int32 Port)
+{
+	if (IsRunning())
+	{
+		return true;
+	}
+
+	// loopback only, the scraper runs on the same machine
+	const FIPv4Endpoint Endpoint(FIPv4Address(127, 0, 0, 1), Port);
+	Listener = new FTcpListener(Endpoint, FTimespan::FromMilliseconds(100));
+	if (!Listener->IsActive())
+	{
+		UE_LOG(LogCrafting, Warning, TEXT("Could not serve crafting metrics on %s"), *Endpoint.ToString());
+		delete Listener;
+		Listener = nullptr;
+		return false;
+	}
+
+	// connections accepted before the bind are closed unanswered, the scraper simply retries
+	Listener->OnConnectionAccepted().BindStatic(&FCraftingMetricsExporter::HandleConnection);
+	UE_LOG(LogCrafting, Display, TEXT("Serving crafting metrics on http://%s/metrics"), *Endpoint.ToString());
+	return true;
+}
+
+void FCraftingMetricsExporter::Stop()
+{
+	// stops and joins the listener thread
+	delete Listener;
+	Listener = nullptr;
+}
+
+bool FCraftingMetricsExporter::HandleConnection(FSocket* Socket, const FIPv4Endpoint& Endpoint)
+{
+	// read the request line, the rest of the request does not matter
+	ANSICHAR Request[1024] = {};
+	int32 NumRead = 0;
+	if (Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromSeconds(1)))
+	{
+		Socket->Recv((uint8*)Request, sizeof(Request) - 1, NumRead);
+	}
+
+	const bool bIsMetrics = FCStringAnsi::Strncmp(Request, "GET /metrics", 12) == 0 || FCStringAnsi::Strncmp(Request, "GET / ", 6) == 0;
+	const FTCHARToUTF8 Body(bIsMetrics ? *FCraftingMetrics::Get().Render() : TEXT("Not found\n"));
+	const FTCHARToUTF8 Header(*FString::Printf(TEXT("HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %d\r\nConnection: close\r\n\r\n"),
+		bIsMetrics ? TEXT("200 OK") : TEXT("404 Not Found"), Body.Length()));
+
+	int32 NumSent = 0;
+	Socket->Send((const uint8*)Header.Get(), Header.Length(), NumSent);
+	Socket->Send((const uint8*)Body.Get(), Body.Length(), NumSent);
+
+	Socket->Close();
+	ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+	return true;
+}
+
+void FCraftingMetricsExporter::Scrape(int32 Port)
+{
+	Async<void>(EAsyncExecution::ThreadPool, [Port]()
+	{
+		ISocketSubsystem* Sockets = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+		FSocket* Socket = Sockets->CreateSocket(NAME_Stream, TEXT("CraftingMetricsScrape"));
+		const FIPv4Endpoint Endpoint(FIPv4Address(127, 0, 0, 1), Port);
+
+		TArray<uint8> Response;
+		if (Socket != nullptr && Socket->Connect(*Endpoint.ToInternetAddr()))
+		{
+			const char* Request = "GET /metrics HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n";
+			int32 NumSent = 0;
+			Socket->Send((const uint8*)Request, FCStringAnsi::Strlen(Request), NumSent);
+
+			// the exporter closes the connection after the body
+			uint8 Chunk[4096];
+			int32 NumRead = 0;
+			while (Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromSeconds(2)) && Socket->Recv(Chunk, sizeof(Chunk), NumRead) && NumRead > 0)
+			{
+				Response.Append(Chunk, NumRead);
+			}
+		}
+		if (Socket != nullptr)
+		{
+			Socket->Close();
+			Sockets->DestroySocket(Socket);
+		}
+
+		Response.Add(0);
+		const FString Text = UTF8_TO_TCHAR((const ANSICHAR*)Response.GetData());
+		const bool bSuccess = Text.StartsWith(TEXT("HTTP/1.0 200")) && Text.Contains(TEXT("crafting_pickups_total"));
+
+		AsyncTask(ENamedThreads::GameThread, [Text, bSuccess, Endpoint]()
+		{
+			if (bSuccess)
+			{
+				UE_LOG(LogCrafting, Display, TEXT("Scraped %s:\n%s"), *Endpoint.ToString(), *Text);
+			}
+			else
+			{
+				UE_LOG(LogCrafting, Error, TEXT("Scraping %s failed: '%s'"), *Endpoint.ToString(), *Text);
+			}
+		});
+	});
+}
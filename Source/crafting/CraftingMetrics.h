@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "HAL/ThreadSafeCounter64.h"
+
+class FSocket;
+class FTcpListener;
+struct FIPv4Endpoint;
+
+/** Latency histogram with fixed buckets, recording is a single atomic add per counter */
+class FCraftingHistogram
+{
+public:
+	static const int32 NumBounds = 12;
+
+	/** Upper bounds of the buckets in microseconds, a last bucket takes everything above */
+	static const uint32 BoundsMicroseconds[NumBounds];
+
+	void ObserveCycles(uint32 Cycles);
+
+	/** Appends the histogram in the Prometheus text format */
+	void Render(FString& Out, const TCHAR* Name, const TCHAR* Help) const;
+
+private:
+	FThreadSafeCounter64 Buckets[NumBounds + 1];
+	FThreadSafeCounter64 Count;
+	FThreadSafeCounter64 SumNanoseconds;
+};
+
+/**
+ * Live counters of the crafting system. The game thread only bumps atomics, nothing locks and nothing
+ * allocates. Rendering reads the atomics from whatever thread serves the metrics.
+ */
+class FCraftingMetrics
+{
+public:
+	static FCraftingMetrics& Get();
+
+	FORCEINLINE void CountPickup() { Pickups.Increment(); }
+	FORCEINLINE void CountCraft() { Crafts.Increment(); }
+	FORCEINLINE void CountCallbackBroadcast() { CallbackBroadcasts.Increment(); }
+	FORCEINLINE void AddPickupActors(int32 Delta) { PickupActors.Add(Delta); }
+	FORCEINLINE void CountPickupPrediction(bool bConfirmed) { (bConfirmed ? PredictionsConfirmed : PredictionsRejected).Increment(); }
+
+	FORCEINLINE int64 GetCallbackBroadcasts() const { return CallbackBroadcasts.GetValue(); }
+
+	FCraftingHistogram InventoryMutations;
+
+	/** All metrics in the Prometheus text exposition format */
+	FString Render() const;
+
+private:
+	FThreadSafeCounter64 Pickups;
+	FThreadSafeCounter64 Crafts;
+	FThreadSafeCounter64 CallbackBroadcasts;
+	FThreadSafeCounter64 PickupActors;
+	FThreadSafeCounter64 PredictionsConfirmed;
+	FThreadSafeCounter64 PredictionsRejected;
+};
+
+/** Times the enclosing inventory mutation into FCraftingMetrics::InventoryMutations */
+struct FScopedInventoryMutationTimer
+{
+	FScopedInventoryMutationTimer() : StartCycles(FPlatformTime::Cycles()) {}
+	~FScopedInventoryMutationTimer() { FCraftingMetrics::Get().InventoryMutations.ObserveCycles(FPlatformTime::Cycles() - StartCycles); }
+
+	uint32 StartCycles;
+};
+
+/**
+ * Opt-in HTTP endpoint serving FCraftingMetrics on localhost, for the scrapers of the ops team.
+ *
+ *   -CraftingMetricsPort=<port>            starts it with the game
+ *   Crafting.Metrics.Start [port]          starts it from the console, Crafting.Metrics.Stop stops it
+ *   Crafting.Metrics.Scrape [port]         scrapes it like Prometheus would and logs the result
+ *
+ * Connections are accepted and answered on the listener thread, the game thread never waits on a socket.
+ */
+class FCraftingMetricsExporter
+{
+public:
+	static const int32 DefaultPort = 9464;
+
+	static bool Start(int32 Port);
+	static void Stop();
+	static bool IsRunning() { return Listener != nullptr; }
+
+	/** Requests /metrics from localhost on a pooled thread and checks the answer, the scraper stand-in */
+	static void Scrape(int32 Port);
+
+private:
+	static bool HandleConnection(FSocket* Socket, const FIPv4Endpoint& Endpoint);
+
+	static FTcpListener* Listener;
+};
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingLoadTestCommandlet.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/AutomationCommon.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** The scenarios create their own worlds, the minimal map only keeps the session around them quiet */
+static const TCHAR* CraftingPerfTestMap = TEXT("/Game/StarterContent/Maps/Minimal_Default");
+
+/** Runs the load test commandlet in process once the map is loaded, a non zero result fails the test */
+DEFINE_LATENT_AUTOMATION_COMMAND_TWO_PARAMETER(FRunCraftingLoadTestCommand, FAutomationTestBase*, Test, FString, Params);
+
+bool FRunCraftingLoadTestCommand::Update()
+{
+	UCraftingLoadTestCommandlet* Commandlet = NewObject<UCraftingLoadTestCommandlet>();
+
+	// the suite collects garbage between runs, the commandlet holds the loaded pickups and recipes
+	Commandlet->AddToRoot();
+	const int32 Result = Commandlet->Main(Params);
+	Commandlet->RemoveFromRoot();
+
+	if (Result != 0)
+	{
+		Test->AddError(FString::Printf(TEXT("CraftingLoadTest %s failed, see the log for the regressions"), *Params));
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCraftingPerfSuiteTest, "Crafting.Perf.Suite", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::PerfFilter)
+
+bool FCraftingPerfSuiteTest::RunTest(const FString& Parameters)
+{
+	AutomationOpenMap(CraftingPerfTestMap);
+	ADD_LATENT_AUTOMATION_COMMAND(FRunCraftingLoadTestCommand(this, TEXT("-Scenario=Suite")));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCraftingPerfScenariosTest, "Crafting.Perf.Scenarios", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::EngineFilter)
+
+bool FCraftingPerfScenariosTest::RunTest(const FString& Parameters)
+{
+	// every scenario once at a tiny scale, catches the ones that no longer run without comparing any numbers
+	static const TCHAR* Scenarios[] =
+	{
+		TEXT("-Scenario=Crafters -Players=10 -Seconds=1"),
+		TEXT("-Scenario=Wildcards -Stacks=50 -Iterations=10"),
+		TEXT("-Scenario=Craftability -Players=10 -NumRecipes=16 -Iterations=2"),
+		TEXT("-Scenario=Relevancy -Pickups=500 -Seconds=1"),
+		TEXT("-Scenario=Grid -GridWidth=10 -GridHeight=10 -Iterations=10"),
+		TEXT("-Scenario=Magnet -Burst=20 -Seconds=1"),
+		TEXT("-Scenario=Projectiles -Burst=10 -Bursts=2"),
+	};
+
+	AutomationOpenMap(CraftingPerfTestMap);
+	for (const TCHAR* Scenario : Scenarios)
+	{
+		ADD_LATENT_AUTOMATION_COMMAND(FRunCraftingLoadTestCommand(this, Scenario));
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingRecipe.h"
+#include "CraftingRecipeIndex.h"
+#include "CraftingRecipeValidator.h"
+#include "craftingCharacter.h"
+
+static FAutoConsoleCommand ReloadRecipesCommand(
+	TEXT("Crafting.ReloadRecipes"),
+	TEXT("Applies runtime edits of every loaded recipe book and refreshes the item definitions held by players"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		for (TObjectIterator<UCraftingRecipeBook> It; It; ++It)
+		{
+			It->ApplyRecipeChanges();
+		}
+		for (TObjectIterator<AcraftingCharacter> It; It; ++It)
+		{
+			if (!It->IsTemplate() && It->GetWorld() != nullptr && It->GetWorld()->IsGameWorld())
+			{
+				It->RefreshItemDefinitions();
+			}
+		}
+	}));
+
+const FCraftingRecipeIndex& UCraftingRecipeBook::GetIndex() const
+{
+	if (!Index.IsValid())
+	{
+		Index = MakeShareable(new FCraftingRecipeIndex());
+		Index->Build(Recipes);
+	}
+	return *Index;
+}
+
+SIZE_T UCraftingRecipeBook::GetIndexAllocatedSize() const
+{
+	return Index.IsValid() ? sizeof(FCraftingRecipeIndex) + Index->GetAllocatedSize() : 0;
+}
+
+void UCraftingRecipeBook::PostLoad()
+{
+	Super::PostLoad();
+
+#if WITH_EDITOR
+	// broken data shows up as soon as the book is opened, unchanged books are answered from the stored result
+	if (GIsEditor && !IsTemplate() && !IsRunningCommandlet())
+	{
+		FCraftingRecipeValidator::ValidateBook(this);
+	}
+#endif
+}
+
+#if WITH_EDITOR
+void UCraftingRecipeBook::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// also edits made while playing in the editor, players pick them up without a restart
+	ApplyRecipeChanges();
+}
+#endif
+
+void UCraftingRecipeBook::ApplyRecipeChanges()
+{
+	// nothing was derived from the recipes yet, the first lookup builds from the current ones
+	if (!Index.IsValid())
+	{
+		return;
+	}
+
+	const double StartSeconds = FPlatformTime::Seconds();
+	const TArray<int32> Changed = Index->Update(Recipes);
+	if (Changed.Num() > 0)
+	{
+		UE_LOG(LogCrafting, Log, TEXT("%s: reindexed %d of %d recipes in %.2f ms"), *GetName(), Changed.Num(), Recipes.Num(), (FPlatformTime::Seconds() - StartSeconds) * 1000.0);
+		RecipesChanged.Broadcast(Changed);
+	}
+}
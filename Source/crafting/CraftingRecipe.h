@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Engine/DataAsset.h"
+#include "PickupCommon.h"
+#include "CraftingRecipe.generated.h"
+
+UENUM(BlueprintType)
+enum class EIngredientMatch : uint8
+{
+	Class		UMETA(DisplayName = "Exact class"),
+	Category	UMETA(DisplayName = "Any item of a category"),
+	AnyCommon	UMETA(DisplayName = "Any common item"),
+	AnyRare		UMETA(DisplayName = "Any rare item"),
+	Any			UMETA(DisplayName = "Any item")
+};
+
+USTRUCT(BlueprintType)
+struct FRecipeIngredient
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Recipe")
+		EIngredientMatch Match = EIngredientMatch::Class;
+
+	/** Used when Match is Class */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Recipe")
+		TSubclassOf<class APickupObject> Class;
+
+	/** Used when Match is Category */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Recipe")
+		ECommonType Category = ECommonType::Alcohol;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Recipe")
+		int Number = 1;
+};
+
+/** Native counterpart of the S_Recipe blueprint struct */
+USTRUCT(BlueprintType)
+struct FCraftingRecipe
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Recipe")
+		TArray<FRecipeIngredient> Ingredients;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Recipe")
+		TSubclassOf<class APickupObject> Result;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Recipe")
+		int ResultNumber = 1;
+
+	/** Seconds a crafting station needs for one craft, 0 crafts instantly */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Recipe")
+		float CraftTime = 0;
+
+	/** On the crafting table a shaped recipe only matches when the items are placed like Pattern */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Recipe")
+		bool bShaped = false;
+
+	/** Row major cells of the shape, None is an empty cell. Empty rows and columns around the shape do not matter */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Recipe", meta = (EditCondition = "bShaped"))
+		TArray<TSubclassOf<class APickupObject>> Pattern;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Recipe", meta = (EditCondition = "bShaped", ClampMin = "1"))
+		int PatternWidth = 3;
+
+	/** The left-right mirror image of Pattern matches as well */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Recipe", meta = (EditCondition = "bShaped"))
+		bool bAllowMirrored = false;
+};
+
+UCLASS(BlueprintType)
+class CRAFTING_API UCraftingRecipeBook : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Recipe")
+		TArray<FCraftingRecipe> Recipes;
+
+	DECLARE_EVENT_OneParam(UCraftingRecipeBook, FOnRecipesChanged, const TArray<int32>&);
+
+	/** Pattern lookup of the crafting table, built on first use and shared by everyone using the book */
+	const class FCraftingRecipeIndex& GetIndex() const;
+
+	/**
+	 * Brings the index up to date with edits made to Recipes at runtime, only the changed recipes are reindexed.
+	 * Broadcasts OnRecipesChanged with their indices when there were any.
+	 */
+	void ApplyRecipeChanges();
+
+	/** Called with the indices of the recipes that changed, so users of the book can refresh what they derived from them */
+	FOnRecipesChanged& OnRecipesChanged() { return RecipesChanged; }
+
+	/** Heap memory of the index, 0 while it was not built */
+	SIZE_T GetIndexAllocatedSize() const;
+
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+	mutable TSharedPtr<class FCraftingRecipeIndex> Index;
+
+	FOnRecipesChanged RecipesChanged;
+};
@@ -0,0 +1,282 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingRecipeIndex.h"
+#include "PickupObject.h"
+
+FCraftingPattern FCraftingPattern::MakeShaped(const TArray<TSubclassOf<APickupObject>>& Grid, int32 GridWidth)
+{
+	FCraftingPattern Pattern;
+	if (GridWidth <= 0)
+	{
+		Pattern.UpdateHash();
+		return Pattern;
+	}
+
+	// bounding box of the placed items, a partial last row counts as empty cells
+	const int32 GridHeight = (Grid.Num() + GridWidth - 1) / GridWidth;
+	int32 MinX = GridWidth, MaxX = -1, MinY = GridHeight, MaxY = -1;
+	for (int32 i = 0; i < Grid.Num(); i++)
+	{
+		if (Grid[i] != nullptr)
+		{
+			const int32 X = i % GridWidth;
+			const int32 Y = i / GridWidth;
+			MinX = FMath::Min(MinX, X);
+			MaxX = FMath::Max(MaxX, X);
+			MinY = FMath::Min(MinY, Y);
+			MaxY = FMath::Max(MaxY, Y);
+		}
+	}
+
+	if (MaxX >= 0)
+	{
+		check(MaxX - MinX < MAX_uint8 && MaxY - MinY < MAX_uint8);
+		Pattern.Width = MaxX - MinX + 1;
+		Pattern.Height = MaxY - MinY + 1;
+		Pattern.Cells.Reserve(Pattern.Width * Pattern.Height);
+		for (int32 Y = MinY; Y <= MaxY; Y++)
+		{
+			for (int32 X = MinX; X <= MaxX; X++)
+			{
+				const int32 Cell = Y * GridWidth + X;
+				Pattern.Cells.Add(Cell < Grid.Num() ? *Grid[Cell] : nullptr);
+			}
+		}
+	}
+
+	Pattern.UpdateHash();
+	return Pattern;
+}
+
+FCraftingPattern FCraftingPattern::MakeShapeless(const TArray<TSubclassOf<APickupObject>>& Grid)
+{
+	FCraftingPattern Pattern;
+	for (const TSubclassOf<APickupObject>& Cell : Grid)
+	{
+		if (Cell != nullptr)
+		{
+			Pattern.Cells.Add(Cell);
+		}
+	}
+
+	// the order only has to be the same within one run, the pattern tables are never saved
+	Pattern.Cells.Sort([](const UClass& A, const UClass& B) { return &A < &B; });
+	Pattern.UpdateHash();
+	return Pattern;
+}
+
+FCraftingPattern FCraftingPattern::Mirrored() const
+{
+	FCraftingPattern Pattern(*this);
+	for (int32 Y = 0; Y < Height; Y++)
+	{
+		UClass** Row = Pattern.Cells.GetData() + Y * Width;
+		for (int32 X = 0; X < Width / 2; X++)
+		{
+			Swap(Row[X], Row[Width - 1 - X]);
+		}
+	}
+	Pattern.UpdateHash();
+	return Pattern;
+}
+
+void FCraftingPattern::UpdateHash()
+{
+	Hash = FCrc::MemCrc32(Cells.GetData(), Cells.Num() * sizeof(UClass*), Width | (Height << 8));
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FCraftingRecipeIndex
+
+void FCraftingRecipeIndex::Build(const TArray<FCraftingRecipe>& Recipes)
+{
+	ShapedPatterns.Reset();
+	ShapelessPatterns.Reset();
+	ShadowedPatterns.Reset();
+	for (int32 i = 0; i < Recipes.Num(); i++)
+	{
+		Add(i, Recipes[i]);
+	}
+	IndexedRecipes = Recipes;
+}
+
+TArray<int32> FCraftingRecipeIndex::Update(const TArray<FCraftingRecipe>& Recipes)
+{
+	UScriptStruct* RecipeStruct = FCraftingRecipe::StaticStruct();
+	TArray<int32> Changed;
+	for (int32 i = 0; i < FMath::Max(Recipes.Num(), IndexedRecipes.Num()); i++)
+	{
+		if (!Recipes.IsValidIndex(i) || !IndexedRecipes.IsValidIndex(i) || !RecipeStruct->CompareScriptStruct(&Recipes[i], &IndexedRecipes[i], PPF_None))
+		{
+			Changed.Add(i);
+		}
+	}
+
+	// all removals first, a changed recipe may take over a pattern another changed recipe gives up
+	for (int32 RecipeIndex : Changed)
+	{
+		if (IndexedRecipes.IsValidIndex(RecipeIndex))
+		{
+			Remove(RecipeIndex, IndexedRecipes[RecipeIndex]);
+		}
+	}
+	for (int32 RecipeIndex : Changed)
+	{
+		if (Recipes.IsValidIndex(RecipeIndex))
+		{
+			Add(RecipeIndex, Recipes[RecipeIndex]);
+		}
+	}
+
+	IndexedRecipes = Recipes;
+	return Changed;
+}
+
+void FCraftingRecipeIndex::Add(int32 RecipeIndex, const FCraftingRecipe& Recipe)
+{
+	if (Recipe.bShaped)
+	{
+		FCraftingPattern Pattern = FCraftingPattern::MakeShaped(Recipe.Pattern, Recipe.PatternWidth);
+		if (Pattern.IsEmpty())
+		{
+			return;
+		}
+
+		if (Recipe.bAllowMirrored)
+		{
+			FCraftingPattern MirroredPattern = Pattern.Mirrored();
+			// symmetric shapes mirror onto themselves
+			if (!(MirroredPattern == Pattern))
+			{
+				AddPattern(ShapedPatterns, MoveTemp(MirroredPattern), RecipeIndex);
+			}
+		}
+		AddPattern(ShapedPatterns, MoveTemp(Pattern), RecipeIndex);
+	}
+	else
+	{
+		FCraftingPattern Pattern = MakeShapelessPattern(Recipe);
+		if (!Pattern.IsEmpty())
+		{
+			AddPattern(ShapelessPatterns, MoveTemp(Pattern), RecipeIndex);
+		}
+	}
+}
+
+void FCraftingRecipeIndex::Remove(int32 RecipeIndex, const FCraftingRecipe& Recipe)
+{
+	if (Recipe.bShaped)
+	{
+		const FCraftingPattern Pattern = FCraftingPattern::MakeShaped(Recipe.Pattern, Recipe.PatternWidth);
+		RemovePattern(ShapedPatterns, Pattern, RecipeIndex);
+		if (Recipe.bAllowMirrored)
+		{
+			RemovePattern(ShapedPatterns, Pattern.Mirrored(), RecipeIndex);
+		}
+	}
+	else
+	{
+		RemovePattern(ShapelessPatterns, MakeShapelessPattern(Recipe), RecipeIndex);
+	}
+}
+
+int32 FCraftingRecipeIndex::FindTableRecipe(const TArray<TSubclassOf<APickupObject>>& Grid, int32 GridWidth) const
+{
+	const FCraftingPattern Shaped = FCraftingPattern::MakeShaped(Grid, GridWidth);
+	if (Shaped.IsEmpty())
+	{
+		return INDEX_NONE;
+	}
+
+	if (const int32* RecipeIndex = ShapedPatterns.Find(Shaped))
+	{
+		return *RecipeIndex;
+	}
+
+	const int32* RecipeIndex = ShapelessPatterns.Find(FCraftingPattern::MakeShapeless(Grid));
+	return RecipeIndex != nullptr ? *RecipeIndex : INDEX_NONE;
+}
+
+SIZE_T FCraftingRecipeIndex::GetAllocatedSize() const
+{
+	SIZE_T Size = ShapedPatterns.GetAllocatedSize() + ShapelessPatterns.GetAllocatedSize() + ShadowedPatterns.GetAllocatedSize() + IndexedRecipes.GetAllocatedSize();
+	for (const TMap<FCraftingPattern, int32>* Patterns : { &ShapedPatterns, &ShapelessPatterns })
+	{
+		for (const TPair<FCraftingPattern, int32>& Pair : *Patterns)
+		{
+			Size += Pair.Key.Cells.GetAllocatedSize();
+		}
+	}
+	for (const FCraftingRecipe& Recipe : IndexedRecipes)
+	{
+		Size += Recipe.Ingredients.GetAllocatedSize() + Recipe.Pattern.GetAllocatedSize();
+	}
+	return Size;
+}
+
+FCraftingPattern FCraftingRecipeIndex::MakeShapelessPattern(const FCraftingRecipe& Recipe)
+{
+	// one table cell holds one item, recipes with category or wildcard slots are left to the recipe list
+	TArray<TSubclassOf<APickupObject>> Items;
+	for (const FRecipeIngredient& Ingredient : Recipe.Ingredients)
+	{
+		if (Ingredient.Match != EIngredientMatch::Class || Ingredient.Class == nullptr)
+		{
+			return FCraftingPattern();
+		}
+		for (int32 i = 0; i < Ingredient.Number; i++)
+		{
+			Items.Add(Ingredient.Class);
+		}
+	}
+	return FCraftingPattern::MakeShapeless(Items);
+}
+
+void FCraftingRecipeIndex::AddPattern(TMap<FCraftingPattern, int32>& Patterns, FCraftingPattern&& Pattern, int32 RecipeIndex)
+{
+	int32* Existing = Patterns.Find(Pattern);
+	if (Existing == nullptr)
+	{
+		Patterns.Add(MoveTemp(Pattern), RecipeIndex);
+		return;
+	}
+	if (*Existing == RecipeIndex)
+	{
+		return;
+	}
+
+	// the lower recipe index keeps the pattern, the other one can never be made on the table
+	UE_LOG(LogCrafting, Warning, TEXT("Recipe %d has the same table pattern as recipe %d"), FMath::Max(RecipeIndex, *Existing), FMath::Min(RecipeIndex, *Existing));
+	if (RecipeIndex < *Existing)
+	{
+		Swap(RecipeIndex, *Existing);
+	}
+	ShadowedPatterns.AddUnique(Pattern, RecipeIndex);
+}
+
+void FCraftingRecipeIndex::RemovePattern(TMap<FCraftingPattern, int32>& Patterns, const FCraftingPattern& Pattern, int32 RecipeIndex)
+{
+	int32* Existing = Patterns.Find(Pattern);
+	if (Existing == nullptr)
+	{
+		return;
+	}
+	if (*Existing != RecipeIndex)
+	{
+		ShadowedPatterns.RemoveSingle(Pattern, RecipeIndex);
+		return;
+	}
+
+	// hand the pattern to the lowest recipe that was shadowed by this one
+	TArray<int32> Shadowed;
+	ShadowedPatterns.MultiFind(Pattern, Shadowed);
+	if (Shadowed.Num() == 0)
+	{
+		Patterns.Remove(Pattern);
+		return;
+	}
+	const int32 NextOwner = FMath::Min(Shadowed);
+	ShadowedPatterns.RemoveSingle(Pattern, NextOwner);
+	*Existing = NextOwner;
+}
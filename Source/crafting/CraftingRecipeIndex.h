@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CraftingRecipe.h"
+
+/**
+ * Normalized content of a crafting table grid. Shaped patterns are trimmed to the bounding box of the
+ * placed items, so the same shape anywhere on the table gives the same cells. Shapeless patterns only
+ * keep the sorted item classes. The hash is computed once, lookups then only compare on a hit.
+ */
+struct FCraftingPattern
+{
+	uint8 Width;
+	uint8 Height;
+	TArray<UClass*, TInlineAllocator<9>> Cells;
+	uint32 Hash;
+
+	FCraftingPattern() : Width(0), Height(0), Hash(0) {}
+
+	static FCraftingPattern MakeShaped(const TArray<TSubclassOf<class APickupObject>>& Grid, int32 GridWidth);
+	static FCraftingPattern MakeShapeless(const TArray<TSubclassOf<class APickupObject>>& Grid);
+
+	/** Left-right mirror image of a shaped pattern */
+	FCraftingPattern Mirrored() const;
+
+	bool IsEmpty() const { return Cells.Num() == 0; }
+
+	bool operator==(const FCraftingPattern& Other) const
+	{
+		return Hash == Other.Hash && Width == Other.Width && Height == Other.Height && Cells == Other.Cells;
+	}
+
+	friend uint32 GetTypeHash(const FCraftingPattern& Pattern) { return Pattern.Hash; }
+
+private:
+	void UpdateHash();
+};
+
+/**
+ * Precomputed pattern tables of a recipe book for the crafting table. Every shaped recipe is stored under its
+ * normalized pattern (and the mirrored one when allowed), every shapeless recipe without wildcards under the
+ * sorted list of its ingredients. Resolving a grid normalizes it once and does one hash lookup per table,
+ * however many recipes the book holds. Shaped recipes win over shapeless ones with the same items.
+ *
+ * When two recipes share a pattern the lower recipe index owns it and the other one is kept aside,
+ * so removing the owner hands the pattern to the next recipe just like a full Build would.
+ */
+class FCraftingRecipeIndex
+{
+public:
+	void Build(const TArray<FCraftingRecipe>& Recipes);
+
+	/**
+	 * Reindexes only the recipes that differ from the ones indexed by Build or the last Update, compared slot by slot.
+	 * Returns the indices of the changed recipes, inserting a recipe in the middle changes every slot after it.
+	 */
+	TArray<int32> Update(const TArray<FCraftingRecipe>& Recipes);
+
+	void Add(int32 RecipeIndex, const FCraftingRecipe& Recipe);
+	void Remove(int32 RecipeIndex, const FCraftingRecipe& Recipe);
+
+	/** Index of the recipe the items on the grid form, INDEX_NONE when they form none */
+	int32 FindTableRecipe(const TArray<TSubclassOf<class APickupObject>>& Grid, int32 GridWidth) const;
+
+	int32 GetNumShaped() const { return ShapedPatterns.Num(); }
+	int32 GetNumShapeless() const { return ShapelessPatterns.Num(); }
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	static FCraftingPattern MakeShapelessPattern(const FCraftingRecipe& Recipe);
+	void AddPattern(TMap<FCraftingPattern, int32>& Patterns, FCraftingPattern&& Pattern, int32 RecipeIndex);
+	void RemovePattern(TMap<FCraftingPattern, int32>& Patterns, const FCraftingPattern& Pattern, int32 RecipeIndex);
+
+	TMap<FCraftingPattern, int32> ShapedPatterns;
+	TMap<FCraftingPattern, int32> ShapelessPatterns;
+
+	/** Recipes whose pattern is owned by a lower recipe index, shaped and shapeless patterns never compare equal */
+	TMultiMap<FCraftingPattern, int32> ShadowedPatterns;
+
+	/** Copy of the recipes the index was built from, Update compares against it */
+	TArray<FCraftingRecipe> IndexedRecipes;
+};
@@ -0,0 +1,285 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingRecipeMatcher.h"
+#include "InventoryCategoryIndex.h"
+#include "craftingCharacter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Recipe Match"), STAT_RecipeMatch, STATGROUP_Crafting);
+
+/** Keeps rare stacks out of wildcard slots whenever common ones can fill them */
+static const int64 RareStackCost = 1 << 24;
+
+namespace
+{
+	/** Small successive shortest path min cost flow, the graphs here have a few slots and at most one node per stack */
+	class FMinCostFlow
+	{
+	public:
+		explicit FMinCostFlow(int32 NumNodes)
+		{
+			Head.Init(INDEX_NONE, NumNodes);
+		}
+
+		int32 AddEdge(int32 From, int32 To, int32 Capacity, int64 Cost)
+		{
+			const int32 Index = Edges.Num();
+			Edges.Add(FEdge{ To, Head[From], Capacity, Cost });
+			Head[From] = Index;
+			Edges.Add(FEdge{ From, Head[To], 0, -Cost });
+			Head[To] = Index + 1;
+			return Index;
+		}
+
+		/** Pushes up to MaxFlow from Source to Sink, returns how much got through */
+		int32 Run(int32 Source, int32 Sink, int32 MaxFlow)
+		{
+			const int32 NumNodes = Head.Num();
+			TArray<int64> Distance;
+			TArray<int32> ParentEdge;
+			TArray<bool> InQueue;
+			TArray<int32> Queue;
+
+			int32 Flow = 0;
+			while (Flow < MaxFlow)
+			{
+				Distance.Init(MAX_int64, NumNodes);
+				ParentEdge.Init(INDEX_NONE, NumNodes);
+				InQueue.Init(false, NumNodes);
+				Queue.Reset();
+
+				// SPFA, residual edges carry negative costs so plain Dijkstra does not apply
+				Distance[Source] = 0;
+				Queue.Add(Source);
+				InQueue[Source] = true;
+				for (int32 QueueIndex = 0; QueueIndex < Queue.Num(); QueueIndex++)
+				{
+					const int32 Node = Queue[QueueIndex];
+					InQueue[Node] = false;
+					for (int32 EdgeIndex = Head[Node]; EdgeIndex != INDEX_NONE; EdgeIndex = Edges[EdgeIndex].Next)
+					{
+						const FEdge& Edge = Edges[EdgeIndex];
+						if (Edge.Capacity > 0 && Distance[Node] + Edge.Cost < Distance[Edge.To])
+						{
+							Distance[Edge.To] = Distance[Node] + Edge.Cost;
+							ParentEdge[Edge.To] = EdgeIndex;
+							if (!InQueue[Edge.To])
+							{
+								InQueue[Edge.To] = true;
+								Queue.Add(Edge.To);
+							}
+						}
+					}
+				}
+
+				if (ParentEdge[Sink] == INDEX_NONE)
+				{
+					break;
+				}
+
+				int32 Bottleneck = MaxFlow - Flow;
+				for (int32 Node = Sink; Node != Source; Node = Edges[ParentEdge[Node] ^ 1].To)
+				{
+					Bottleneck = FMath::Min(Bottleneck, Edges[ParentEdge[Node]].Capacity);
+				}
+				for (int32 Node = Sink; Node != Source; Node = Edges[ParentEdge[Node] ^ 1].To)
+				{
+					Edges[ParentEdge[Node]].Capacity -= Bottleneck;
+					Edges[ParentEdge[Node] ^ 1].Capacity += Bottleneck;
+				}
+				Flow += Bottleneck;
+			}
+			return Flow;
+		}
+
+		/** Flow pushed through an edge returned by AddEdge */
+		int32 GetFlow(int32 EdgeIndex) const
+		{
+			return Edges[EdgeIndex ^ 1].Capacity;
+		}
+
+	private:
+		struct FEdge
+		{
+			int32 To;
+			int32 Next;
+			int32 Capacity;
+			int64 Cost;
+		};
+
+		TArray<FEdge> Edges;
+		TArray<int32> Head;
+	};
+}
+
+bool FRecipeMatcher::HasWildcards(const FCraftingRecipe& Recipe)
+{
+	return Recipe.Ingredients.ContainsByPredicate([](const FRecipeIngredient& Ingredient) { return Ingredient.Match != EIngredientMatch::Class; });
+}
+
+bool FRecipeMatcher::Accepts(const FRecipeIngredient& Ingredient, const FPickupItem& Item, ECommonType ItemCategory)
+{
+	switch (Ingredient.Match)
+	{
+	case EIngredientMatch::Class:
+		return Item.Class == Ingredient.Class;
+	case EIngredientMatch::Category:
+		return ItemCategory == Ingredient.Category;
+	case EIngredientMatch::AnyCommon:
+		return ItemCategory != ECommonType::Count;
+	case EIngredientMatch::AnyRare:
+		return Item.IsRare;
+	case EIngredientMatch::Any:
+		return true;
+	}
+	return false;
+}
+
+bool FRecipeMatcher::Match(const FCraftingRecipe& Recipe, const TArray<FPickupItem>& Items, int32 Count, TArray<FInventoryDelta>* OutConsumed)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RecipeMatch);
+
+	const int32 NumSlots = Recipe.Ingredients.Num();
+	if (NumSlots == 0 || Count <= 0)
+	{
+		return false;
+	}
+
+	// only stacks some slot accepts take part, and each slot must see enough items on its own
+	TArray<int32> Candidates;
+	TArray<uint32> AcceptedBy;
+	TArray<int64> SlotSupply;
+	SlotSupply.AddZeroed(NumSlots);
+	int32 LargestStack = 0;
+
+	for (int32 ItemIndex = 0; ItemIndex < Items.Num(); ItemIndex++)
+	{
+		const FPickupItem& Item = Items[ItemIndex];
+		const ECommonType ItemCategory = FInventoryCategoryIndex::GetCategory(Item.Class);
+		uint32 Mask = 0;
+		for (int32 Slot = 0; Slot < NumSlots && Slot < 32; Slot++)
+		{
+			if (Accepts(Recipe.Ingredients[Slot], Item, ItemCategory))
+			{
+				Mask |= 1u << Slot;
+				SlotSupply[Slot] += Item.Number;
+			}
+		}
+		if (Mask != 0 && Item.Number > 0)
+		{
+			Candidates.Add(ItemIndex);
+			AcceptedBy.Add(Mask);
+			LargestStack = FMath::Max(LargestStack, Item.Number);
+		}
+	}
+
+	int64 Required = 0;
+	for (int32 Slot = 0; Slot < NumSlots; Slot++)
+	{
+		const int64 Needed = (int64)Recipe.Ingredients[Slot].Number * Count;
+		if (NumSlots > 32 || SlotSupply[Slot] < Needed)
+		{
+			return false;
+		}
+		Required += Needed;
+	}
+	if (Required > MAX_int32)
+	{
+		return false;
+	}
+
+	const int32 Source = 0;
+	const int32 FirstStack = 1 + NumSlots;
+	const int32 Sink = FirstStack + Candidates.Num();
+	FMinCostFlow Flow(Sink + 1);
+
+	for (int32 Slot = 0; Slot < NumSlots; Slot++)
+	{
+		Flow.AddEdge(Source, 1 + Slot, Recipe.Ingredients[Slot].Number * Count, 0);
+	}
+
+	TArray<int32> StackEdges;
+	for (int32 Candidate = 0; Candidate < Candidates.Num(); Candidate++)
+	{
+		const FPickupItem& Item = Items[Candidates[Candidate]];
+		const int64 Cost = (Item.IsRare ? RareStackCost : 0) + (LargestStack - Item.Number);
+		for (int32 Slot = 0; Slot < NumSlots; Slot++)
+		{
+			if (AcceptedBy[Candidate] & (1u << Slot))
+			{
+				Flow.AddEdge(1 + Slot, FirstStack + Candidate, Item.Number, Cost);
+			}
+		}
+		StackEdges.Add(Flow.AddEdge(FirstStack + Candidate, Sink, Item.Number, 0));
+	}
+
+	if (Flow.Run(Source, Sink, (int32)Required) < Required)
+	{
+		return false;
+	}
+
+	if (OutConsumed != nullptr)
+	{
+		for (int32 Candidate = 0; Candidate < Candidates.Num(); Candidate++)
+		{
+			const int32 Used = Flow.GetFlow(StackEdges[Candidate]);
+			if (Used > 0)
+			{
+				OutConsumed->Add(FInventoryDelta{ Items[Candidates[Candidate]].Class, -Used });
+			}
+		}
+	}
+	return true;
+}
+
+void FRecipeMatcher::GetRequiredPerClass(const FCraftingRecipe& Recipe, TMap<UClass*, int32>& OutNeeded)
+{
+	OutNeeded.Reset();
+	for (const FRecipeIngredient& Ingredient : Recipe.Ingredients)
+	{
+		if (Ingredient.Number > 0)
+		{
+			OutNeeded.FindOrAdd(Ingredient.Class) += Ingredient.Number;
+		}
+	}
+}
+
+int32 FRecipeMatcher::GetMaxCraftCount(const FCraftingRecipe& Recipe, const TArray<FPickupItem>& Items)
+{
+	if (Recipe.Ingredients.Num() == 0)
+	{
+		return 0;
+	}
+
+	int64 NeededPerCraft = 0;
+	for (const FRecipeIngredient& Ingredient : Recipe.Ingredients)
+	{
+		NeededPerCraft += Ingredient.Number;
+	}
+	int64 Held = 0;
+	for (const FPickupItem& Item : Items)
+	{
+		Held += Item.Number;
+	}
+	if (NeededPerCraft <= 0)
+	{
+		return 0;
+	}
+
+	// feasibility only gets harder with more crafts, so binary search the largest feasible count
+	int32 Low = 0;
+	int32 High = (int32)FMath::Min<int64>(Held / NeededPerCraft, MAX_int32);
+	while (Low < High)
+	{
+		const int32 Mid = Low + (High - Low + 1) / 2;
+		if (Match(Recipe, Items, Mid, nullptr))
+		{
+			Low = Mid;
+		}
+		else
+		{
+			High = Mid - 1;
+		}
+	}
+	return Low;
+}
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CraftingRecipe.h"
+
+struct FPickupItem;
+struct FInventoryDelta;
+
+/**
+ * Assigns inventory stacks to the ingredient slots of a recipe.
+ *
+ * Category and wildcard slots compete for the same stacks, so trying combinations blows up quickly.
+ * The assignment is solved as a min cost flow instead: source -> slot (capacity = needed items),
+ * slot -> every stack it accepts, stack -> sink (capacity = items in the stack). Rare stacks are
+ * expensive and among the common ones the largest stacks are cheapest, so crafting eats the items
+ * the player has most of and keeps the rare ones.
+ */
+class FRecipeMatcher
+{
+public:
+	static bool HasWildcards(const FCraftingRecipe& Recipe);
+
+	static bool Accepts(const FRecipeIngredient& Ingredient, const FPickupItem& Item, ECommonType ItemCategory);
+
+	/** Finds the items to consume for Count crafts, OutConsumed gets one negative delta per used stack */
+	static bool Match(const FCraftingRecipe& Recipe, const TArray<FPickupItem>& Items, int32 Count, TArray<FInventoryDelta>* OutConsumed);
+
+	/** Total items needed per class for one craft of an exact class recipe, a class listed in several slots is summed */
+	static void GetRequiredPerClass(const FCraftingRecipe& Recipe, TMap<UClass*, int32>& OutNeeded);
+
+	/** How many times the recipe can be crafted from Items */
+	static int32 GetMaxCraftCount(const FCraftingRecipe& Recipe, const TArray<FPickupItem>& Items);
+};
@@ -0,0 +1,561 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingRecipeValidator.h"
+#include "CraftingRecipeIndex.h"
+#include "CraftingRecipeMatcher.h"
+#include "InventoryCategoryIndex.h"
+#include "craftingCharacter.h"
+#include "Async/ParallelFor.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+
+DECLARE_CYCLE_STAT(TEXT("Recipe Validation"), STAT_RecipeValidation, STATGROUP_Crafting);
+
+static FAutoConsoleCommand ValidateRecipesCommand(
+	TEXT("Crafting.ValidateRecipes"),
+	TEXT("Checks every loaded recipe book for dependency cycles, unreachable items, dangling classes and duplicate recipes"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		for (TObjectIterator<UCraftingRecipeBook> It; It; ++It)
+		{
+			if (!It->IsTemplate())
+			{
+				FCraftingRecipeValidator::ValidateBook(*It);
+			}
+		}
+	}));
+
+/** Changes whenever the checks change, so results stored by older checks are not reused */
+static const TCHAR* ValidatorVersion = TEXT("1");
+
+/** Deleted blueprints leave TRASHCLASS_ and REINST_ classes behind, recompiled ones an outdated class */
+static bool IsDangling(const UClass* Class)
+{
+	if (Class->HasAnyClassFlags(CLASS_NewerVersionExists) || !Class->IsChildOf(APickupObject::StaticClass()))
+	{
+		return true;
+	}
+	const FString Name = Class->GetName();
+	return Name.StartsWith(TEXT("TRASHCLASS_")) || Name.StartsWith(TEXT("REINST_"));
+}
+
+/** Ingredient slot in comparable form, laid out without padding so whole arrays compare and hash as memory */
+struct FIngredientKey
+{
+	UClass* Class;
+	int32 Number;
+	int32 Kind;
+};
+static_assert(sizeof(FIngredientKey) == sizeof(UClass*) + 2 * sizeof(int32), "FIngredientKey must not have padding");
+
+/** What a recipe takes, two recipes with the same signature are ambiguous whatever they make */
+struct FRecipeSignature
+{
+	TArray<FIngredientKey> Ingredients;
+	FCraftingPattern Pattern;
+	uint32 Hash = 0;
+
+	bool operator==(const FRecipeSignature& Other) const
+	{
+		return Hash == Other.Hash && Pattern == Other.Pattern && Ingredients.Num() == Other.Ingredients.Num()
+			&& FMemory::Memcmp(Ingredients.GetData(), Other.Ingredients.GetData(), Ingredients.GetTypeSize() * Ingredients.Num()) == 0;
+	}
+};
+
+/** Kinds of wildcard slots, Category slots get one kind per category */
+static int32 GetWildcardKind(const FRecipeIngredient& Ingredient)
+{
+	return Ingredient.Match == EIngredientMatch::Category ? (int32)EIngredientMatch::Any + 1 + (int32)Ingredient.Category : (int32)Ingredient.Match;
+}
+static const int32 NumWildcardKinds = (int32)EIngredientMatch::Any + 1 + (int32)ECommonType::Count;
+
+/** Per recipe part of the validation, runs on any thread */
+static void CheckRecipe(int32 RecipeIndex, const FCraftingRecipe& Recipe, TArray<FString>& OutErrors, FRecipeSignature& OutSignature)
+{
+	if (Recipe.Result == nullptr)
+	{
+		OutErrors.Add(FString::Printf(TEXT("Recipe %d makes nothing, its result class is missing"), RecipeIndex));
+	}
+	else if (IsDangling(Recipe.Result))
+	{
+		OutErrors.Add(FString::Printf(TEXT("Recipe %d makes %s, which is deleted or outdated"), RecipeIndex, *Recipe.Result->GetName()));
+	}
+	if (Recipe.ResultNumber <= 0)
+	{
+		OutErrors.Add(FString::Printf(TEXT("Recipe %d makes %d items"), RecipeIndex, Recipe.ResultNumber));
+	}
+
+	for (int32 i = 0; i < Recipe.Ingredients.Num(); i++)
+	{
+		const FRecipeIngredient& Ingredient = Recipe.Ingredients[i];
+		if (Ingredient.Number <= 0)
+		{
+			OutErrors.Add(FString::Printf(TEXT("Recipe %d ingredient %d takes %d items"), RecipeIndex, i, Ingredient.Number));
+		}
+		if (Ingredient.Match != EIngredientMatch::Class)
+		{
+			OutSignature.Ingredients.Add(FIngredientKey{ nullptr, Ingredient.Number, GetWildcardKind(Ingredient) });
+		}
+		else if (Ingredient.Class == nullptr)
+		{
+			OutErrors.Add(FString::Printf(TEXT("Recipe %d ingredient %d references no class, it was probably deleted"), RecipeIndex, i));
+		}
+		else if (IsDangling(Ingredient.Class))
+		{
+			OutErrors.Add(FString::Printf(TEXT("Recipe %d ingredient %d references %s, which is deleted or outdated"), RecipeIndex, i, *Ingredient.Class->GetName()));
+		}
+		else
+		{
+			OutSignature.Ingredients.Add(FIngredientKey{ Ingredient.Class, Ingredient.Number, 0 });
+		}
+	}
+
+	if (Recipe.bShaped)
+	{
+		for (int32 Cell = 0; Cell < Recipe.Pattern.Num(); Cell++)
+		{
+			if (Recipe.Pattern[Cell] != nullptr && IsDangling(Recipe.Pattern[Cell]))
+			{
+				OutErrors.Add(FString::Printf(TEXT("Recipe %d pattern cell %d references %s, which is deleted or outdated"), RecipeIndex, Cell, *Recipe.Pattern[Cell]->GetName()));
+			}
+		}
+		OutSignature.Pattern = FCraftingPattern::MakeShaped(Recipe.Pattern, Recipe.PatternWidth);
+		if (OutSignature.Pattern.IsEmpty())
+		{
+			OutErrors.Add(FString::Printf(TEXT("Recipe %d is shaped but its pattern is empty"), RecipeIndex));
+		}
+	}
+	else if (Recipe.Ingredients.Num() == 0)
+	{
+		OutErrors.Add(FString::Printf(TEXT("Recipe %d has no ingredients"), RecipeIndex));
+	}
+
+	// slots of the same class or kind are one slot with the summed number
+	TArray<FIngredientKey>& Keys = OutSignature.Ingredients;
+	Keys.Sort([](const FIngredientKey& A, const FIngredientKey& B)
+	{
+		return A.Class != B.Class ? A.Class < B.Class : A.Kind < B.Kind;
+	});
+	for (int32 i = Keys.Num() - 1; i > 0; i--)
+	{
+		if (Keys[i].Class == Keys[i - 1].Class && Keys[i].Kind == Keys[i - 1].Kind)
+		{
+			Keys[i - 1].Number += Keys[i].Number;
+			Keys.RemoveAt(i, 1, false);
+		}
+	}
+	OutSignature.Hash = HashCombine(FCrc::MemCrc32(Keys.GetData(), Keys.GetTypeSize() * Keys.Num()), OutSignature.Pattern.Hash);
+}
+
+FRecipeValidationResult FCraftingRecipeValidator::Run(const TArray<FCraftingRecipe>& Recipes)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RecipeValidation);
+
+	const int32 NumRecipes = Recipes.Num();
+	FRecipeValidationResult Result;
+
+	// per recipe checks, independent of each other
+	TArray<TArray<FString>> RecipeErrors;
+	TArray<FRecipeSignature> Signatures;
+	RecipeErrors.SetNum(NumRecipes);
+	Signatures.SetNum(NumRecipes);
+	ParallelFor(NumRecipes, [&](int32 RecipeIndex)
+	{
+		CheckRecipe(RecipeIndex, Recipes[RecipeIndex], RecipeErrors[RecipeIndex], Signatures[RecipeIndex]);
+	});
+	for (TArray<FString>& Errors : RecipeErrors)
+	{
+		Result.Errors.Append(MoveTemp(Errors));
+	}
+
+	TMultiMap<uint32, int32> SignatureRecipes;
+	for (int32 RecipeIndex = 0; RecipeIndex < NumRecipes; RecipeIndex++)
+	{
+		TArray<int32> SameHash;
+		SignatureRecipes.MultiFind(Signatures[RecipeIndex].Hash, SameHash);
+		for (int32 Other : SameHash)
+		{
+			if (Signatures[Other] == Signatures[RecipeIndex])
+			{
+				Result.Errors.Add(FString::Printf(TEXT("Recipes %d and %d take the same ingredients, only one of them can ever be crafted from the table"), Other, RecipeIndex));
+				break;
+			}
+		}
+		SignatureRecipes.Add(Signatures[RecipeIndex].Hash, RecipeIndex);
+	}
+
+	// item dependency graph, an edge leads from every ingredient class to the result of the recipe
+	TMap<UClass*, int32> NodeIds;
+	TArray<UClass*> Nodes;
+	auto GetNode = [&NodeIds, &Nodes](UClass* Class)
+	{
+		if (Class == nullptr || IsDangling(Class))
+		{
+			return (int32)INDEX_NONE;
+		}
+		if (const int32* Id = NodeIds.Find(Class))
+		{
+			return *Id;
+		}
+		NodeIds.Add(Class, Nodes.Num());
+		return Nodes.Add(Class);
+	};
+
+	struct FRecipeNode
+	{
+		int32 Result;
+		TArray<int32> Inputs;
+		TArray<FRecipeIngredient> Wildcards;
+		bool bBroken;
+	};
+	TArray<FRecipeNode> RecipeNodes;
+	RecipeNodes.SetNum(NumRecipes);
+	for (int32 RecipeIndex = 0; RecipeIndex < NumRecipes; RecipeIndex++)
+	{
+		const FCraftingRecipe& Recipe = Recipes[RecipeIndex];
+		FRecipeNode& Node = RecipeNodes[RecipeIndex];
+		Node.Result = GetNode(Recipe.Result);
+		Node.bBroken = RecipeErrors[RecipeIndex].Num() > 0 || Node.Result == INDEX_NONE;
+
+		for (const FRecipeIngredient& Ingredient : Recipe.Ingredients)
+		{
+			if (Ingredient.Match == EIngredientMatch::Class)
+			{
+				const int32 Input = GetNode(Ingredient.Class);
+				Node.bBroken |= Input == INDEX_NONE;
+				Node.Inputs.AddUnique(Input);
+			}
+			else
+			{
+				Node.Wildcards.Add(Ingredient);
+			}
+		}
+		if (Recipe.bShaped)
+		{
+			for (const TSubclassOf<APickupObject>& Cell : Recipe.Pattern)
+			{
+				if (Cell != nullptr)
+				{
+					Node.Inputs.AddUnique(GetNode(Cell));
+				}
+			}
+		}
+		Node.Inputs.Remove(INDEX_NONE);
+	}
+
+	const int32 NumNodes = Nodes.Num();
+	TArray<TArray<int32>> Edges;
+	TArray<int32> NumProducers;
+	Edges.SetNum(NumNodes);
+	NumProducers.SetNumZeroed(NumNodes);
+	for (const FRecipeNode& Node : RecipeNodes)
+	{
+		if (Node.Result == INDEX_NONE)
+		{
+			continue;
+		}
+		++NumProducers[Node.Result];
+		for (int32 Input : Node.Inputs)
+		{
+			Edges[Input].AddUnique(Node.Result);
+		}
+	}
+
+	// cycles are the strongly connected components with more than one item or an item needing itself (Tarjan)
+	{
+		struct FFrame
+		{
+			int32 Node;
+			int32 Edge;
+		};
+		TArray<int32> Order;
+		TArray<int32> LowLink;
+		TBitArray<> OnStack(false, NumNodes);
+		TArray<int32> Stack;
+		TArray<FFrame> CallStack;
+		Order.Init(INDEX_NONE, NumNodes);
+		LowLink.Init(INDEX_NONE, NumNodes);
+		int32 Counter = 0;
+
+		auto Visit = [&](int32 Node)
+		{
+			Order[Node] = LowLink[Node] = Counter++;
+			Stack.Add(Node);
+			OnStack[Node] = true;
+			CallStack.Add(FFrame{ Node, 0 });
+		};
+
+		for (int32 Root = 0; Root < NumNodes; Root++)
+		{
+			if (Order[Root] != INDEX_NONE)
+			{
+				continue;
+			}
+			Visit(Root);
+			while (CallStack.Num() > 0)
+			{
+				const int32 Node = CallStack.Last().Node;
+				const int32 Edge = CallStack.Last().Edge++;
+				if (Edge < Edges[Node].Num())
+				{
+					const int32 Next = Edges[Node][Edge];
+					if (Order[Next] == INDEX_NONE)
+					{
+						Visit(Next);
+					}
+					else if (OnStack[Next])
+					{
+						LowLink[Node] = FMath::Min(LowLink[Node], Order[Next]);
+					}
+					continue;
+				}
+
+				CallStack.Pop(false);
+				if (CallStack.Num() > 0)
+				{
+					const int32 Parent = CallStack.Last().Node;
+					LowLink[Parent] = FMath::Min(LowLink[Parent], LowLink[Node]);
+				}
+				if (LowLink[Node] != Order[Node])
+				{
+					continue;
+				}
+
+				TArray<FString> Names;
+				int32 Member;
+				do
+				{
+					Member = Stack.Pop(false);
+					OnStack[Member] = false;
+					Names.Add(Nodes[Member]->GetName());
+				} while (Member != Node);
+
+				if (Names.Num() > 1 || Edges[Node].Contains(Node))
+				{
+					Result.Warnings.Add(FString::Printf(TEXT("Items are crafted from each other: %s"), *FString::Join(Names, TEXT(", "))));
+				}
+			}
+		}
+	}
+
+	// items no recipe makes have to come from the world, everything else has to be craftable from them
+	TBitArray<> Reachable(false, NumNodes);
+	TArray<FPickupItem> NodeItems;
+	TArray<ECommonType> NodeCategories;
+	for (int32 Node = 0; Node < NumNodes; Node++)
+	{
+		Reachable[Node] = NumProducers[Node] == 0;
+		NodeItems.Add(AcraftingCharacter::MakePickupItem(Nodes[Node], 1));
+		NodeCategories.Add(FInventoryCategoryIndex::GetCategory(Nodes[Node]));
+	}
+
+	TArray<int32> Pending;
+	for (int32 RecipeIndex = 0; RecipeIndex < NumRecipes; RecipeIndex++)
+	{
+		if (!RecipeNodes[RecipeIndex].bBroken)
+		{
+			Pending.Add(RecipeIndex);
+		}
+	}
+
+	TArray<uint8> CraftableNow;
+	bool bReachedNew = true;
+	while (bReachedNew && Pending.Num() > 0)
+	{
+		// which wildcard slots some reachable item fills, FRecipeMatcher decides what a slot accepts
+		bool WildcardFilled[NumWildcardKinds] = {};
+		for (int32 Kind = (int32)EIngredientMatch::Category; Kind < NumWildcardKinds; Kind++)
+		{
+			FRecipeIngredient Slot;
+			Slot.Match = Kind > (int32)EIngredientMatch::Any ? EIngredientMatch::Category : (EIngredientMatch)Kind;
+			Slot.Category = Kind > (int32)EIngredientMatch::Any ? (ECommonType)(Kind - (int32)EIngredientMatch::Any - 1) : ECommonType::Alcohol;
+			for (TConstSetBitIterator<> It(Reachable); It && !WildcardFilled[Kind]; ++It)
+			{
+				WildcardFilled[Kind] = FRecipeMatcher::Accepts(Slot, NodeItems[It.GetIndex()], NodeCategories[It.GetIndex()]);
+			}
+		}
+
+		CraftableNow.Reset();
+		CraftableNow.SetNumZeroed(Pending.Num());
+		ParallelFor(Pending.Num(), [&](int32 i)
+		{
+			const FRecipeNode& Node = RecipeNodes[Pending[i]];
+			for (int32 Input : Node.Inputs)
+			{
+				if (!Reachable[Input])
+				{
+					return;
+				}
+			}
+			for (const FRecipeIngredient& Wildcard : Node.Wildcards)
+			{
+				if (Wildcard.Match == EIngredientMatch::Category && Wildcard.Category >= ECommonType::Count)
+				{
+					return;
+				}
+				if (!WildcardFilled[GetWildcardKind(Wildcard)])
+				{
+					return;
+				}
+			}
+			CraftableNow[i] = 1;
+		});
+
+		bReachedNew = false;
+		for (int32 i = Pending.Num() - 1; i >= 0; i--)
+		{
+			if (CraftableNow[i])
+			{
+				const int32 ResultNode = RecipeNodes[Pending[i]].Result;
+				bReachedNew |= !Reachable[ResultNode];
+				Reachable[ResultNode] = true;
+				Pending.RemoveAtSwap(i, 1, false);
+			}
+		}
+	}
+
+	for (int32 Node = 0; Node < NumNodes; Node++)
+	{
+		if (!Reachable[Node])
+		{
+			Result.Warnings.Add(FString::Printf(TEXT("%s can never be crafted, all %d recipes making it need items that cannot be obtained"), *Nodes[Node]->GetName(), NumProducers[Node]));
+		}
+	}
+
+	return Result;
+}
+
+FRecipeValidationResult FCraftingRecipeValidator::Validate(const TArray<FCraftingRecipe>& Recipes)
+{
+	const FString DataHash = ComputeDataHash(Recipes);
+
+	FRecipeValidationResult Result;
+	if (LoadCached(DataHash, Result))
+	{
+		return Result;
+	}
+
+	Result = Run(Recipes);
+	Result.DataHash = DataHash;
+	SaveCached(Result);
+	return Result;
+}
+
+bool FCraftingRecipeValidator::ValidateBook(const UCraftingRecipeBook* Book)
+{
+	const double StartSeconds = FPlatformTime::Seconds();
+	const FRecipeValidationResult Result = Validate(Book->Recipes);
+
+	UE_LOG(LogCrafting, Display, TEXT("%s: %d recipes, %d errors, %d warnings, %s in %.1f ms"), *Book->GetName(), Book->Recipes.Num(),
+		Result.Errors.Num(), Result.Warnings.Num(), Result.bFromCache ? TEXT("unchanged since the last validation") : TEXT("validated"),
+		(FPlatformTime::Seconds() - StartSeconds) * 1000.0);
+
+	// thousands of messages help nobody, the first ones show what is going on
+	const int32 MaxMessages = 100;
+	for (int32 i = 0; i < FMath::Min(Result.Errors.Num(), MaxMessages); i++)
+	{
+		UE_LOG(LogCrafting, Error, TEXT("  %s"), *Result.Errors[i]);
+	}
+	for (int32 i = 0; i < FMath::Min(Result.Warnings.Num(), MaxMessages); i++)
+	{
+		UE_LOG(LogCrafting, Warning, TEXT("  %s"), *Result.Warnings[i]);
+	}
+	if (Result.Errors.Num() > MaxMessages || Result.Warnings.Num() > MaxMessages)
+	{
+		UE_LOG(LogCrafting, Display, TEXT("  only the first %d errors and warnings are listed, all of them are in %s"), MaxMessages, *GetCachePath(Result.DataHash));
+	}
+	return Result.IsValid();
+}
+
+FString FCraftingRecipeValidator::ComputeDataHash(const TArray<FCraftingRecipe>& Recipes)
+{
+	// the exported text names classes by path, so renaming or replacing a class changes the hash as well
+	FSHA1 Sha;
+	Sha.UpdateWithString(ValidatorVersion, FCString::Strlen(ValidatorVersion));
+	UScriptStruct* RecipeStruct = FCraftingRecipe::StaticStruct();
+	FString Text;
+	TArray<UClass*> Classes;
+	for (const FCraftingRecipe& Recipe : Recipes)
+	{
+		Text.Reset();
+		RecipeStruct->ExportText(Text, &Recipe, nullptr, nullptr, PPF_None, nullptr);
+		Sha.UpdateWithString(*Text, Text.Len() + 1);
+
+		Classes.AddUnique(Recipe.Result);
+		for (const FRecipeIngredient& Ingredient : Recipe.Ingredients)
+		{
+			Classes.AddUnique(Ingredient.Class);
+		}
+		for (TSubclassOf<APickupObject> Cell : Recipe.Pattern)
+		{
+			Classes.AddUnique(Cell);
+		}
+	}
+
+	// category and rarity decide which wildcards an item fills, editing them on a class changes the results too
+	for (UClass* ItemClass : Classes)
+	{
+		if (ItemClass == nullptr)
+		{
+			continue;
+		}
+		uint8 Traits[2] = { (uint8)FInventoryCategoryIndex::GetCategory(ItemClass), (uint8)ItemClass->GetDefaultObject<APickupObject>()->IsRare() };
+		Sha.Update(Traits, sizeof(Traits));
+	}
+	Sha.Final();
+
+	uint8 Digest[FSHA1::DigestSize];
+	Sha.GetHash(Digest);
+	return BytesToHex(Digest, FSHA1::DigestSize);
+}
+
+FString FCraftingRecipeValidator::GetCachePath(const FString& DataHash)
+{
+	return FPaths::GameSavedDir() / TEXT("RecipeValidation") / (DataHash + TEXT(".txt"));
+}
+
+bool FCraftingRecipeValidator::LoadCached(const FString& DataHash, FRecipeValidationResult& OutResult)
+{
+	FString Text;
+	if (!FFileHelper::LoadFileToString(Text, *GetCachePath(DataHash)))
+	{
+		return false;
+	}
+
+	// one message per line, E for errors and W for warnings
+	TArray<FString> Lines;
+	Text.ParseIntoArrayLines(Lines);
+	for (const FString& Line : Lines)
+	{
+		if (Line.StartsWith(TEXT("E ")))
+		{
+			OutResult.Errors.Add(Line.Mid(2));
+		}
+		else if (Line.StartsWith(TEXT("W ")))
+		{
+			OutResult.Warnings.Add(Line.Mid(2));
+		}
+	}
+	OutResult.DataHash = DataHash;
+	OutResult.bFromCache = true;
+	return true;
+}
+
+void FCraftingRecipeValidator::SaveCached(const FRecipeValidationResult& Result)
+{
+	FString Text;
+	for (const FString& Error : Result.Errors)
+	{
+		Text += TEXT("E ") + Error + LINE_TERMINATOR;
+	}
+	for (const FString& Warning : Result.Warnings)
+	{
+		Text += TEXT("W ") + Warning + LINE_TERMINATOR;
+	}
+	if (!FFileHelper::SaveStringToFile(Text, *GetCachePath(Result.DataHash)))
+	{
+		UE_LOG(LogCrafting, Warning, TEXT("Could not store the recipe validation result in %s"), *GetCachePath(Result.DataHash));
+	}
+}
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CraftingRecipe.h"
+
+struct FRecipeValidationResult
+{
+	/** Hash of the recipe data the result belongs to */
+	FString DataHash;
+
+	/** Dangling classes, recipes without ingredients or result and duplicate recipes */
+	TArray<FString> Errors;
+
+	/** Dependency cycles and items that can never be crafted */
+	TArray<FString> Warnings;
+
+	bool bFromCache = false;
+
+	bool IsValid() const { return Errors.Num() == 0; }
+};
+
+/**
+ * Checks recipe books for broken data.
+ *
+ * The per recipe checks (dangling or missing classes, empty recipes, the signature used to find duplicates) run
+ * in parallel over all recipes. The item dependency graph (ingredient -> result) is then searched for cycles,
+ * and reachability is propagated from the items no recipe makes, evaluating all pending recipes of a round
+ * in parallel. Results are stored in Saved/RecipeValidation under a hash of the recipe data, so a book that
+ * did not change since it was validated last is not validated again, not even after an editor restart.
+ *
+ * Books are validated when the editor loads them and by Crafting.ValidateRecipes for every loaded book.
+ */
+class FCraftingRecipeValidator
+{
+public:
+	/** Validates the recipes, or returns the stored result when the same data was validated before */
+	static FRecipeValidationResult Validate(const TArray<FCraftingRecipe>& Recipes);
+
+	/** Validates and logs the result under the name of the book */
+	static bool ValidateBook(const UCraftingRecipeBook* Book);
+
+	/** Hash of the recipes and of the category and rarity of every class they reference */
+	static FString ComputeDataHash(const TArray<FCraftingRecipe>& Recipes);
+
+private:
+	static FRecipeValidationResult Run(const TArray<FCraftingRecipe>& Recipes);
+
+	static FString GetCachePath(const FString& DataHash);
+	static bool LoadCached(const FString& DataHash, FRecipeValidationResult& OutResult);
+	static void SaveCached(const FRecipeValidationResult& Result);
+};
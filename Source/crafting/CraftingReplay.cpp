@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingReplay.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+FCraftingReplay::FCraftingReplay(float InStartTime)
+	: StartTime(InStartTime)
+{
+}
+
+void FCraftingReplay::Add(float WorldTime, ECraftingReplayEvent Type, UClass* ItemClass, int32 Value)
+{
+	uint16 ItemIndex = FCraftingReplayEvent::NoItem;
+	if (ItemClass != nullptr)
+	{
+		if (uint16* Existing = ItemIndices.Find(ItemClass))
+		{
+			ItemIndex = *Existing;
+		}
+		else if (ItemClasses.Num() < FCraftingReplayEvent::NoItem)
+		{
+			ItemIndex = ItemClasses.Add(ItemClass->GetPathName());
+			ItemIndices.Add(ItemClass, ItemIndex);
+		}
+	}
+
+	Events.Add(FCraftingReplayEvent{ WorldTime - StartTime, Type, ItemIndex, Value });
+}
+
+FString FCraftingReplay::GetReplayPath(const FString& Name)
+{
+	return FPaths::GameSavedDir() / TEXT("Replays") / (Name + TEXT(".ccr"));
+}
+
+void FCraftingReplay::Serialize(FArchive& Ar, uint16 FileVersion)
+{
+	Ar << ItemClasses;
+
+	int32 NumEvents = Events.Num();
+	Ar << NumEvents;
+	if (Ar.IsLoading())
+	{
+		// every event takes seven bytes, eleven since it has a value
+		const int64 EventSize = FileVersion >= 2 ? 11 : 7;
+		if (NumEvents < 0 || (int64)NumEvents * EventSize > Ar.TotalSize() - Ar.Tell())
+		{
+			Ar.SetError();
+			return;
+		}
+		Events.SetNum(NumEvents);
+	}
+
+	for (FCraftingReplayEvent& Event : Events)
+	{
+		uint8 Type = (uint8)Event.Type;
+		Ar << Event.Time << Type << Event.ItemIndex;
+		Event.Type = (ECraftingReplayEvent)Type;
+		if (FileVersion >= 2)
+		{
+			Ar << Event.Value;
+		}
+		else
+		{
+			Event.Value = 0;
+		}
+
+		if (Ar.IsLoading() && Event.ItemIndex != FCraftingReplayEvent::NoItem && Event.ItemIndex >= ItemClasses.Num())
+		{
+			Ar.SetError();
+			return;
+		}
+	}
+}
+
+bool FCraftingReplay::Save(const FString& Path)
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	uint32 FileMagic = Magic;
+	uint16 FileVersion = Version;
+	Writer << FileMagic << FileVersion;
+	Serialize(Writer, FileVersion);
+	return FFileHelper::SaveArrayToFile(Data, *Path);
+}
+
+bool FCraftingReplay::Load(const FString& Path)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *Path))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+	uint32 FileMagic = 0;
+	uint16 FileVersion = 0;
+	Reader << FileMagic << FileVersion;
+	if (Reader.IsError() || FileMagic != Magic || FileVersion > Version)
+	{
+		return false;
+	}
+
+	Serialize(Reader, FileVersion);
+	return !Reader.IsError();
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+enum class ECraftingReplayEvent : uint8
+{
+	Pickup,					// IncreaseItemNumber
+	AddItem,				// IncreaseItemNumberS
+	RemovePickup,			// DecreaseItemNumber
+	RemoveItem,				// DecreaseItemNumberS
+	ToggleInventory,
+	SwitchToRecipeList,
+	SwitchToCraftingTable,
+	QueueCraft,				// ingredients a station took from the player, Value is the negative count
+	JobResult,				// results of finished station jobs, Value is the count
+	SetCraftTableCell,		// Value is the cell index, no item empties the cell
+	ClearCraftTable,		// Value is 1 when the items went back to the inventory
+	CraftFromTable,
+	Undo,
+	Redo
+};
+
+struct FCraftingReplayEvent
+{
+	/** Seconds since the recording started */
+	float Time;
+	ECraftingReplayEvent Type;
+	/** Index into FCraftingReplay::ItemClasses, NoItem for events without one */
+	uint16 ItemIndex;
+	/** Count or cell of the event, 0 for the ones without */
+	int32 Value;
+
+	static const uint16 NoItem = MAX_uint16;
+};
+
+/**
+ * Timestamped sequence of the gameplay events driving the inventory and crafting UI of one player,
+ * recorded in game and played back deterministically by the CraftingReplay commandlet.
+ */
+class FCraftingReplay
+{
+public:
+	static const uint32 Magic = 0x50524343; // 'CCRP'
+	static const uint16 Version = 2;
+
+	explicit FCraftingReplay(float InStartTime = 0);
+
+	void Add(float WorldTime, ECraftingReplayEvent Type, UClass* ItemClass = nullptr, int32 Value = 0);
+
+	bool Save(const FString& Path);
+	bool Load(const FString& Path);
+
+	static FString GetReplayPath(const FString& Name);
+
+	TArray<FString> ItemClasses;
+	TArray<FCraftingReplayEvent> Events;
+
+private:
+	void Serialize(FArchive& Ar, uint16 FileVersion);
+
+	float StartTime;
+	TMap<UClass*, uint16> ItemIndices;
+};
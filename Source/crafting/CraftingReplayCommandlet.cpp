@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingReplayCommandlet.h"
+#include "CraftingReplay.h"
+#include "craftingCharacter.h"
+#include "GameFramework/WorldSettings.h"
+#include "Misc/FileHelper.h"
+
+static const TCHAR* ReplayEventNames[] = { TEXT("Pickup"), TEXT("AddItem"), TEXT("RemovePickup"), TEXT("RemoveItem"),
+	TEXT("ToggleInventory"), TEXT("SwitchToRecipeList"), TEXT("SwitchToCraftingTable"), TEXT("QueueCraft"), TEXT("JobResult"),
+	TEXT("SetCraftTableCell"), TEXT("ClearCraftTable"), TEXT("CraftFromTable"), TEXT("Undo"), TEXT("Redo") };
+
+UCraftingReplayCommandlet::UCraftingReplayCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UCraftingReplayCommandlet::Main(const FString& Params)
+{
+	FString ReplayName;
+	if (!FParse::Value(*Params, TEXT("Replay="), ReplayName))
+	{
+		UE_LOG(LogCrafting, Error, TEXT("Usage: -run=CraftingReplay -Replay=<name or path> [-Report=<out.txt>] [-FrameRate=<fps>] [-Pawn=<class path>]"));
+		return 1;
+	}
+
+	FCraftingReplay Replay;
+	const FString ReplayPath = FPaths::FileExists(ReplayName) ? ReplayName : FCraftingReplay::GetReplayPath(ReplayName);
+	if (!Replay.Load(ReplayPath))
+	{
+		UE_LOG(LogCrafting, Error, TEXT("Could not read replay '%s'"), *ReplayPath);
+		return 1;
+	}
+
+	TArray<TSubclassOf<APickupObject>> ItemClasses;
+	for (const FString& ClassPath : Replay.ItemClasses)
+	{
+		UClass* ItemClass = StaticLoadClass(APickupObject::StaticClass(), nullptr, *ClassPath);
+		if (ItemClass == nullptr)
+		{
+			UE_LOG(LogCrafting, Warning, TEXT("Item class '%s' is gone, its events are skipped"), *ClassPath);
+		}
+		ItemClasses.Add(ItemClass);
+	}
+
+	// the blueprint pawn brings the real inventory widgets along, the native class only measures the C++ side
+	FString PawnPath = TEXT("/Game/FirstPersonCPP/Blueprints/FirstPersonCharacter.FirstPersonCharacter_C");
+	FParse::Value(*Params, TEXT("Pawn="), PawnPath);
+	UClass* PawnClass = StaticLoadClass(AcraftingCharacter::StaticClass(), nullptr, *PawnPath);
+	if (PawnClass == nullptr)
+	{
+		PawnClass = AcraftingCharacter::StaticClass();
+	}
+
+	float FrameRate = 60.0f;
+	FParse::Value(*Params, TEXT("FrameRate="), FrameRate);
+	const float DeltaSeconds = 1.0f / FMath::Max(1.0f, FrameRate);
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	World->GetWorldSettings()->NotifyBeginPlay();
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AcraftingCharacter* Player = World->SpawnActor<AcraftingCharacter>(PawnClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
+
+	TArray<uint32> FrameCycles;
+	uint64 EventCycles[ARRAY_COUNT(ReplayEventNames)] = { 0 };
+	int32 EventCounts[ARRAY_COUNT(ReplayEventNames)] = { 0 };
+
+	// keep ticking a second past the last event so the UI animations it started are measured too
+	const float EndTime = (Replay.Events.Num() > 0 ? Replay.Events.Last().Time : 0.0f) + 1.0f;
+	int32 NextEvent = 0;
+	float Time = 0;
+
+	while (Time < EndTime)
+	{
+		const uint32 FrameStart = FPlatformTime::Cycles();
+
+		while (NextEvent < Replay.Events.Num() && Replay.Events[NextEvent].Time <= Time)
+		{
+			const FCraftingReplayEvent& Event = Replay.Events[NextEvent++];
+			const uint8 Type = (uint8)Event.Type;
+			if (Type >= ARRAY_COUNT(ReplayEventNames))
+			{
+				continue;
+			}
+
+			TSubclassOf<APickupObject> ItemClass = Event.ItemIndex != FCraftingReplayEvent::NoItem ? ItemClasses[Event.ItemIndex] : nullptr;
+			if (Event.ItemIndex != FCraftingReplayEvent::NoItem && ItemClass == nullptr)
+			{
+				continue;
+			}
+
+			const uint32 EventStart = FPlatformTime::Cycles();
+			Player->PlayReplayEvent(Event.Type, ItemClass, Event.Value);
+			EventCycles[Type] += FPlatformTime::Cycles() - EventStart;
+			++EventCounts[Type];
+		}
+
+		World->Tick(LEVELTICK_All, DeltaSeconds);
+		// undo steps are grouped by frame, nothing else advances the counter in a commandlet
+		++GFrameCounter;
+		FrameCycles.Add(FPlatformTime::Cycles() - FrameStart);
+		Time += DeltaSeconds;
+	}
+
+	// order independent checksum of the final inventory, it has to match between builds
+	uint32 InventoryChecksum = 0;
+	for (const FPickupItem& Item : Player->GetCurrentItems())
+	{
+		InventoryChecksum ^= HashCombine(GetTypeHash(Item.Class->GetPathName()), GetTypeHash(Item.Number));
+	}
+
+	TArray<uint32> Sorted = FrameCycles;
+	Sorted.Sort();
+	uint64 TotalCycles = 0;
+	for (uint32 Cycles : Sorted)
+	{
+		TotalCycles += Cycles;
+	}
+	auto FrameMs = [&Sorted](double Percentile)
+	{
+		return Sorted.Num() > 0 ? FPlatformTime::ToMilliseconds(Sorted[FMath::Min(Sorted.Num() - 1, (int32)(Percentile * Sorted.Num()))]) : 0.0f;
+	};
+
+	FString Report;
+	Report += FString::Printf(TEXT("replay = %s\n"), *ReplayPath);
+	Report += FString::Printf(TEXT("pawn = %s\n"), *PawnClass->GetName());
+	Report += FString::Printf(TEXT("events = %d\n"), Replay.Events.Num());
+	Report += FString::Printf(TEXT("frames = %d\n"), FrameCycles.Num());
+	Report += FString::Printf(TEXT("frame_ms_mean = %.4f\n"), Sorted.Num() > 0 ? FPlatformTime::ToMilliseconds((uint32)(TotalCycles / Sorted.Num())) : 0.0f);
+	Report += FString::Printf(TEXT("frame_ms_p50 = %.4f\n"), FrameMs(0.5));
+	Report += FString::Printf(TEXT("frame_ms_p95 = %.4f\n"), FrameMs(0.95));
+	Report += FString::Printf(TEXT("frame_ms_p99 = %.4f\n"), FrameMs(0.99));
+	Report += FString::Printf(TEXT("frame_ms_max = %.4f\n"), FrameMs(1.0));
+	for (int32 i = 0; i < ARRAY_COUNT(ReplayEventNames); i++)
+	{
+		const double MeanUs = EventCounts[i] > 0 ? FPlatformTime::ToMilliseconds((uint32)(EventCycles[i] / EventCounts[i])) * 1000.0 : 0.0;
+		Report += FString::Printf(TEXT("event_%s_count = %d\n"), ReplayEventNames[i], EventCounts[i]);
+		Report += FString::Printf(TEXT("event_%s_us_mean = %.3f\n"), ReplayEventNames[i], MeanUs);
+	}
+	Report += FString::Printf(TEXT("inventory_stacks = %d\n"), Player->GetCurrentItems().Num());
+	Report += FString::Printf(TEXT("inventory_checksum = %08x\n"), InventoryChecksum);
+
+	UE_LOG(LogCrafting, Display, TEXT("%s"), *Report);
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	FString ReportPath;
+	if (FParse::Value(*Params, TEXT("Report="), ReportPath) && !FFileHelper::SaveStringToFile(Report, *ReportPath))
+	{
+		UE_LOG(LogCrafting, Error, TEXT("Could not write '%s'"), *ReportPath);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "CraftingReplayCommandlet.generated.h"
+
+/**
+ * Plays a recorded crafting replay back in a headless world with a fixed time step.
+ *
+ *   -run=CraftingReplay -Replay=<name or path> [-Report=<out.txt>] [-FrameRate=<fps>] [-Pawn=<character class path>]
+ *
+ * The report holds frame time percentiles, the cost of every event type and a checksum of the final
+ * inventory, one "key = value" per line so reports of two builds can be diffed directly.
+ */
+UCLASS()
+class UCraftingReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UCraftingReplayCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,183 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingStation.h"
+#include "CraftingRecipe.h"
+#include "CraftingJobScheduler.h"
+#include "CraftingRecipeMatcher.h"
+#include "craftingCharacter.h"
+#include "craftingGameMode.h"
+
+ACraftingStation::ACraftingStation()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	Recipes = nullptr;
+	MaxQueuedJobs = 100;
+	QueuedJobs = 0;
+}
+
+bool ACraftingStation::QueueCraft(AcraftingCharacter* Crafter, int RecipeIndex, int Count)
+{
+	AcraftingGameMode* GameMode = GetWorld()->GetAuthGameMode<AcraftingGameMode>();
+	FCraftingJobScheduler* Scheduler = GameMode != nullptr ? GameMode->GetCraftingJobs() : nullptr;
+	if (Crafter == nullptr || Recipes == nullptr || Scheduler == nullptr || !Recipes->Recipes.IsValidIndex(RecipeIndex))
+	{
+		return false;
+	}
+
+	const FCraftingRecipe& Recipe = Recipes->Recipes[RecipeIndex];
+	Count = FMath::Min3(Count, MaxQueuedJobs - QueuedJobs, GetRecipeCraftCount(Crafter, Recipe));
+	if (Count <= 0 || !ConsumeIngredients(Crafter, Recipe, Count))
+	{
+		return false;
+	}
+
+	FCraftingJob Job;
+	Job.Station = this;
+	Job.Crafter = Crafter;
+	Job.Result = Recipe.Result;
+	Job.ResultNumber = Recipe.ResultNumber;
+	Job.StationId = GetUniqueID();
+	Job.CraftTime = Recipe.CraftTime;
+
+	for (int i = 0; i < Count; i++)
+	{
+		Scheduler->Submit(Job, GetWorld()->GetTimeSeconds());
+	}
+	QueuedJobs += Count;
+	return true;
+}
+
+int ACraftingStation::GetQueuedJobs() const
+{
+	return QueuedJobs;
+}
+
+void ACraftingStation::OnJobFinished()
+{
+	--QueuedJobs;
+}
+
+void ACraftingStation::BeginPlay()
+{
+	Super::BeginPlay();
+
+	for (AStorageContainer* Container : LinkedContainers)
+	{
+		Storage.AddContainer(Container);
+	}
+}
+
+void ACraftingStation::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Storage.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ACraftingStation::LinkContainer(AStorageContainer* Container)
+{
+	Storage.AddContainer(Container);
+}
+
+void ACraftingStation::UnlinkContainer(AStorageContainer* Container)
+{
+	Storage.RemoveContainer(Container);
+}
+
+int ACraftingStation::GetMaxCraftCount(AcraftingCharacter* Crafter, int RecipeIndex) const
+{
+	return Crafter != nullptr && Recipes != nullptr && Recipes->Recipes.IsValidIndex(RecipeIndex) ? GetRecipeCraftCount(Crafter, Recipes->Recipes[RecipeIndex]) : 0;
+}
+
+int32 ACraftingStation::GetRecipeCraftCount(const AcraftingCharacter* Crafter, const FCraftingRecipe& Recipe) const
+{
+	if (Storage.GetContainers().Num() == 0)
+	{
+		return Crafter->GetMaxCraftCount(Recipe);
+	}
+	if (FRecipeMatcher::HasWildcards(Recipe))
+	{
+		return FRecipeMatcher::GetMaxCraftCount(Recipe, GetCombinedItems(Crafter));
+	}
+
+	TMap<UClass*, int32> Needed;
+	FRecipeMatcher::GetRequiredPerClass(Recipe, Needed);
+
+	int32 MaxCount = MAX_int32;
+	for (const TPair<UClass*, int32>& Pair : Needed)
+	{
+		MaxCount = FMath::Min(MaxCount, (Crafter->GetItemNumber(Pair.Key) + Storage.GetItemNumber(Pair.Key)) / Pair.Value);
+	}
+	return Recipe.Ingredients.Num() > 0 ? MaxCount : 0;
+}
+
+bool ACraftingStation::ConsumeIngredients(AcraftingCharacter* Crafter, const FCraftingRecipe& Recipe, int32 Count)
+{
+	TArray<FInventoryDelta> Consumed;
+	if (!FRecipeMatcher::Match(Recipe, GetCombinedItems(Crafter), Count, &Consumed))
+	{
+		return false;
+	}
+
+	// the matcher picked stacks of the combined view, only the totals per class matter from here on
+	TMap<UClass*, int32> Needed;
+	for (const FInventoryDelta& Delta : Consumed)
+	{
+		Needed.FindOrAdd(Delta.Class) -= Delta.Number;
+	}
+
+	// plan the whole consumption before touching any source, so a failure leaves everything as it was
+	const TArray<TWeakObjectPtr<AStorageContainer>>& Containers = Storage.GetContainers();
+	TArray<FInventoryDelta> CrafterDeltas;
+	TArray<TArray<FInventoryDelta>> ContainerDeltas;
+	ContainerDeltas.SetNum(Containers.Num());
+
+	for (const TPair<UClass*, int32>& Pair : Needed)
+	{
+		int32 Remaining = Pair.Value;
+		const int32 FromCrafter = FMath::Min(Remaining, Crafter->GetItemNumber(Pair.Key));
+		if (FromCrafter > 0)
+		{
+			CrafterDeltas.Add(FInventoryDelta{ Pair.Key, -FromCrafter });
+			Remaining -= FromCrafter;
+		}
+
+		for (int32 i = 0; i < Containers.Num() && Remaining > 0; i++)
+		{
+			const AStorageContainer* Container = Containers[i].Get();
+			const int32 FromContainer = Container != nullptr ? FMath::Min(Remaining, Container->GetItemNumber(Pair.Key)) : 0;
+			if (FromContainer > 0)
+			{
+				ContainerDeltas[i].Add(FInventoryDelta{ Pair.Key, -FromContainer });
+				Remaining -= FromContainer;
+			}
+		}
+
+		if (Remaining > 0)
+		{
+			UE_LOG(LogCrafting, Warning, TEXT("%s: linked containers hold fewer %s than their totals say"), *GetName(), *GetNameSafe(Pair.Key));
+			return false;
+		}
+	}
+
+	Crafter->TakeCraftIngredients(CrafterDeltas);
+	for (int32 i = 0; i < Containers.Num(); i++)
+	{
+		if (ContainerDeltas[i].Num() > 0)
+		{
+			Containers[i]->ApplyInventoryDeltas(ContainerDeltas[i]);
+		}
+	}
+	return true;
+}
+
+TArray<FPickupItem> ACraftingStation::GetCombinedItems(const AcraftingCharacter* Crafter) const
+{
+	TArray<FPickupItem> Items;
+	Items.Reserve(Crafter->GetCurrentItems().Num() + Storage.GetItems().Num());
+	Items.Append(Crafter->GetCurrentItems());
+	Items.Append(Storage.GetItems());
+	return Items;
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GameFramework/Actor.h"
+#include "StorageContainer.h"
+#include "CraftingStation.generated.h"
+
+/**
+ * World actor crafting recipes over time. Ingredients are taken when a craft is queued,
+ * the results arrive in the crafter's inventory once the job scheduler of the game mode finishes them.
+ * Ingredients come from the crafter and from every linked storage container, the crafter's own items first.
+ */
+UCLASS()
+class CRAFTING_API ACraftingStation : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ACraftingStation();
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Crafting")
+		class UCraftingRecipeBook* Recipes;
+
+	/** Jobs waiting or in progress above which QueueCraft refuses new ones */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Crafting")
+		int MaxQueuedJobs;
+
+	/** Takes the ingredients for Count crafts from Crafter and queues them, returns false if nothing was queued */
+	UFUNCTION(BlueprintCallable, Category = "Crafting")
+		bool QueueCraft(class AcraftingCharacter* Crafter, int RecipeIndex, int Count);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Crafting")
+		int GetQueuedJobs() const;
+
+	/** How many times the recipe can be crafted from the items of Crafter and the linked containers */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Crafting")
+		int GetMaxCraftCount(AcraftingCharacter* Crafter, int RecipeIndex) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Crafting")
+		void LinkContainer(AStorageContainer* Container);
+
+	UFUNCTION(BlueprintCallable, Category = "Crafting")
+		void UnlinkContainer(AStorageContainer* Container);
+
+	void OnJobFinished();
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Containers linked when play begins */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Crafting")
+		TArray<AStorageContainer*> LinkedContainers;
+
+private:
+	int32 GetRecipeCraftCount(const AcraftingCharacter* Crafter, const FCraftingRecipe& Recipe) const;
+
+	/** Takes the ingredients of Count crafts from the crafter and the containers, either all of them or nothing */
+	bool ConsumeIngredients(AcraftingCharacter* Crafter, const FCraftingRecipe& Recipe, int32 Count);
+
+	/** The crafter's stacks followed by the container totals, classes may repeat */
+	TArray<FPickupItem> GetCombinedItems(const AcraftingCharacter* Crafter) const;
+
+	FStorageAggregate Storage;
+
+	int QueuedJobs;
+};
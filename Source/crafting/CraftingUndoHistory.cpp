@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingUndoHistory.h"
+
+FCraftingUndoHistory::FCraftingUndoHistory(int32 InMaxSteps)
+	: Cursor(0)
+	, StepFrame(MAX_uint64)
+	, MaxSteps(FMath::Max(InMaxSteps, 1))
+{
+}
+
+void FCraftingUndoHistory::RecordItem(UClass* ItemClass, int32 Delta)
+{
+	if (ItemClass != nullptr && Delta != 0)
+	{
+		Add(FCraftingUndoRecord{ ItemClass, nullptr, Delta, FCraftingUndoRecord::Item });
+	}
+}
+
+void FCraftingUndoHistory::RecordTableCell(int32 Cell, UClass* OldClass, UClass* NewClass)
+{
+	if (OldClass != NewClass)
+	{
+		Add(FCraftingUndoRecord{ NewClass, OldClass, Cell, FCraftingUndoRecord::TableCell });
+	}
+}
+
+void FCraftingUndoHistory::Add(const FCraftingUndoRecord& Record)
+{
+	if (StepFrame != GFrameCounter)
+	{
+		// a new change makes the undone steps unreachable
+		if (Cursor < Steps.Num())
+		{
+			Records.SetNum(Steps[Cursor], false);
+			Steps.SetNum(Cursor, false);
+		}
+
+		// drop the oldest steps in one go once twice as many are kept, so each step pays O(1) on average
+		if (Steps.Num() >= MaxSteps * 2)
+		{
+			const int32 NumDropped = Steps.Num() - MaxSteps + 1;
+			const int32 NumDroppedRecords = NumDropped < Steps.Num() ? Steps[NumDropped] : Records.Num();
+			Records.RemoveAt(0, NumDroppedRecords, false);
+			Steps.RemoveAt(0, NumDropped, false);
+			for (int32& StepStart : Steps)
+			{
+				StepStart -= NumDroppedRecords;
+			}
+		}
+
+		Steps.Add(Records.Num());
+		Cursor = Steps.Num();
+		StepFrame = GFrameCounter;
+	}
+	Records.Add(Record);
+}
+
+bool FCraftingUndoHistory::Undo(TFunctionRef<void(const FCraftingUndoRecord&)> Revert)
+{
+	if (!CanUndo())
+	{
+		return false;
+	}
+
+	--Cursor;
+	for (int32 i = GetStepEnd(Cursor) - 1; i >= Steps[Cursor]; i--)
+	{
+		Revert(Records[i]);
+	}
+
+	// whatever happens next frame starts its own step
+	StepFrame = MAX_uint64;
+	return true;
+}
+
+bool FCraftingUndoHistory::Redo(TFunctionRef<void(const FCraftingUndoRecord&)> Apply)
+{
+	if (!CanRedo())
+	{
+		return false;
+	}
+
+	for (int32 i = Steps[Cursor]; i < GetStepEnd(Cursor); i++)
+	{
+		Apply(Records[i]);
+	}
+	++Cursor;
+
+	StepFrame = MAX_uint64;
+	return true;
+}
+
+void FCraftingUndoHistory::Reset()
+{
+	Records.Reset();
+	Steps.Reset();
+	Cursor = 0;
+	StepFrame = MAX_uint64;
+}
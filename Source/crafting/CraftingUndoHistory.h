@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/** One change of the inventory or of the crafting table */
+struct FCraftingUndoRecord
+{
+	enum EType : uint8
+	{
+		/** Value items of Class were added, negative when removed */
+		Item,
+		/** Table cell Value went from OldClass to Class */
+		TableCell
+	};
+
+	TWeakObjectPtr<UClass> Class;
+	TWeakObjectPtr<UClass> OldClass;
+	int32 Value;
+	EType Type;
+};
+
+/**
+ * Undo and redo steps of the inventory and crafting table, stored as the changes themselves.
+ *
+ * Records of all steps live in one flat array and a step is only the index of its first record,
+ * so a step costs as much memory as it changed, whatever the inventory holds. All records made in the same
+ * frame form one step, which makes a drag and drop that moves an item from the inventory to the table
+ * undo as one. Undo and redo visit the records of one step and move a cursor. Only the newest MaxSteps
+ * steps are kept, old ones are dropped in batches so the cost stays constant per step.
+ */
+class FCraftingUndoHistory
+{
+public:
+	explicit FCraftingUndoHistory(int32 InMaxSteps = 64);
+
+	void RecordItem(UClass* ItemClass, int32 Delta);
+	void RecordTableCell(int32 Cell, UClass* OldClass, UClass* NewClass);
+
+	/** Reverts the newest done step, Revert gets its records newest first */
+	bool Undo(TFunctionRef<void(const FCraftingUndoRecord&)> Revert);
+
+	/** Repeats the oldest undone step, Apply gets its records in the order they were made */
+	bool Redo(TFunctionRef<void(const FCraftingUndoRecord&)> Apply);
+
+	bool CanUndo() const { return Cursor > 0; }
+	bool CanRedo() const { return Cursor < Steps.Num(); }
+
+	void SetMaxSteps(int32 InMaxSteps) { MaxSteps = FMath::Max(InMaxSteps, 1); }
+	void Reset();
+
+	SIZE_T GetAllocatedSize() const { return Records.GetAllocatedSize() + Steps.GetAllocatedSize(); }
+
+private:
+	void Add(const FCraftingUndoRecord& Record);
+	int32 GetStepEnd(int32 Step) const { return Step + 1 < Steps.Num() ? Steps[Step + 1] : Records.Num(); }
+
+	TArray<FCraftingUndoRecord> Records;
+
+	/** Index of the first record of every step */
+	TArray<int32> Steps;
+
+	/** Steps before the cursor are done, the ones from it on were undone and can be redone */
+	int32 Cursor;
+
+	/** Frame of the open step, records of another frame start a new one */
+	uint64 StepFrame;
+
+	int32 MaxSteps;
+};
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "CraftingWidgetComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Widget Creation"), STAT_CraftingWidgetCreation, STATGROUP_Crafting);
+
+static TAutoConsoleVariable<float> CVarUIRedrawBudget(
+	TEXT("Crafting.UIRedrawBudget"),
+	240.0f,
+	TEXT("Redraws per second shared by the open crafting widgets of all local players, 0 redraws every widget every frame"));
+
+TArray<UCraftingWidgetComponent*> UCraftingWidgetComponent::ActiveComponents;
+
+UCraftingWidgetComponent::UCraftingWidgetComponent()
+{
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	bCreateAllowed = false;
+}
+
+void UCraftingWidgetComponent::InitWidget()
+{
+	// BeginPlay and registration call this as well, only CreateWidgetNow lets it through
+	if (bCreateAllowed)
+	{
+		Super::InitWidget();
+	}
+}
+
+void UCraftingWidgetComponent::CreateWidgetNow()
+{
+	if (!bCreateAllowed)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CraftingWidgetCreation);
+
+		bCreateAllowed = true;
+		InitWidget();
+	}
+}
+
+void UCraftingWidgetComponent::SetUIActive(bool bActive)
+{
+	if (bActive)
+	{
+		CreateWidgetNow();
+	}
+	SetVisibility(bActive);
+	SetComponentTickEnabled(bActive);
+
+	const int32 NumActive = ActiveComponents.Num();
+	if (bActive)
+	{
+		ActiveComponents.AddUnique(this);
+	}
+	else
+	{
+		ActiveComponents.RemoveSingleSwap(this);
+	}
+	if (ActiveComponents.Num() != NumActive)
+	{
+		UpdateRedrawTimes();
+	}
+}
+
+void UCraftingWidgetComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ActiveComponents.RemoveSingleSwap(this) > 0)
+	{
+		UpdateRedrawTimes();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UCraftingWidgetComponent::UpdateRedrawTimes()
+{
+	const float Budget = CVarUIRedrawBudget.GetValueOnGameThread();
+	const float Interval = Budget > 0 ? ActiveComponents.Num() / Budget : 0;
+	for (UCraftingWidgetComponent* Component : ActiveComponents)
+	{
+		Component->RedrawTime = Interval;
+	}
+}
@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Components/WidgetComponent.h"
+#include "CraftingWidgetComponent.generated.h"
+
+/**
+ * Widget component whose UMG widget is only created when it is first needed, instead of in BeginPlay.
+ * While the UI is closed it neither ticks nor renders, so a pawn that never opens its inventory
+ * pays for neither the widget nor its render target.
+ *
+ * Open widgets of all local players share a budget of redraws per second (Crafting.UIRedrawBudget),
+ * with four split screen players each widget redraws less often instead of the UI costing four times as much.
+ */
+UCLASS(ClassGroup = UI, meta = (BlueprintSpawnableComponent))
+class CRAFTING_API UCraftingWidgetComponent : public UWidgetComponent
+{
+	GENERATED_BODY()
+
+public:
+	UCraftingWidgetComponent();
+
+	/** Creates the widget if that did not happen yet */
+	void CreateWidgetNow();
+
+	bool HasCreatedWidget() const { return bCreateAllowed; }
+
+	/** Shows the widget and lets it tick, or hides it and stops ticking */
+	void SetUIActive(bool bActive);
+
+	virtual void InitWidget() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	/** Spreads the redraw budget evenly over the open widgets */
+	static void UpdateRedrawTimes();
+
+	static TArray<UCraftingWidgetComponent*> ActiveComponents;
+
+	bool bCreateAllowed;
+};
@@ -0,0 +1,450 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "GridInventory.h"
+#include "PickupObject.h"
+
+FGridItemShape FGridItemShape::Get(UClass* ItemClass)
+{
+	const APickupObject* Defaults = ItemClass->GetDefaultObject<APickupObject>();
+	return FGridItemShape{ FMath::Clamp(Defaults->GridWidth, 1, FGridInventory::MaxWidth), FMath::Max(1, Defaults->GridHeight), FMath::Max(1, Defaults->MaxStackSize) };
+}
+
+/** Index of the lowest set bit, Bits must not be 0 */
+static FORCEINLINE int32 LowestBit(uint64 Bits)
+{
+	const uint32 Low = (uint32)Bits;
+	return Low != 0 ? FMath::CountTrailingZeros(Low) : 32 + FMath::CountTrailingZeros((uint32)(Bits >> 32));
+}
+
+void FGridInventory::Init(int32 InWidth, int32 InHeight)
+{
+	if (InWidth > MaxWidth)
+	{
+		UE_LOG(LogCrafting, Warning, TEXT("Grid inventories are at most %d cells wide, not %d"), MaxWidth, InWidth);
+	}
+	Width = FMath::Clamp(InWidth, 0, MaxWidth);
+	Height = FMath::Max(0, InHeight);
+	Reset();
+}
+
+void FGridInventory::Reset()
+{
+	Rows.Reset();
+	Rows.SetNumZeroed(Height);
+	Stacks.Reset();
+	Overflow.Reset();
+	NumUsedCells = 0;
+}
+
+int32 FGridInventory::Add(UClass* ItemClass, int32 Number, const FGridItemShape& Shape)
+{
+	Shapes.Add(ItemClass, Shape);
+
+	// items already overflowing would be passed by the new ones otherwise
+	int32* Overflowing = Overflow.Find(ItemClass);
+	if (Overflowing != nullptr)
+	{
+		*Overflowing += Number;
+		return Number;
+	}
+
+	for (FInventoryGridStack& Stack : Stacks)
+	{
+		if (Number == 0)
+		{
+			break;
+		}
+		if (Stack.Class == ItemClass && Stack.Number < Shape.MaxStack)
+		{
+			const int32 Added = FMath::Min(Number, Shape.MaxStack - Stack.Number);
+			Stack.Number += Added;
+			Number -= Added;
+		}
+	}
+
+	Number = PlaceStacks(ItemClass, Number);
+	if (Number > 0)
+	{
+		Overflow.Add(ItemClass, Number);
+	}
+	return Number;
+}
+
+void FGridInventory::Remove(UClass* ItemClass, int32 Number)
+{
+	int32* Overflowing = Overflow.Find(ItemClass);
+	if (Overflowing != nullptr)
+	{
+		const int32 Removed = FMath::Min(Number, *Overflowing);
+		*Overflowing -= Removed;
+		Number -= Removed;
+		if (*Overflowing == 0)
+		{
+			Overflow.Remove(ItemClass);
+		}
+	}
+
+	bool bFreedCells = false;
+	for (int32 i = Stacks.Num() - 1; i >= 0 && Number > 0; i--)
+	{
+		FInventoryGridStack& Stack = Stacks[i];
+		if (Stack.Class != ItemClass)
+		{
+			continue;
+		}
+
+		const int32 Removed = FMath::Min(Number, Stack.Number);
+		Stack.Number -= Removed;
+		Number -= Removed;
+		if (Stack.Number == 0)
+		{
+			SetUsed(Rows, Stack, false);
+			NumUsedCells -= Stack.Width * Stack.Height;
+			Stacks.RemoveAt(i);
+			bFreedCells = true;
+		}
+	}
+
+	if (bFreedCells && Overflow.Num() > 0)
+	{
+		PlaceOverflow();
+	}
+}
+
+bool FGridInventory::CanAdd(UClass* ItemClass, int32 Number, const FGridItemShape& Shape) const
+{
+	if (Overflow.Contains(ItemClass))
+	{
+		return Number <= 0;
+	}
+
+	for (const FInventoryGridStack& Stack : Stacks)
+	{
+		if (Stack.Class == ItemClass)
+		{
+			Number -= FMath::Max(0, Shape.MaxStack - Stack.Number);
+		}
+	}
+	if (Number <= 0)
+	{
+		return true;
+	}
+
+	// place the new stacks on a scratch copy of the bitmap, a few words per row
+	const int32 NumNewStacks = FMath::DivideAndRoundUp(Number, Shape.MaxStack);
+	if (NumNewStacks * Shape.Width * Shape.Height > GetFreeCells())
+	{
+		return false;
+	}
+	TArray<uint64> Scratch(Rows);
+	FInventoryGridStack Stack;
+	Stack.Width = Shape.Width;
+	Stack.Height = Shape.Height;
+	for (int32 i = 0; i < NumNewStacks; i++)
+	{
+		FIntPoint Position;
+		if (!FindFree(Scratch, Shape.Width, Shape.Height, Position))
+		{
+			return false;
+		}
+		Stack.X = Position.X;
+		Stack.Y = Position.Y;
+		SetUsed(Scratch, Stack, true);
+	}
+	return true;
+}
+
+bool FGridInventory::FindFree(const TArray<uint64>& InRows, int32 InWidth, int32 InHeight, FIntPoint& OutPosition) const
+{
+	if (InWidth <= 0 || InHeight <= 0 || InWidth > Width || InHeight > Height)
+	{
+		return false;
+	}
+
+	const uint64 GridMask = GetMask(0, Width);
+	for (int32 Y = 0; Y + InHeight <= Height; Y++)
+	{
+		uint64 Used = 0;
+		for (int32 Row = Y; Row < Y + InHeight; Row++)
+		{
+			Used |= InRows[Row];
+		}
+
+		// a bit stays set where InWidth free cells start, bits past the grid edge count as used
+		const uint64 Free = ~Used & GridMask;
+		uint64 Starts = Free;
+		for (int32 Shift = 1; Shift < InWidth && Starts != 0; Shift++)
+		{
+			Starts &= Free >> Shift;
+		}
+		if (Starts != 0)
+		{
+			OutPosition = FIntPoint(LowestBit(Starts), Y);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FGridInventory::IsFree(const TArray<uint64>& InRows, int32 X, int32 Y, int32 InWidth, int32 InHeight) const
+{
+	const uint64 Mask = GetMask(X, InWidth);
+	for (int32 Row = Y; Row < Y + InHeight; Row++)
+	{
+		if ((InRows[Row] & Mask) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void FGridInventory::SetUsed(TArray<uint64>& InRows, const FInventoryGridStack& Stack, bool bUsed) const
+{
+	const uint64 Mask = GetMask(Stack.X, Stack.Width);
+	ensureMsgf(!bUsed || IsFree(InRows, Stack.X, Stack.Y, Stack.Width, Stack.Height), TEXT("Grid stack at %d,%d overlaps another one"), Stack.X, Stack.Y);
+	for (int32 Row = Stack.Y; Row < Stack.Y + Stack.Height; Row++)
+	{
+		InRows[Row] = bUsed ? InRows[Row] | Mask : InRows[Row] & ~Mask;
+	}
+}
+
+int32 FGridInventory::PlaceStacks(UClass* ItemClass, int32 Number)
+{
+	const FGridItemShape& Shape = Shapes.FindChecked(ItemClass);
+	while (Number > 0)
+	{
+		FIntPoint Position;
+		if (!FindFree(Rows, Shape.Width, Shape.Height, Position))
+		{
+			break;
+		}
+
+		FInventoryGridStack& Stack = Stacks[Stacks.AddDefaulted()];
+		Stack.Class = ItemClass;
+		Stack.Number = FMath::Min(Number, Shape.MaxStack);
+		Stack.X = Position.X;
+		Stack.Y = Position.Y;
+		Stack.Width = Shape.Width;
+		Stack.Height = Shape.Height;
+		SetUsed(Rows, Stack, true);
+		NumUsedCells += Shape.Width * Shape.Height;
+		Number -= Stack.Number;
+	}
+	return Number;
+}
+
+void FGridInventory::PlaceOverflow()
+{
+	for (auto It = Overflow.CreateIterator(); It; ++It)
+	{
+		It.Value() = PlaceStacks(It.Key(), It.Value());
+		if (It.Value() == 0)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+bool FGridInventory::Sort()
+{
+	// one full stack per MaxStack items, whatever partial stacks the adds and removes left behind
+	TMap<UClass*, int32> Totals = Overflow;
+	for (const FInventoryGridStack& Stack : Stacks)
+	{
+		Totals.FindOrAdd(Stack.Class) += Stack.Number;
+	}
+
+	TArray<FInventoryGridStack> Sorted;
+	for (const TPair<UClass*, int32>& Pair : Totals)
+	{
+		const FGridItemShape& Shape = Shapes.FindChecked(Pair.Key);
+		for (int32 Remaining = Pair.Value; Remaining > 0; Remaining -= Shape.MaxStack)
+		{
+			FInventoryGridStack& Stack = Sorted[Sorted.AddDefaulted()];
+			Stack.Class = Pair.Key;
+			Stack.Number = FMath::Min(Remaining, Shape.MaxStack);
+			Stack.Width = Shape.Width;
+			Stack.Height = Shape.Height;
+		}
+	}
+
+	// large footprints first so the small ones fill the gaps, stacks of one class stay together
+	Sorted.Sort([](const FInventoryGridStack& A, const FInventoryGridStack& B)
+	{
+		if (A.Width * A.Height != B.Width * B.Height)
+		{
+			return A.Width * A.Height > B.Width * B.Height;
+		}
+		if (A.Height != B.Height)
+		{
+			return A.Height > B.Height;
+		}
+		if (A.Class != B.Class)
+		{
+			return A.Class->GetFName().Compare(B.Class->GetFName()) < 0;
+		}
+		return A.Number > B.Number;
+	});
+
+	TArray<uint64> SortedRows;
+	const TArray<FInventoryGridStack> Unplaced = PackSkyline(Sorted, SortedRows);
+
+	int32 NumUnplaced = 0;
+	for (const FInventoryGridStack& Stack : Unplaced)
+	{
+		NumUnplaced += Stack.Number;
+	}
+	if (NumUnplaced > GetOverflow())
+	{
+		return false;
+	}
+
+	Rows = MoveTemp(SortedRows);
+	Stacks = MoveTemp(Sorted);
+	Overflow.Reset();
+	NumUsedCells = 0;
+	for (const FInventoryGridStack& Stack : Stacks)
+	{
+		NumUsedCells += Stack.Width * Stack.Height;
+	}
+	for (const FInventoryGridStack& Stack : Unplaced)
+	{
+		Overflow.FindOrAdd(Stack.Class) += Stack.Number;
+	}
+	return true;
+}
+
+TArray<FInventoryGridStack> FGridInventory::PackSkyline(TArray<FInventoryGridStack>& InOutStacks, TArray<uint64>& OutRows) const
+{
+	// first free row under the skyline for the columns [X, X + Width)
+	struct FSegment
+	{
+		int32 X;
+		int32 Y;
+		int32 Width;
+	};
+	TArray<FSegment, TInlineAllocator<MaxWidth>> Skyline;
+	Skyline.Add(FSegment{ 0, 0, Width });
+
+	OutRows.Reset();
+	OutRows.SetNumZeroed(Height);
+	TArray<FInventoryGridStack> Placed;
+	TArray<FInventoryGridStack> Unplaced;
+	Placed.Reserve(InOutStacks.Num());
+
+	for (FInventoryGridStack& Stack : InOutStacks)
+	{
+		// bottom-left rule, the lowest resting position wins and ties go to the leftmost one
+		int32 BestSegment = INDEX_NONE;
+		int32 BestY = MAX_int32;
+		for (int32 i = 0; i < Skyline.Num(); i++)
+		{
+			if (Skyline[i].X + Stack.Width > Width)
+			{
+				break;
+			}
+			int32 Y = 0;
+			for (int32 j = i, Covered = 0; Covered < Stack.Width; Covered += Skyline[j].Width, j++)
+			{
+				Y = FMath::Max(Y, Skyline[j].Y);
+			}
+			// stacks placed by the bitmap fallback sit below the skyline without raising it
+			if (Y + Stack.Height <= Height && Y < BestY && IsFree(OutRows, Skyline[i].X, Y, Stack.Width, Stack.Height))
+			{
+				BestSegment = i;
+				BestY = Y;
+			}
+		}
+
+		if (BestSegment == INDEX_NONE)
+		{
+			// the skyline cannot see the holes below it, the bitmap can
+			FIntPoint Position;
+			if (!FindFree(OutRows, Stack.Width, Stack.Height, Position))
+			{
+				Unplaced.Add(Stack);
+				continue;
+			}
+			Stack.X = Position.X;
+			Stack.Y = Position.Y;
+			SetUsed(OutRows, Stack, true);
+			Placed.Add(Stack);
+			continue;
+		}
+
+		Stack.X = Skyline[BestSegment].X;
+		Stack.Y = BestY;
+		SetUsed(OutRows, Stack, true);
+		Placed.Add(Stack);
+
+		// raise the skyline over the new stack, then cut the segments it covers
+		Skyline.Insert(FSegment{ Stack.X, BestY + Stack.Height, Stack.Width }, BestSegment);
+		const int32 Right = Stack.X + Stack.Width;
+		for (int32 i = BestSegment + 1; i < Skyline.Num() && Skyline[i].X < Right; )
+		{
+			const int32 Cut = Right - Skyline[i].X;
+			if (Cut >= Skyline[i].Width)
+			{
+				Skyline.RemoveAt(i);
+				continue;
+			}
+			Skyline[i].X += Cut;
+			Skyline[i].Width -= Cut;
+			break;
+		}
+		for (int32 i = 1; i < Skyline.Num(); )
+		{
+			if (Skyline[i].Y == Skyline[i - 1].Y)
+			{
+				Skyline[i - 1].Width += Skyline[i].Width;
+				Skyline.RemoveAt(i);
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	InOutStacks = MoveTemp(Placed);
+	return Unplaced;
+}
+
+int32 FGridInventory::GetOverflow() const
+{
+	int32 Number = 0;
+	for (const TPair<UClass*, int32>& Pair : Overflow)
+	{
+		Number += Pair.Value;
+	}
+	return Number;
+}
+
+bool FGridInventory::HasOverlaps() const
+{
+	TArray<uint64> Check;
+	Check.SetNumZeroed(Height);
+	int32 NumCells = 0;
+	for (const FInventoryGridStack& Stack : Stacks)
+	{
+		if (Stack.X < 0 || Stack.Y < 0 || Stack.X + Stack.Width > Width || Stack.Y + Stack.Height > Height
+			|| !IsFree(Check, Stack.X, Stack.Y, Stack.Width, Stack.Height))
+		{
+			return true;
+		}
+		const uint64 Mask = GetMask(Stack.X, Stack.Width);
+		for (int32 Row = Stack.Y; Row < Stack.Y + Stack.Height; Row++)
+		{
+			Check[Row] |= Mask;
+		}
+		NumCells += Stack.Width * Stack.Height;
+	}
+	return Check != Rows || NumCells != NumUsedCells;
+}
+
+SIZE_T FGridInventory::GetAllocatedSize() const
+{
+	return Rows.GetAllocatedSize() + Stacks.GetAllocatedSize() + Shapes.GetAllocatedSize() + Overflow.GetAllocatedSize();
+}
@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GridInventory.generated.h"
+
+/** One stack of a grid inventory and the cells it covers */
+USTRUCT(BlueprintType)
+struct FInventoryGridStack
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+		TSubclassOf<class APickupObject> Class;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+		int Number = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+		int X = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+		int Y = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+		int Width = 1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+		int Height = 1;
+};
+
+/** Footprint and stack limit of an item class in a grid inventory */
+struct FGridItemShape
+{
+	int32 Width;
+	int32 Height;
+	int32 MaxStack;
+
+	/** Shape from the class defaults of the pickup */
+	static FGridItemShape Get(UClass* ItemClass);
+};
+
+/**
+ * Bounded inventory of Width x Height cells where every stack covers the footprint of its item.
+ *
+ * Occupancy is a bitmap with one 64 bit word per row, so "is this rectangle free" is one AND per row and
+ * finding the top-left free spot for a footprint slides a mask over OR-ed rows instead of visiting cells.
+ * Adding tops up the stacks of the class first and places new stacks at the first free spot. Sorting merges
+ * partial stacks and repacks everything from scratch with a skyline packer, largest footprints first, and
+ * fills the holes the skyline leaves with the bitmap search. Items that have no room are kept as overflow
+ * and placed as soon as something frees cells.
+ */
+class FGridInventory
+{
+public:
+	static const int32 MaxWidth = 64;
+
+	FGridInventory() : Width(0), Height(0) {}
+
+	/** Sets the size and empties the grid, a size of 0 disables it */
+	void Init(int32 InWidth, int32 InHeight);
+
+	/** Empties the grid, keeps the size */
+	void Reset();
+
+	bool IsEnabled() const { return Width > 0 && Height > 0; }
+
+	/** Adds items, returns how many of them did not fit and went to the overflow */
+	int32 Add(UClass* ItemClass, int32 Number, const FGridItemShape& Shape);
+
+	/** Takes items from the overflow first, then from the last stacks of the class */
+	void Remove(UClass* ItemClass, int32 Number);
+
+	/** Whether Number more items fit without overflowing */
+	bool CanAdd(UClass* ItemClass, int32 Number, const FGridItemShape& Shape) const;
+
+	/** Top-left free spot of a footprint */
+	bool FindFree(int32 InWidth, int32 InHeight, FIntPoint& OutPosition) const { return FindFree(Rows, InWidth, InHeight, OutPosition); }
+
+	/** Merges and repacks all stacks, returns false and keeps the layout when the new one would overflow more */
+	bool Sort();
+
+	const TArray<FInventoryGridStack>& GetStacks() const { return Stacks; }
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+	int32 GetFreeCells() const { return Width * Height - NumUsedCells; }
+	int32 GetOverflow() const;
+
+	/** Whether two stacks share a cell or the bitmap disagrees with the stacks, for tests */
+	bool HasOverlaps() const;
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	bool FindFree(const TArray<uint64>& InRows, int32 InWidth, int32 InHeight, FIntPoint& OutPosition) const;
+	bool IsFree(const TArray<uint64>& InRows, int32 X, int32 Y, int32 InWidth, int32 InHeight) const;
+	void SetUsed(TArray<uint64>& InRows, const FInventoryGridStack& Stack, bool bUsed) const;
+
+	/** Places new stacks of the class while there is room, returns how many items are left */
+	int32 PlaceStacks(UClass* ItemClass, int32 Number);
+
+	/** Places overflowing items into freed cells */
+	void PlaceOverflow();
+
+	/** Packs the stacks into empty rows, returns the stacks that did not fit */
+	TArray<FInventoryGridStack> PackSkyline(TArray<FInventoryGridStack>& InOutStacks, TArray<uint64>& OutRows) const;
+
+	FORCEINLINE static uint64 GetMask(int32 X, int32 InWidth)
+	{
+		return (InWidth >= 64 ? ~0ull : (1ull << InWidth) - 1) << X;
+	}
+
+	int32 Width;
+	int32 Height;
+	int32 NumUsedCells = 0;
+	TArray<uint64> Rows;
+	TArray<FInventoryGridStack> Stacks;
+	TMap<UClass*, FGridItemShape> Shapes;
+	TMap<UClass*, int32> Overflow;
+};
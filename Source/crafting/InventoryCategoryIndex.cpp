@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "InventoryCategoryIndex.h"
+#include "craftingCharacter.h"
+
+FInventoryCategoryIndex::FInventoryCategoryIndex()
+	: RareNumber(0)
+{
+	FMemory::Memzero(CategoryNumbers);
+}
+
+ECommonType FInventoryCategoryIndex::GetCategory(UClass* ItemClass)
+{
+	const APickupCommon* Common = ItemClass != nullptr ? Cast<APickupCommon>(ItemClass->GetDefaultObject()) : nullptr;
+	return Common != nullptr ? Common->ObjectType : ECommonType::Count;
+}
+
+void FInventoryCategoryIndex::OnStackAdded(UClass* ItemClass, bool bIsRare, int32 Number)
+{
+	const ECommonType Category = GetCategory(ItemClass);
+	Slots.Add(FSlot{ Category, bIsRare, Number });
+
+	for (int32 i = 0; i < NumCategories; i++)
+	{
+		CategorySlots[i].Add(i == (int32)Category);
+	}
+	RareSlots.Add(bIsRare);
+
+	if (Category != ECommonType::Count)
+	{
+		CategoryNumbers[(int32)Category] += Number;
+	}
+	if (bIsRare)
+	{
+		RareNumber += Number;
+	}
+}
+
+void FInventoryCategoryIndex::OnStackChanged(int32 Slot, int32 Delta)
+{
+	FSlot& Info = Slots[Slot];
+	Info.Number += Delta;
+
+	if (Info.Category != ECommonType::Count)
+	{
+		CategoryNumbers[(int32)Info.Category] += Delta;
+	}
+	if (Info.bIsRare)
+	{
+		RareNumber += Delta;
+	}
+}
+
+void FInventoryCategoryIndex::OnStackRemoved(int32 Slot)
+{
+	const FSlot& Info = Slots[Slot];
+	if (Info.Category != ECommonType::Count)
+	{
+		CategoryNumbers[(int32)Info.Category] -= Info.Number;
+	}
+	if (Info.bIsRare)
+	{
+		RareNumber -= Info.Number;
+	}
+
+	Slots.RemoveAt(Slot);
+	for (int32 i = 0; i < NumCategories; i++)
+	{
+		CategorySlots[i].RemoveAt(Slot);
+	}
+	RareSlots.RemoveAt(Slot);
+}
+
+void FInventoryCategoryIndex::Rebuild(const TArray<FPickupItem>& Items)
+{
+	Slots.Reset();
+	FMemory::Memzero(CategoryNumbers);
+	RareNumber = 0;
+	for (int32 i = 0; i < NumCategories; i++)
+	{
+		CategorySlots[i].Empty(Items.Num());
+	}
+	RareSlots.Empty(Items.Num());
+
+	for (const FPickupItem& Item : Items)
+	{
+		OnStackAdded(Item.Class, Item.IsRare, Item.Number);
+	}
+}
+
+SIZE_T FInventoryCategoryIndex::GetAllocatedSize() const
+{
+	SIZE_T Size = Slots.GetAllocatedSize() + RareSlots.GetAllocatedSize();
+	for (const TBitArray<>& Bits : CategorySlots)
+	{
+		Size += Bits.GetAllocatedSize();
+	}
+	return Size;
+}
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "PickupCommon.h"
+
+/**
+ * Per category and per rarity aggregates of an inventory, kept up to date by every mutation.
+ *
+ * Totals are plain counters, so "how many Chemicals do I hold" is O(1). Each category and the rare items
+ * also keep a bitset of the inventory slots holding them, listing them only visits the set bits.
+ * The index mirrors the slot order of the inventory, slots are appended at the end and removing one
+ * shifts the following ones down, the same way TArray::Add and TArray::RemoveAt do.
+ */
+class FInventoryCategoryIndex
+{
+public:
+	static const int32 NumCategories = (int32)ECommonType::Count;
+
+	FInventoryCategoryIndex();
+
+	void OnStackAdded(UClass* ItemClass, bool bIsRare, int32 Number);
+	void OnStackChanged(int32 Slot, int32 Delta);
+	void OnStackRemoved(int32 Slot);
+
+	/** Rebuilds everything, for when the whole inventory was replaced */
+	void Rebuild(const TArray<struct FPickupItem>& Items);
+
+	int32 GetCategoryNumber(ECommonType Category) const { return CategoryNumbers[(int32)Category]; }
+	int32 GetRareNumber() const { return RareNumber; }
+
+	const TBitArray<>& GetCategorySlots(ECommonType Category) const { return CategorySlots[(int32)Category]; }
+	const TBitArray<>& GetRareSlots() const { return RareSlots; }
+
+	/** Category of a pickup class, Count for everything that is not an APickupCommon */
+	static ECommonType GetCategory(UClass* ItemClass);
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	struct FSlot
+	{
+		ECommonType Category;
+		bool bIsRare;
+		int32 Number;
+	};
+
+	TArray<FSlot> Slots;
+
+	int32 CategoryNumbers[NumCategories];
+	int32 RareNumber;
+
+	TBitArray<> CategorySlots[NumCategories];
+	TBitArray<> RareSlots;
+};
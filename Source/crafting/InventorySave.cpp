@@ -0,0 +1,317 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "InventorySave.h"
+#include "Async/Async.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Inventory Write"), STAT_InventoryWrite, STATGROUP_Crafting);
+DECLARE_CYCLE_STAT(TEXT("Inventory Read"), STAT_InventoryRead, STATGROUP_Crafting);
+
+void FInventorySnapshot::AddSlot(const FString& ClassPath, int32 Number)
+{
+	int32 ClassIndex = ClassPaths.AddUnique(ClassPath);
+	check(ClassIndex <= MAX_uint16);
+	Slots.Add(FSlot{ (uint16)ClassIndex, Number });
+}
+
+FString FInventorySave::GetBasePath(const FString& SlotName)
+{
+	return FPaths::GameSavedDir() / TEXT("Inventory") / (SlotName + TEXT(".inv"));
+}
+
+FString FInventorySave::GetDeltaPath(const FString& SlotName)
+{
+	return FPaths::GameSavedDir() / TEXT("Inventory") / (SlotName + TEXT(".invd"));
+}
+
+TFuture<void> FInventorySave::SaveAsync(const FString& SlotName, FInventorySnapshot&& Snapshot, bool bIncremental, FOnSaved OnSaved)
+{
+	TSharedRef<FInventorySnapshot, ESPMode::ThreadSafe> SharedSnapshot = MakeShareable(new FInventorySnapshot(MoveTemp(Snapshot)));
+
+	return Async<void>(EAsyncExecution::ThreadPool, [SlotName, SharedSnapshot, bIncremental, OnSaved]()
+	{
+		bool bSuccess = Save(SlotName, *SharedSnapshot, bIncremental);
+
+		AsyncTask(ENamedThreads::GameThread, [OnSaved, bSuccess]()
+		{
+			OnSaved(bSuccess);
+		});
+	});
+}
+
+TFuture<void> FInventorySave::LoadAsync(const FString& SlotName, FOnLoaded OnLoaded)
+{
+	return Async<void>(EAsyncExecution::ThreadPool, [SlotName, OnLoaded]()
+	{
+		TSharedRef<TMap<FString, int32>, ESPMode::ThreadSafe> Items = MakeShareable(new TMap<FString, int32>());
+		bool bHasBase = false;
+		uint32 BaseGeneration = 0;
+		bool bSuccess = ReadBase(SlotName, *Items, bHasBase, BaseGeneration);
+		if (bSuccess && bHasBase)
+		{
+			ReadDeltas(SlotName, BaseGeneration, *Items);
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [OnLoaded, bSuccess, Items]()
+		{
+			OnLoaded(bSuccess, *Items);
+		});
+	});
+}
+
+bool FInventorySave::Save(const FString& SlotName, FInventorySnapshot& Snapshot, bool bIncremental)
+{
+	bool bSuccess = bIncremental ? AppendDelta(SlotName, Snapshot) : WriteBase(SlotName, Snapshot);
+	if (!bSuccess)
+	{
+		UE_LOG(LogCrafting, Warning, TEXT("Failed to write inventory slot '%s'"), *SlotName);
+	}
+	return bSuccess;
+}
+
+void FInventorySave::SerializeSnapshot(FArchive& Ar, FInventorySnapshot& Snapshot)
+{
+	uint16 NumClasses = Snapshot.ClassPaths.Num();
+	Ar << NumClasses;
+	if (Ar.IsLoading())
+	{
+		Snapshot.ClassPaths.SetNum(NumClasses);
+	}
+	for (int i = 0; i < NumClasses && !Ar.IsError(); i++)
+	{
+		Ar << Snapshot.ClassPaths[i];
+	}
+
+	uint32 NumSlots = Snapshot.Slots.Num();
+	Ar.SerializeIntPacked(NumSlots);
+	if (Ar.IsLoading())
+	{
+		// every slot takes at least three bytes, reject counts the remaining data cannot hold
+		if (Ar.IsError() || (int64)NumSlots * 3 > Ar.TotalSize() - Ar.Tell())
+		{
+			Ar.SetError();
+			return;
+		}
+		Snapshot.Slots.SetNum(NumSlots);
+	}
+	for (uint32 i = 0; i < NumSlots && !Ar.IsError(); i++)
+	{
+		FInventorySnapshot::FSlot& Slot = Snapshot.Slots[i];
+		Ar << Slot.ClassIndex;
+		uint32 Number = Slot.Number;
+		Ar.SerializeIntPacked(Number);
+		Slot.Number = Number;
+
+		if (Ar.IsLoading() && Slot.ClassIndex >= NumClasses)
+		{
+			Ar.SetError();
+		}
+	}
+}
+
+bool FInventorySave::WriteBase(const FString& SlotName, FInventorySnapshot& Snapshot)
+{
+	SCOPE_CYCLE_COUNTER(STAT_InventoryWrite);
+
+	TArray<uint8> Payload;
+	FMemoryWriter PayloadWriter(Payload);
+	SerializeSnapshot(PayloadWriter, Snapshot);
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(COMPRESS_ZLIB, Payload.Num());
+	TArray<uint8> Compressed;
+	Compressed.SetNumUninitialized(CompressedSize);
+	if (!FCompression::CompressMemory(COMPRESS_ZLIB, Compressed.GetData(), CompressedSize, Payload.GetData(), Payload.Num()))
+	{
+		return false;
+	}
+
+	TArray<uint8> FileData;
+	FMemoryWriter FileWriter(FileData);
+	uint32 FileMagic = Magic;
+	uint16 FileVersion = Version;
+	uint16 Flags = 0;
+	const FGuid Guid = FGuid::NewGuid();
+	uint32 Generation = Guid.A ^ Guid.B ^ Guid.C ^ Guid.D;
+	int32 UncompressedSize = Payload.Num();
+	FileWriter << FileMagic << FileVersion << Flags << Generation << UncompressedSize << CompressedSize;
+	FileWriter.Serialize(Compressed.GetData(), CompressedSize);
+
+	// write next to the old file and swap, so a crash never leaves a half written base behind
+	const FString BasePath = GetBasePath(SlotName);
+	const FString TempPath = BasePath + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(FileData, *TempPath) || !IFileManager::Get().Move(*BasePath, *TempPath, true))
+	{
+		return false;
+	}
+
+	// the base now holds everything the deltas described, should this not happen their generation no longer matches
+	IFileManager::Get().Delete(*GetDeltaPath(SlotName), false, false, true);
+	return true;
+}
+
+bool FInventorySave::AppendDelta(const FString& SlotName, FInventorySnapshot& Snapshot)
+{
+	SCOPE_CYCLE_COUNTER(STAT_InventoryWrite);
+
+	// deltas only make sense on top of the base they were taken after
+	uint32 Generation = 0;
+	if (!ReadBaseGeneration(SlotName, Generation))
+	{
+		return false;
+	}
+
+	TArray<uint8> Record;
+	FMemoryWriter Writer(Record);
+	uint32 RecordMagic = DeltaMagic;
+	int32 RecordSize = 0;
+	Writer << RecordMagic << RecordSize << Generation;
+	SerializeSnapshot(Writer, Snapshot);
+
+	// patch the payload size in now that it is known, it covers the generation and the snapshot
+	RecordSize = Record.Num() - sizeof(uint32) - sizeof(int32);
+	FMemory::Memcpy(Record.GetData() + sizeof(uint32), &RecordSize, sizeof(int32));
+
+	const FString DeltaPath = GetDeltaPath(SlotName);
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(DeltaPath));
+
+	TUniquePtr<IFileHandle> Handle(PlatformFile.OpenWrite(*DeltaPath, true));
+	return Handle.IsValid() && Handle->Write(Record.GetData(), Record.Num());
+}
+
+bool FInventorySave::ReadBaseGeneration(const FString& SlotName, uint32& OutGeneration)
+{
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*GetBasePath(SlotName), FILEREAD_Silent));
+	if (!Reader.IsValid())
+	{
+		return false;
+	}
+
+	uint32 FileMagic = 0;
+	uint16 FileVersion = 0;
+	uint16 Flags = 0;
+	*Reader << FileMagic << FileVersion << Flags << OutGeneration;
+	return !Reader->IsError() && FileMagic == Magic && FileVersion == Version;
+}
+
+bool FInventorySave::ReadBase(const FString& SlotName, TMap<FString, int32>& OutItems, bool& bOutHasBase, uint32& OutGeneration)
+{
+	SCOPE_CYCLE_COUNTER(STAT_InventoryRead);
+
+	bOutHasBase = false;
+	OutGeneration = 0;
+	const FString BasePath = GetBasePath(SlotName);
+	if (!IFileManager::Get().FileExists(*BasePath))
+	{
+		// nothing saved yet is an empty inventory, not an error
+		return true;
+	}
+
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *BasePath))
+	{
+		return false;
+	}
+
+	FMemoryReader FileReader(FileData);
+	uint32 FileMagic = 0;
+	uint16 FileVersion = 0;
+	uint16 Flags = 0;
+	uint32 Generation = 0;
+	int32 UncompressedSize = 0;
+	int32 CompressedSize = 0;
+	FileReader << FileMagic << FileVersion << Flags << Generation << UncompressedSize << CompressedSize;
+
+	if (FileReader.IsError() || FileMagic != Magic || FileVersion != Version
+		|| CompressedSize < 0 || CompressedSize > FileData.Num() - FileReader.Tell()
+		|| UncompressedSize < 0 || UncompressedSize > 64 * 1024 * 1024)
+	{
+		UE_LOG(LogCrafting, Warning, TEXT("Inventory file '%s' is corrupted or from another version"), *BasePath);
+		return false;
+	}
+
+	TArray<uint8> Payload;
+	Payload.SetNumUninitialized(UncompressedSize);
+	if (!FCompression::UncompressMemory(COMPRESS_ZLIB, Payload.GetData(), UncompressedSize, FileData.GetData() + FileReader.Tell(), CompressedSize))
+	{
+		return false;
+	}
+
+	FInventorySnapshot Snapshot;
+	FMemoryReader PayloadReader(Payload);
+	SerializeSnapshot(PayloadReader, Snapshot);
+	if (PayloadReader.IsError())
+	{
+		return false;
+	}
+
+	ApplySnapshot(Snapshot, OutItems);
+	bOutHasBase = true;
+	OutGeneration = Generation;
+	return true;
+}
+
+void FInventorySave::ReadDeltas(const FString& SlotName, uint32 BaseGeneration, TMap<FString, int32>& OutItems)
+{
+	SCOPE_CYCLE_COUNTER(STAT_InventoryRead);
+
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *GetDeltaPath(SlotName), FILEREAD_Silent))
+	{
+		return;
+	}
+
+	FMemoryReader Reader(FileData);
+	while (Reader.Tell() + (int64)(sizeof(uint32) + sizeof(int32)) <= FileData.Num())
+	{
+		uint32 RecordMagic = 0;
+		int32 RecordSize = 0;
+		Reader << RecordMagic << RecordSize;
+
+		const int64 RecordStart = Reader.Tell();
+		if (RecordMagic != DeltaMagic || RecordSize < 0 || RecordStart + RecordSize > FileData.Num())
+		{
+			// torn tail from an interrupted append, everything before it is still valid
+			break;
+		}
+
+		uint32 Generation = 0;
+		Reader << Generation;
+		if (Generation != BaseGeneration)
+		{
+			// appended to an older base, which the current one already contains
+			UE_LOG(LogCrafting, Warning, TEXT("Skipping stale inventory deltas of slot '%s'"), *SlotName);
+			break;
+		}
+
+		FInventorySnapshot Snapshot;
+		SerializeSnapshot(Reader, Snapshot);
+		if (Reader.IsError() || Reader.Tell() != RecordStart + RecordSize)
+		{
+			break;
+		}
+		ApplySnapshot(Snapshot, OutItems);
+	}
+}
+
+void FInventorySave::ApplySnapshot(const FInventorySnapshot& Snapshot, TMap<FString, int32>& OutItems)
+{
+	for (const FInventorySnapshot::FSlot& Slot : Snapshot.Slots)
+	{
+		const FString& ClassPath = Snapshot.ClassPaths[Slot.ClassIndex];
+		if (Slot.Number > 0)
+		{
+			OutItems.Add(ClassPath, Slot.Number);
+		}
+		else
+		{
+			OutItems.Remove(ClassPath);
+		}
+	}
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Async/Future.h"
+
+/**
+ * Snapshot of the inventory taken on the game thread. Class paths are stored once in a table
+ * and slots only reference them by index, so the payload never repeats a string.
+ */
+struct FInventorySnapshot
+{
+	struct FSlot
+	{
+		uint16 ClassIndex;
+		int32 Number;
+	};
+
+	TArray<FString> ClassPaths;
+	TArray<FSlot> Slots;
+
+	/** Adds a slot, Number == 0 marks a removed stack in incremental snapshots */
+	void AddSlot(const FString& ClassPath, int32 Number);
+};
+
+/**
+ * Versioned binary persistence of the player inventory.
+ *
+ * A full save writes a zlib compressed base file and drops the delta file. An incremental save
+ * appends a small record with only the stacks that changed since the previous save to the delta
+ * file. Loading reads the base and replays the deltas on top of it. All file work runs on the
+ * thread pool; completion callbacks are always invoked on the game thread.
+ *
+ * Every base carries a random generation and delta records carry the generation of the base they
+ * were appended to. Deltas left behind by a crash between writing a base and dropping the old delta
+ * file belong to an older generation and are skipped, they never overwrite the newer base.
+ */
+class FInventorySave
+{
+public:
+	typedef TFunction<void(bool)> FOnSaved;
+	typedef TFunction<void(bool, const TMap<FString, int32>&)> FOnLoaded;
+
+	static const uint32 Magic = 0x564E4943; // 'CINV'
+	static const uint32 DeltaMagic = 0x32444943; // 'CID2'
+	static const uint16 Version = 2;
+
+	/** Number of appended deltas after which the owner should fall back to a full save */
+	static const int32 MaxDeltaRecords = 32;
+
+	static FString GetBasePath(const FString& SlotName);
+	static FString GetDeltaPath(const FString& SlotName);
+
+	/** The returned future is set once the file work is done, the callback follows later on the game thread */
+	static TFuture<void> SaveAsync(const FString& SlotName, FInventorySnapshot&& Snapshot, bool bIncremental, FOnSaved OnSaved);
+	static TFuture<void> LoadAsync(const FString& SlotName, FOnLoaded OnLoaded);
+
+	/** Writes on the calling thread, for the last save of a player that is about to go away */
+	static bool Save(const FString& SlotName, FInventorySnapshot& Snapshot, bool bIncremental);
+
+private:
+	static void SerializeSnapshot(FArchive& Ar, FInventorySnapshot& Snapshot);
+	static bool WriteBase(const FString& SlotName, FInventorySnapshot& Snapshot);
+	static bool AppendDelta(const FString& SlotName, FInventorySnapshot& Snapshot);
+	static bool ReadBase(const FString& SlotName, TMap<FString, int32>& OutItems, bool& bOutHasBase, uint32& OutGeneration);
+	static void ReadDeltas(const FString& SlotName, uint32 BaseGeneration, TMap<FString, int32>& OutItems);
+
+	/** Generation of the base file on disk, false when there is no readable base to append to */
+	static bool ReadBaseGeneration(const FString& SlotName, uint32& OutGeneration);
+	static void ApplySnapshot(const FInventorySnapshot& Snapshot, TMap<FString, int32>& OutItems);
+};
@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "LootSpawner.h"
+#include "Components/BoxComponent.h"
+#include "CraftingContentStreamer.h"
+
+DECLARE_CYCLE_STAT(TEXT("Loot Draw"), STAT_LootDraw, STATGROUP_Crafting);
+DECLARE_CYCLE_STAT(TEXT("Loot Spawn"), STAT_LootSpawn, STATGROUP_Crafting);
+
+ALootSpawner::ALootSpawner()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	Area = CreateDefaultSubobject<UBoxComponent>(TEXT("Area"));
+	Area->SetBoxExtent(FVector(500.0f, 500.0f, 50.0f));
+	Area->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Area->bGenerateOverlapEvents = false;
+	RootComponent = Area;
+
+	LootTable = nullptr;
+	Seed = 0;
+	DrawsOnBeginPlay = 0;
+	SpawnBudgetMs = 2.0f;
+	DeferredDraws = 0;
+	NextSpawn = 0;
+}
+
+void ALootSpawner::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// pickups replicate, clients would only spawn local duplicates of the server's drops
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	Random.Initialize(Seed);
+	DeferredDraws = DrawsOnBeginPlay;
+
+	if (LootTable != nullptr)
+	{
+		TWeakObjectPtr<ALootSpawner> WeakThis(this);
+		FCraftingContentStreamer::Get().RequestPickupClasses(LootTable->GetClassReferences(), FCraftingContentStreamer::PriorityVisible, FSimpleDelegate::CreateLambda([WeakThis]()
+		{
+			if (ALootSpawner* Spawner = WeakThis.Get())
+			{
+				Spawner->OnClassesLoaded();
+			}
+		}));
+	}
+}
+
+void ALootSpawner::OnClassesLoaded()
+{
+	Compiled = LootTable->Compile(Filter);
+	LoadedClasses = Compiled->Classes;
+	if (Compiled->IsEmpty())
+	{
+		UE_LOG(LogCrafting, Warning, TEXT("%s: no entry of %s passes the filter"), *GetName(), *LootTable->GetName());
+	}
+
+	Draw(DeferredDraws);
+	DeferredDraws = 0;
+}
+
+void ALootSpawner::SpawnDrops(int Number)
+{
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	if (Compiled.IsValid())
+	{
+		Draw(Number);
+	}
+	else
+	{
+		DeferredDraws += Number;
+	}
+}
+
+int ALootSpawner::GetPendingSpawns() const
+{
+	return PendingSpawns.Num() - NextSpawn;
+}
+
+void ALootSpawner::Draw(int32 Number)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LootDraw);
+
+	if (Number <= 0 || !HasAuthority() || Compiled->IsEmpty())
+	{
+		return;
+	}
+
+	const FTransform& AreaTransform = Area->GetComponentTransform();
+	const FVector Extent = Area->GetUnscaledBoxExtent();
+	for (int32 i = 0; i < Number; i++)
+	{
+		UClass* PickupClass = nullptr;
+		int32 NumPickups = 0;
+		Compiled->Draw(Random, PickupClass, NumPickups);
+
+		for (int32 j = 0; j < NumPickups; j++)
+		{
+			const FVector LocalLocation(Random.FRandRange(-Extent.X, Extent.X), Random.FRandRange(-Extent.Y, Extent.Y), Random.FRandRange(-Extent.Z, Extent.Z));
+			PendingSpawns.Add(FPendingSpawn{ PickupClass, AreaTransform.TransformPosition(LocalLocation) });
+		}
+	}
+	SetActorTickEnabled(true);
+}
+
+void ALootSpawner::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	SCOPE_CYCLE_COUNTER(STAT_LootSpawn);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// at least one spawn per frame, so a tiny budget still makes progress
+	const double EndSeconds = FPlatformTime::Seconds() + SpawnBudgetMs / 1000.0;
+	do
+	{
+		const FPendingSpawn& Spawn = PendingSpawns[NextSpawn++];
+		GetWorld()->SpawnActor<AActor>(Spawn.Class, Spawn.Location, FRotator::ZeroRotator, SpawnParams);
+	}
+	while (NextSpawn < PendingSpawns.Num() && FPlatformTime::Seconds() < EndSeconds);
+
+	if (NextSpawn == PendingSpawns.Num())
+	{
+		PendingSpawns.Reset();
+		NextSpawn = 0;
+		SetActorTickEnabled(false);
+	}
+}
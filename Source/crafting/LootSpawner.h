@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GameFramework/Actor.h"
+#include "LootTable.h"
+#include "LootSpawner.generated.h"
+
+/**
+ * Populates its box with pickups drawn from a loot table. Draws come from a stream seeded with Seed, so the
+ * same calls to SpawnDrops always produce the same pickups at the same places. Drawing is cheap and happens
+ * right away, the pickups themselves are spawned over as many frames as SpawnBudgetMs requires.
+ */
+UCLASS()
+class CRAFTING_API ALootSpawner : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ALootSpawner();
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Loot")
+		class UBoxComponent* Area;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Loot")
+		ULootTable* LootTable;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Loot")
+		FLootFilter Filter;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Loot")
+		int32 Seed;
+
+	/** Draws made as soon as the loot table classes are loaded */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Loot")
+		int DrawsOnBeginPlay;
+
+	/** Milliseconds per frame spent spawning pickups */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Loot")
+		float SpawnBudgetMs;
+
+	/** Draws Number entries from the loot table and queues their pickups, only on the server */
+	UFUNCTION(BlueprintCallable, Category = "Loot")
+		void SpawnDrops(int Number);
+
+	/** Pickups drawn but not spawned yet */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Loot")
+		int GetPendingSpawns() const;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+
+private:
+	void OnClassesLoaded();
+	void Draw(int32 Number);
+
+	struct FPendingSpawn
+	{
+		UClass* Class;
+		FVector Location;
+	};
+
+	FRandomStream Random;
+	TSharedPtr<const FCompiledLootTable> Compiled;
+
+	/** Keeps the streamed pickup classes alive while they may still be drawn */
+	UPROPERTY(Transient)
+		TArray<UClass*> LoadedClasses;
+
+	/** Draws requested before the classes were loaded */
+	int32 DeferredDraws;
+
+	TArray<FPendingSpawn> PendingSpawns;
+	int32 NextSpawn;
+};
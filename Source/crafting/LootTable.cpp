@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "LootTable.h"
+#include "InventoryCategoryIndex.h"
+
+bool FLootFilter::Accepts(UClass* PickupClass) const
+{
+	const APickupObject* Defaults = PickupClass != nullptr ? PickupClass->GetDefaultObject<APickupObject>() : nullptr;
+	if (Defaults == nullptr || !(Defaults->IsRare() ? bAllowRare : bAllowCommon))
+	{
+		return false;
+	}
+
+	// rare pickups have no category, the category list only narrows the common ones
+	const ECommonType Category = FInventoryCategoryIndex::GetCategory(PickupClass);
+	return Categories.Num() == 0 || Category == ECommonType::Count || Categories.Contains(Category);
+}
+
+uint32 FLootFilter::GetKey() const
+{
+	uint32 Key = (bAllowCommon ? 1u : 0u) | (bAllowRare ? 2u : 0u);
+	for (ECommonType Category : Categories)
+	{
+		Key |= 4u << (uint32)Category;
+	}
+	return Key;
+}
+
+void FLootAliasTable::Build(const TArray<float>& Weights)
+{
+	const int32 Num = Weights.Num();
+	Probabilities.SetNumUninitialized(Num);
+	Aliases.SetNumUninitialized(Num);
+
+	float TotalWeight = 0;
+	for (float Weight : Weights)
+	{
+		TotalWeight += Weight;
+	}
+	if (Num == 0 || TotalWeight <= 0)
+	{
+		Probabilities.Reset();
+		Aliases.Reset();
+		return;
+	}
+
+	// scale so the average column holds exactly 1, then pair each underfull column with an overfull one
+	TArray<float> Scaled;
+	TArray<int32> Small;
+	TArray<int32> Large;
+	Scaled.SetNumUninitialized(Num);
+	for (int32 i = 0; i < Num; i++)
+	{
+		Scaled[i] = Weights[i] * Num / TotalWeight;
+		(Scaled[i] < 1.0f ? Small : Large).Add(i);
+	}
+
+	while (Small.Num() > 0 && Large.Num() > 0)
+	{
+		const int32 Less = Small.Pop(false);
+		const int32 More = Large.Pop(false);
+		Probabilities[Less] = Scaled[Less];
+		Aliases[Less] = More;
+
+		Scaled[More] = (Scaled[More] + Scaled[Less]) - 1.0f;
+		(Scaled[More] < 1.0f ? Small : Large).Add(More);
+	}
+
+	// whatever is left is 1 up to rounding errors
+	for (int32 Column : Large)
+	{
+		Probabilities[Column] = 1.0f;
+		Aliases[Column] = Column;
+	}
+	for (int32 Column : Small)
+	{
+		Probabilities[Column] = 1.0f;
+		Aliases[Column] = Column;
+	}
+}
+
+TArray<FStringAssetReference> ULootTable::GetClassReferences() const
+{
+	TArray<FStringAssetReference> References;
+	for (const FLootEntry& Entry : Entries)
+	{
+		if (!Entry.Class.IsNull())
+		{
+			References.AddUnique(Entry.Class.ToStringReference());
+		}
+	}
+	return References;
+}
+
+TSharedRef<const FCompiledLootTable> ULootTable::Compile(const FLootFilter& Filter) const
+{
+	const uint32 Key = Filter.GetKey();
+	if (const TSharedRef<const FCompiledLootTable>* Compiled = CompiledTables.Find(Key))
+	{
+		return *Compiled;
+	}
+
+	TSharedRef<FCompiledLootTable> Compiled = MakeShareable(new FCompiledLootTable());
+	TArray<float> Weights;
+	for (const FLootEntry& Entry : Entries)
+	{
+		UClass* PickupClass = Entry.Class.Get();
+		if (PickupClass != nullptr && Entry.Weight > 0 && Filter.Accepts(PickupClass))
+		{
+			Compiled->Classes.Add(PickupClass);
+			Compiled->MinNumbers.Add(FMath::Max(Entry.MinNumber, 1));
+			Compiled->MaxNumbers.Add(FMath::Max(Entry.MaxNumber, Entry.MinNumber));
+			Weights.Add(Entry.Weight);
+		}
+	}
+	Compiled->Alias.Build(Weights);
+
+	// a table compiled before its classes finished streaming would stay incomplete, only keep full ones
+	bool bAllLoaded = true;
+	for (const FLootEntry& Entry : Entries)
+	{
+		bAllLoaded &= Entry.Class.IsNull() || Entry.Class.Get() != nullptr;
+	}
+	if (bAllLoaded)
+	{
+		CompiledTables.Add(Key, Compiled);
+	}
+	return Compiled;
+}
+
+#if WITH_EDITOR
+void ULootTable::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	CompiledTables.Reset();
+}
+#endif
@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Engine/DataAsset.h"
+#include "PickupCommon.h"
+#include "LootTable.generated.h"
+
+USTRUCT(BlueprintType)
+struct FLootEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Loot")
+		TAssetSubclassOf<class APickupObject> Class;
+
+	/** Relative chance of the entry, entries with a weight of 0 never drop */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Loot", meta = (ClampMin = "0"))
+		float Weight = 1;
+
+	/** Pickups spawned when the entry is drawn, picked uniformly from MinNumber to MaxNumber */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Loot", meta = (ClampMin = "1"))
+		int MinNumber = 1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Loot", meta = (ClampMin = "1"))
+		int MaxNumber = 1;
+};
+
+/** Restricts a loot table to some of its entries, based on the rarity and the category of their pickups */
+USTRUCT(BlueprintType)
+struct FLootFilter
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Loot")
+		bool bAllowCommon = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Loot")
+		bool bAllowRare = true;
+
+	/** Categories of common pickups that may drop, empty allows all of them */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Loot")
+		TArray<ECommonType> Categories;
+
+	bool Accepts(UClass* PickupClass) const;
+
+	/** Filters accepting the same entries have the same key */
+	uint32 GetKey() const;
+};
+
+/**
+ * Walker's alias method as constructed by Vose. Building is O(n), every draw takes one uniform column
+ * and one biased coin flip, however many entries there are.
+ */
+class FLootAliasTable
+{
+public:
+	void Build(const TArray<float>& Weights);
+
+	int32 Sample(FRandomStream& Random) const
+	{
+		const int32 Column = Random.RandHelper(Probabilities.Num());
+		return Random.GetFraction() < Probabilities[Column] ? Column : Aliases[Column];
+	}
+
+	bool IsEmpty() const { return Probabilities.Num() == 0; }
+
+private:
+	TArray<float> Probabilities;
+	TArray<int32> Aliases;
+};
+
+/** The entries of a loot table passing one filter, ready for drawing */
+struct FCompiledLootTable
+{
+	FLootAliasTable Alias;
+	TArray<UClass*> Classes;
+	TArray<int32> MinNumbers;
+	TArray<int32> MaxNumbers;
+
+	bool IsEmpty() const { return Alias.IsEmpty(); }
+
+	/** Draws one entry, OutNumber pickups of OutClass should be spawned */
+	void Draw(FRandomStream& Random, UClass*& OutClass, int32& OutNumber) const
+	{
+		const int32 Entry = Alias.Sample(Random);
+		OutClass = Classes[Entry];
+		OutNumber = MinNumbers[Entry] < MaxNumbers[Entry] ? Random.RandRange(MinNumbers[Entry], MaxNumbers[Entry]) : MinNumbers[Entry];
+	}
+};
+
+/** Weighted pickup classes dropped by loot spawners */
+UCLASS(BlueprintType)
+class CRAFTING_API ULootTable : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot")
+		TArray<FLootEntry> Entries;
+
+	/** Soft references of all entries, to be streamed in before compiling */
+	TArray<FStringAssetReference> GetClassReferences() const;
+
+	/** Alias table of the entries passing Filter, compiled once per filter. Entries whose class is not loaded are left out */
+	TSharedRef<const FCompiledLootTable> Compile(const FLootFilter& Filter) const;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+	mutable TMap<uint32, TSharedRef<const FCompiledLootTable>> CompiledTables;
+};
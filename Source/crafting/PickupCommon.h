@@ -13,7 +13,9 @@ enum class ECommonType : uint8
 	Scrap					UMETA(DisplayName = "Scrap"),
 	Chemicals				UMETA(DisplayName = "Chemicals"),
 	MinaeralsAndElements	UMETA(DisplayName = "MinaeralsAndElements"),
-	Biowaste				UMETA(DisplayName = "Biowaste")
+	Biowaste				UMETA(DisplayName = "Biowaste"),
+
+	Count					UMETA(Hidden)
 };
 
 /**
@@ -0,0 +1,216 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "PickupMagnet.h"
+#include "PickupObject.h"
+#include "PickupRelevancyGrid.h"
+#include "craftingCharacter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Pickup Magnet"), STAT_PickupMagnet, STATGROUP_Crafting);
+DECLARE_CYCLE_STAT(TEXT("Pickup Collection"), STAT_PickupCollection, STATGROUP_Crafting);
+
+static TAutoConsoleVariable<float> CVarPickupCollectBudget(
+	TEXT("Crafting.PickupCollectBudget"),
+	0.5f,
+	TEXT("Milliseconds a frame spent collecting queued pickups, at least one pickup is collected every frame"));
+
+/** Height of the arc attracted pickups fly along */
+static const float MagnetArcHeight = 60.0f;
+
+/** Even pickups right next to the player take this long, so the pull stays visible */
+static const float MinAttractionSeconds = 0.15f;
+
+static TMap<const UWorld*, TUniquePtr<FPickupMagnet>> WorldMagnets;
+
+FPickupMagnet::FPickupMagnet(UWorld* InWorld)
+	: World(InWorld)
+{
+}
+
+FPickupMagnet& FPickupMagnet::Get(UWorld* World)
+{
+	TUniquePtr<FPickupMagnet>& Magnet = WorldMagnets.FindOrAdd(World);
+	if (!Magnet.IsValid())
+	{
+		Magnet = MakeUnique<FPickupMagnet>(World);
+	}
+	return *Magnet;
+}
+
+void FPickupMagnet::Release(const UWorld* World)
+{
+	const TUniquePtr<FPickupMagnet>* Magnet = WorldMagnets.Find(World);
+	if (Magnet != nullptr && (*Magnet)->Players.Num() == 0)
+	{
+		WorldMagnets.Remove(World);
+	}
+}
+
+void FPickupMagnet::AddPlayer(AcraftingCharacter* Player)
+{
+	Players.AddUnique(Player);
+}
+
+void FPickupMagnet::RemovePlayer(AcraftingCharacter* Player)
+{
+	Players.Remove(Player);
+}
+
+void FPickupMagnet::QueueCollect(APickupObject* Pickup, AcraftingCharacter* Player)
+{
+	if (!Pickup->IsMagnetized())
+	{
+		Pickup->SetMagnetized(true);
+	}
+	Pickup->SetActorHiddenInGame(true);
+	Queue.Add(FQueuedCollection{ Pickup, Player });
+}
+
+void FPickupMagnet::Tick(float DeltaTime)
+{
+	Attract();
+	Move(DeltaTime);
+	CollectQueued();
+}
+
+bool FPickupMagnet::IsTickable() const
+{
+	return !World->IsPaused() && (Players.Num() > 0 || Attractions.Num() > 0 || Queue.Num() > 0);
+}
+
+TStatId FPickupMagnet::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(FPickupMagnet, STATGROUP_Crafting);
+}
+
+void FPickupMagnet::Attract()
+{
+	SCOPE_CYCLE_COUNTER(STAT_PickupMagnet);
+
+	const FPickupRelevancyGrid* Grid = FPickupRelevancyGrid::Find(World);
+	if (Grid == nullptr)
+	{
+		return;
+	}
+
+	TArray<APickupObject*> Nearby;
+	for (const TWeakObjectPtr<AcraftingCharacter>& PlayerPtr : Players)
+	{
+		AcraftingCharacter* Player = PlayerPtr.Get();
+		if (Player == nullptr || Player->MagnetRadius <= 0)
+		{
+			continue;
+		}
+
+		const FVector PlayerLocation = Player->GetActorLocation();
+		Nearby.Reset();
+		Grid->GetPickupsInRadius(PlayerLocation, Player->MagnetRadius, Nearby);
+		for (APickupObject* Pickup : Nearby)
+		{
+			if (!Pickup->CanBeMagnetized() || !Player->CanHoldItem(Pickup->GetClass(), 1))
+			{
+				continue;
+			}
+
+			Pickup->SetMagnetized(true);
+			const FVector Start = Pickup->GetActorLocation();
+			const float Duration = FMath::Max(FVector::Dist(Start, PlayerLocation) / FMath::Max(Player->MagnetSpeed, 1.0f), MinAttractionSeconds);
+			Attractions.Add(FAttraction{ Pickup, Player, Start, 0, Duration });
+		}
+	}
+}
+
+void FPickupMagnet::Move(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PickupMagnet);
+
+	for (int32 i = Attractions.Num() - 1; i >= 0; i--)
+	{
+		FAttraction& Attraction = Attractions[i];
+		APickupObject* Pickup = Attraction.Pickup.Get();
+		AcraftingCharacter* Player = Attraction.Player.Get();
+		if (Pickup == nullptr || Pickup->IsPendingKill() || Player == nullptr)
+		{
+			if (Pickup != nullptr && !Pickup->IsPendingKill())
+			{
+				Pickup->SetMagnetized(false);
+			}
+			Attractions.RemoveAtSwap(i, 1, false);
+			continue;
+		}
+
+		// eases in and lifts the pickup over a small arc, the end follows the player while it moves
+		Attraction.Elapsed += DeltaTime;
+		const float Alpha = FMath::Min(Attraction.Elapsed / Attraction.Duration, 1.0f);
+		FVector Location = FMath::Lerp(Attraction.Start, Player->GetActorLocation(), Alpha * Alpha);
+		Location.Z += MagnetArcHeight * 4 * Alpha * (1 - Alpha);
+		Pickup->MoveTo(Location);
+
+		if (Alpha < 1)
+		{
+			continue;
+		}
+		Attractions.RemoveAtSwap(i, 1, false);
+
+		if (Player->GetRemoteRole() == ROLE_AutonomousProxy)
+		{
+			// the pawn of a remote client walks into it on its own machine and predicts the collection,
+			// without that prediction the server collects it before the magnet could pick it up again
+			Pickup->SetMagnetized(false);
+			Pickup->CollectUnlessPredicted(Player);
+		}
+		else
+		{
+			QueueCollect(Pickup, Player);
+		}
+	}
+}
+
+void FPickupMagnet::CollectQueued()
+{
+	SCOPE_CYCLE_COUNTER(STAT_PickupCollection);
+
+	if (Queue.Num() == 0)
+	{
+		return;
+	}
+
+	const double StartSeconds = FPlatformTime::Seconds();
+	const double Budget = CVarPickupCollectBudget.GetValueOnGameThread() / 1000.0;
+
+	TMap<AcraftingCharacter*, TArray<FInventoryDelta>> Batches;
+	int32 NumCollected = 0;
+	for (; NumCollected < Queue.Num(); NumCollected++)
+	{
+		if (NumCollected > 0 && FPlatformTime::Seconds() - StartSeconds >= Budget)
+		{
+			break;
+		}
+
+		APickupObject* Pickup = Queue[NumCollected].Pickup.Get();
+		AcraftingCharacter* Player = Queue[NumCollected].Player.Get();
+		if (Pickup == nullptr || Pickup->IsPendingKill())
+		{
+			continue;
+		}
+
+		// the batch is not in the inventory yet, it has to fit together with this pickup
+		TArray<FInventoryDelta>* Deltas = Player != nullptr ? &Batches.FindOrAdd(Player) : nullptr;
+		const FInventoryDelta* Pending = Deltas != nullptr ? Deltas->FindByPredicate([Pickup](const FInventoryDelta& Delta) { return Delta.Class == Pickup->GetClass(); }) : nullptr;
+		if (Deltas == nullptr || !Player->CanHoldItem(Pickup->GetClass(), (Pending != nullptr ? Pending->Number : 0) + 1))
+		{
+			Pickup->SetMagnetized(false);
+			continue;
+		}
+		Pickup->CollectInto(Player, *Deltas);
+	}
+	Queue.RemoveAt(0, NumCollected, false);
+
+	for (TPair<AcraftingCharacter*, TArray<FInventoryDelta>>& Batch : Batches)
+	{
+		if (Batch.Value.Num() > 0)
+		{
+			Batch.Key->AddPickedUpItems(Batch.Value);
+		}
+	}
+}
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Tickable.h"
+
+class APickupObject;
+class AcraftingCharacter;
+
+/**
+ * Pulls pickups towards the players around them and collects them in batches.
+ *
+ * Once a frame every player with a MagnetRadius looks up the pickups around it in the FPickupRelevancyGrid.
+ * Attracted pickups stop ticking and colliding and a single pass moves all of them along an arc ending at the
+ * player's current location. Arrived pickups, and pickups the server sees players walk into, are queued and
+ * collected for at most Crafting.PickupCollectBudget milliseconds a frame. Everything a player collected in a
+ * frame reaches the inventory through one ApplyInventoryDeltas call, so a crate spilling dozens of pickups
+ * costs one Callback broadcast instead of one per pickup.
+ *
+ * Runs on the authority only. Remote clients see the replicated movement and predict the collection once the
+ * pickup reaches their pawn, as they do for pickups they walk into.
+ */
+class FPickupMagnet : public FTickableGameObject
+{
+public:
+	explicit FPickupMagnet(UWorld* InWorld);
+
+	/** Magnet of the world, created on first use */
+	static FPickupMagnet& Get(UWorld* World);
+
+	/** Drops the magnet of the world once no player uses it anymore */
+	static void Release(const UWorld* World);
+
+	void AddPlayer(AcraftingCharacter* Player);
+	void RemovePlayer(AcraftingCharacter* Player);
+
+	/** Hides the pickup and credits it to the player within the next frames */
+	void QueueCollect(APickupObject* Pickup, AcraftingCharacter* Player);
+
+	FORCEINLINE int32 NumAttracted() const { return Attractions.Num(); }
+	FORCEINLINE int32 NumQueued() const { return Queue.Num(); }
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	void Attract();
+	void Move(float DeltaTime);
+	void CollectQueued();
+
+	struct FAttraction
+	{
+		TWeakObjectPtr<APickupObject> Pickup;
+		TWeakObjectPtr<AcraftingCharacter> Player;
+		FVector Start;
+		float Elapsed;
+		float Duration;
+	};
+
+	struct FQueuedCollection
+	{
+		TWeakObjectPtr<APickupObject> Pickup;
+		TWeakObjectPtr<AcraftingCharacter> Player;
+	};
+
+	UWorld* World;
+	TArray<TWeakObjectPtr<AcraftingCharacter>> Players;
+	TArray<FAttraction> Attractions;
+
+	/** Oldest first, drained from the front */
+	TArray<FQueuedCollection> Queue;
+};
@@ -5,6 +5,14 @@
 #include <EngineGlobals.h>
 #include <Runtime/Engine/Classes/Engine/Engine.h>
 #include "PickupObject.h"
+#include "CraftingJournal.h"
+#include "CraftingMetrics.h"
+#include "PickupRelevancyGrid.h"
+#include "PickupMagnet.h"
+
+/** Back-off after a rejected prediction, and how long the server waits for a prediction before it collects itself, shorter than the magnet's 2 s pause */
+static const float PredictionRetryDelay = 1.0f;
+static const float PredictionTimeout = 1.5f;
 
 // Sets default values
 APickupObject::APickupObject()
@@ -14,6 +22,22 @@ APickupObject::APickupObject()
 
 	bIsRare = false;
 	TimeCounter = 0;
+	GridWidth = 1;
+	GridHeight = 1;
+	MaxStackSize = 20;
+	bIsPredictedCollected = false;
+	NextPredictionTime = 0;
+	bIsMagnetized = false;
+	NextMagnetTime = 0;
+
+	// spawned and destroyed by the server, clients predict the collection of their own pawn
+	bReplicates = true;
+	bReplicateMovement = true;
+
+	// nothing changes until the pickup is collected or moved, both wake it up
+	NetDormancy = DORM_Initial;
+	NetUpdateFrequency = 1.0f;
+	RelevancyCell = FIntPoint::ZeroValue;
 
 	Shape = CreateDefaultSubobject<UCapsuleComponent>(TEXT("Collision Shape"));
 	Shape->SetupAttachment(RootComponent);
@@ -32,13 +56,199 @@ bool APickupObject::IsRare() const
 	return bIsRare;
 }
 
+void APickupObject::Collect(AcraftingCharacter* Player)
+{
+	check(HasAuthority());
+
+	RecordCollection(Player);
+	Player->IncreaseItemNumber(this);
+
+	// the destruction has to reach the clients that still hold the dormant pickup
+	FlushNetDormancy();
+	Destroy();
+}
+
+void APickupObject::CollectInto(AcraftingCharacter* Player, TArray<FInventoryDelta>& Deltas)
+{
+	check(HasAuthority());
+
+	RecordCollection(Player);
+	FInventoryDelta* Delta = Deltas.FindByPredicate([this](const FInventoryDelta& It) { return It.Class == GetClass(); });
+	if (Delta != nullptr)
+	{
+		++Delta->Number;
+	}
+	else
+	{
+		Deltas.Add(FInventoryDelta{ GetClass(), 1 });
+	}
+
+	FlushNetDormancy();
+	Destroy();
+}
+
+void APickupObject::RecordCollection(AcraftingCharacter* Player)
+{
+	FCraftingMetrics::Get().CountPickup();
+	if (FCraftingJournal* Journal = FCraftingJournal::Get())
+	{
+		Journal->Record(ECraftingJournalEvent::Pickup, Player->GetJournalPlayerId(), GetClass(), 1);
+	}
+}
+
+void APickupObject::SetMagnetized(bool bMagnetized)
+{
+	bIsMagnetized = bMagnetized;
+	SetActorTickEnabled(!bMagnetized);
+	SetActorEnableCollision(!bMagnetized);
+
+	if (bMagnetized)
+	{
+		// it moves every frame now, staying dormant would only flush it again and again
+		SetNetDormancy(DORM_Awake);
+		NetUpdateFrequency = 30.0f;
+	}
+	else
+	{
+		SetActorHiddenInGame(false);
+		NetUpdateFrequency = GetClass()->GetDefaultObject<APickupObject>()->NetUpdateFrequency;
+		SetNetDormancy(DORM_DormantAll);
+		NextMagnetTime = GetWorld()->GetTimeSeconds() + 2.0f;
+	}
+}
+
+bool APickupObject::CanBeMagnetized() const
+{
+	return !bIsMagnetized && !bIsPredictedCollected && !IsPendingKill() && GetWorld()->GetTimeSeconds() >= NextMagnetTime;
+}
+
+void APickupObject::MoveTo(const FVector& NewLocation)
+{
+	FlushNetDormancy();
+	SetActorLocation(NewLocation);
+}
+
+void APickupObject::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	RelevancyCell = FPickupRelevancyGrid::GetCell(GetActorLocation());
+
+	// teleports, physics, attachment and replicated movement move the pickup without MoveTo
+	if (RootComponent != nullptr)
+	{
+		RootComponent->TransformUpdated.AddUObject(this, &APickupObject::OnRootTransformUpdated);
+	}
+}
+
+void APickupObject::OnRootTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	const FIntPoint OldCell = RelevancyCell;
+	RelevancyCell = FPickupRelevancyGrid::GetCell(GetActorLocation());
+	if (RelevancyCell != OldCell && HasActorBegunPlay())
+	{
+		FPickupRelevancyGrid::Get(GetWorld()).Update(this, OldCell);
+	}
+}
+
+bool APickupObject::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	// same early outs as AActor::IsNetRelevantFor, only its distance check is replaced
+	if (bAlwaysRelevant || IsOwnedBy(ViewTarget) || IsOwnedBy(RealViewer) || this == ViewTarget || ViewTarget == Instigator)
+	{
+		return true;
+	}
+	if (bNetUseOwnerRelevancy && Owner != nullptr)
+	{
+		return Owner->IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+	}
+	if (bOnlyRelevantToOwner)
+	{
+		return false;
+	}
+	if (bHidden && (RootComponent == nullptr || !RootComponent->IsCollisionEnabled()))
+	{
+		return false;
+	}
+
+	// replaces the per connection distance check against NetCullDistanceSquared
+	return FPickupRelevancyGrid::IsCellRelevant(FPickupRelevancyGrid::GetCell(SrcLocation), RelevancyCell);
+}
+
+void APickupObject::SetPredictedCollected(bool bCollected)
+{
+	bIsPredictedCollected = bCollected;
+	SetActorHiddenInGame(bCollected);
+	SetActorEnableCollision(!bCollected);
+	if (!bCollected)
+	{
+		// no new overlap begins while the pawn keeps standing in the pickup, look for it again after the back-off
+		NextPredictionTime = GetWorld()->GetTimeSeconds() + PredictionRetryDelay;
+		GetWorldTimerManager().SetTimer(PredictionTimer, this, &APickupObject::RetryPrediction, PredictionRetryDelay, false);
+	}
+}
+
+void APickupObject::RetryPrediction()
+{
+	if (IsPendingKill() || bIsPredictedCollected)
+	{
+		return;
+	}
+
+	TArray<AActor*> Overlapping;
+	GetOverlappingActors(Overlapping, AcraftingCharacter::StaticClass());
+	for (AActor* Actor : Overlapping)
+	{
+		AcraftingCharacter* Player = CastChecked<AcraftingCharacter>(Actor);
+		if (Player->IsLocallyControlled() && Player->CanHoldItem(GetClass(), 1))
+		{
+			Player->PredictPickup(this);
+			return;
+		}
+	}
+}
+
+void APickupObject::CollectUnlessPredicted(AcraftingCharacter* Player)
+{
+	check(HasAuthority());
+	GetWorldTimerManager().SetTimer(PredictionTimer, FTimerDelegate::CreateUObject(this, &APickupObject::OnPredictionTimeout, TWeakObjectPtr<AcraftingCharacter>(Player)), PredictionTimeout, false);
+}
+
+void APickupObject::OnPredictionTimeout(TWeakObjectPtr<AcraftingCharacter> Player)
+{
+	// a prediction that arrived meanwhile already destroyed the pickup, one that arrives later is rejected and rolled back
+	AcraftingCharacter* Collector = Player.Get();
+	if (Collector != nullptr && !IsPendingKill() && !bIsMagnetized && IsOverlappingActor(Collector))
+	{
+		FPickupMagnet::Get(GetWorld()).QueueCollect(this, Collector);
+	}
+}
+
 void APickupObject::OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult & SweepResult)
 {
-	APawn *playerPawn = GetWorld()->GetFirstPlayerController()->GetPawn();
-	if (this->IsValidLowLevelFast() && OtherActor != nullptr && OtherActor != this && OtherActor->GetClass() == playerPawn->GetClass())
+	// whoever walked into the pickup collects it, with split screen that is not always the first player
+	AcraftingCharacter* Player = Cast<AcraftingCharacter>(OtherActor);
+	if (Player == nullptr || IsPendingKill() || bIsPredictedCollected || bIsMagnetized || !Player->CanHoldItem(GetClass(), 1))
+	{
+		return;
+	}
+
+	if (!HasAuthority())
+	{
+		// clients only predict for their own pawn, the server collects for everybody else
+		if (Player->IsLocallyControlled() && GetWorld()->GetTimeSeconds() >= NextPredictionTime)
+		{
+			Player->PredictPickup(this);
+		}
+	}
+	else if (Player->GetRemoteRole() != ROLE_AutonomousProxy)
+	{
+		// pawns of remote clients collect through their predicted request instead, the rest is batched per frame
+		FPickupMagnet::Get(GetWorld()).QueueCollect(this, Player);
+	}
+	else
 	{
-		int number = Cast<AcraftingCharacter>(playerPawn)->IncreaseItemNumber(this);
-		this->Destroy();
+		CollectUnlessPredicted(Player);
 	}
 }
 
@@ -47,6 +257,26 @@ void APickupObject::BeginPlay()
 {
 	Super::BeginPlay();
 	
+	FCraftingMetrics::Get().AddPickupActors(1);
+	FPickupRelevancyGrid::Get(GetWorld()).Add(this);
+
+	// spawned pickups replicate once when they become relevant and go dormant right after
+	if (HasAuthority() && !IsNetStartupActor())
+	{
+		SetNetDormancy(DORM_DormantAll);
+	}
+}
+
+void APickupObject::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FCraftingMetrics::Get().AddPickupActors(-1);
+	if (HasActorBegunPlay())
+	{
+		FPickupRelevancyGrid::Get(GetWorld()).Remove(this);
+		FPickupRelevancyGrid::Release(GetWorld());
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
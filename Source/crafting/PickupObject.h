@@ -14,9 +14,17 @@ public:
 	// Sets default values for this actor's properties
 	APickupObject();
 
+	/** Hard icon reference the inventory widgets still read, clear it once Icon is set and the widgets use GetItemIcon */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance")
 		UTexture2D* Texture;
 
+	/** Inventory icon, streamed in by FCraftingContentStreamer when an inventory shows it */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance")
+		TAssetPtr<UTexture2D> Icon;
+
+	/** Icon if set, the hard Texture otherwise */
+	TAssetPtr<UTexture2D> GetIcon() const { return Icon.IsNull() ? TAssetPtr<UTexture2D>(Texture) : Icon; }
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance")
 		class UStaticMeshComponent* Mesh;
 
@@ -32,17 +40,85 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Type")
 		bool bIsRare;
 
+	/** Cells the item covers in a grid inventory */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory", meta = (ClampMin = "1", ClampMax = "64"))
+		int GridWidth;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory", meta = (ClampMin = "1"))
+		int GridHeight;
+
+	/** Items one stack of a grid inventory holds */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory", meta = (ClampMin = "1"))
+		int MaxStackSize;
+
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Type")
 		bool IsRare() const;
 
 	float TimeCounter;
 
+	/** Credits the player with the pickup and destroys it, authority only */
+	void Collect(class AcraftingCharacter* Player);
+
+	/** Like Collect, but adds the item to a batch of deltas the caller applies later, authority only */
+	void CollectInto(class AcraftingCharacter* Player, TArray<struct FInventoryDelta>& Deltas);
+
+	/** Hands the pickup to FPickupMagnet: no tick and no collision, awake on the network so its moves replicate */
+	void SetMagnetized(bool bMagnetized);
+
+	FORCEINLINE bool IsMagnetized() const { return bIsMagnetized; }
+
+	/** Whether FPickupMagnet may attract the pickup now */
+	bool CanBeMagnetized() const;
+
+	/** Hides the pickup on the owning client while the server decides on a predicted collection */
+	void SetPredictedCollected(bool bCollected);
+
+	FORCEINLINE bool IsPredictedCollected() const { return bIsPredictedCollected; }
+
+	/** Server side, collects for the pawn of a remote client that still stands in the pickup when its predicted request never came */
+	void CollectUnlessPredicted(class AcraftingCharacter* Player);
+
+	/** Moves the pickup, waking it up on the network so the move reaches the clients */
+	UFUNCTION(BlueprintCallable, Category = "Network")
+		void MoveTo(const FVector& NewLocation);
+
+	FORCEINLINE const FIntPoint& GetRelevancyCell() const { return RelevancyCell; }
+
+	virtual void PostInitializeComponents() override;
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
 	UFUNCTION()
 	void OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult & SweepResult);
 
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	bool bIsPredictedCollected;
+	bool bIsMagnetized;
+
+	/** A released pickup is not attracted again before this time, e.g. when the player filled up meanwhile */
+	float NextMagnetTime;
+
+	/** Metrics and journal of a collection */
+	void RecordCollection(class AcraftingCharacter* Player);
+
+	/** FPickupRelevancyGrid cell of the pickup, follows every move of the root component */
+	FIntPoint RelevancyCell;
+
+	void OnRootTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+
+	/** A rejected prediction is not retried before this time, the pawn usually still stands in the pickup */
+	float NextPredictionTime;
+
+	/** Client side, predicts again for the local pawn once the back-off of a rejected prediction ran out */
+	void RetryPrediction();
+
+	/** Server side, the remote pawn's request did not arrive in time */
+	void OnPredictionTimeout(TWeakObjectPtr<class AcraftingCharacter> Player);
+
+	FTimerHandle PredictionTimer;
 
 public:	
 	// Called every frame
@@ -0,0 +1,313 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "craftingCharacter.h"
+#include "PickupCommon.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/AutomationCommon.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && WITH_EDITOR
+
+#include "Editor.h"
+#include "Settings/LevelEditorPlaySettings.h"
+#include "Engine/NetDriver.h"
+#include "EngineUtils.h"
+
+/**
+ * Plays a listen server and one client in the editor with lagging and lossy packets. The client predicts a ring of
+ * pickups next to its pawn while the host takes every other one on the server first, so those predictions are
+ * rejected and rolled back. Passes once every prediction was answered and both sides agree on the inventories.
+ */
+class FPickupPredictionTestCommand : public IAutomationLatentCommand
+{
+public:
+	FPickupPredictionTestCommand(FAutomationTestBase* InTest, int32 InPktLag, int32 InPktLoss)
+		: Test(InTest)
+		, PktLag(InPktLag)
+		, PktLoss(InPktLoss)
+		, Step(EStep::StartPlay)
+		, StepStartTime(0)
+		, OldNetMode(EPlayNetMode::PIE_Standalone)
+		, OldNumberOfClients(1)
+		, bOldRunUnderOneProcess(true)
+		, ServerPawn(nullptr)
+		, HostPawn(nullptr)
+		, ClientPawn(nullptr)
+		, ClientItemsBefore(0)
+		, ServerItemsBefore(0)
+		, HostItemsBefore(0)
+		, NumContested(0)
+	{
+	}
+
+	virtual bool Update() override
+	{
+		switch (Step)
+		{
+		case EStep::StartPlay:
+			StartPlay();
+			return false;
+		case EStep::WaitForPlayers:
+			if (FindPlayers())
+			{
+				SpawnPickups();
+			}
+			return CheckTimeout(TEXT("the client never joined"));
+		case EStep::WaitForReplication:
+			if (FindReplicatedPickups())
+			{
+				Predict();
+			}
+			return CheckTimeout(TEXT("the pickups never replicated to the client"));
+		case EStep::WaitForConvergence:
+			if (HasConverged())
+			{
+				return EndPlay();
+			}
+			if (GetStepTime() > Timeout)
+			{
+				Test->AddError(FString::Printf(TEXT("No convergence after %.0f s: %d predictions open, client %d items, server %d items, host %d items"),
+					Timeout, ClientPawn->GetNumPredictedPickups(), ClientPawn->GetItemNumber(PickupClass), ServerPawn->GetItemNumber(PickupClass), HostPawn->GetItemNumber(PickupClass)));
+				return EndPlay();
+			}
+			return false;
+		}
+		return true;
+	}
+
+private:
+	enum class EStep : uint8
+	{
+		StartPlay,
+		WaitForPlayers,
+		WaitForReplication,
+		WaitForConvergence
+	};
+
+	static const int32 NumPickups = 8;
+	static const float Timeout;
+
+	void StartPlay()
+	{
+		ULevelEditorPlaySettings* PlaySettings = GetMutableDefault<ULevelEditorPlaySettings>();
+		PlaySettings->GetPlayNetMode(OldNetMode);
+		PlaySettings->GetPlayNumberOfClients(OldNumberOfClients);
+		PlaySettings->GetRunUnderOneProcess(bOldRunUnderOneProcess);
+
+		PlaySettings->SetPlayNetMode(EPlayNetMode::PIE_ListenServer);
+		PlaySettings->SetPlayNumberOfClients(2);
+		PlaySettings->SetRunUnderOneProcess(true);
+
+		GEditor->RequestPlaySession(false, nullptr, false);
+		SetStep(EStep::WaitForPlayers);
+	}
+
+	bool EndPlay()
+	{
+		GEditor->RequestEndPlayMap();
+
+		ULevelEditorPlaySettings* PlaySettings = GetMutableDefault<ULevelEditorPlaySettings>();
+		PlaySettings->SetPlayNetMode(OldNetMode);
+		PlaySettings->SetPlayNumberOfClients(OldNumberOfClients);
+		PlaySettings->SetRunUnderOneProcess(bOldRunUnderOneProcess);
+		return true;
+	}
+
+	bool FindPlayers()
+	{
+		UWorld* ServerWorld = nullptr;
+		UWorld* ClientWorld = nullptr;
+		for (const FWorldContext& Context : GEngine->GetWorldContexts())
+		{
+			UWorld* World = Context.World();
+			if (Context.WorldType == EWorldType::PIE && World != nullptr)
+			{
+				if (World->GetNetMode() == NM_ListenServer)
+				{
+					ServerWorld = World;
+				}
+				else if (World->GetNetMode() == NM_Client)
+				{
+					ClientWorld = World;
+				}
+			}
+		}
+		if (ServerWorld == nullptr || ClientWorld == nullptr)
+		{
+			return false;
+		}
+
+		ServerPawn = HostPawn = ClientPawn = nullptr;
+		for (TActorIterator<AcraftingCharacter> It(ServerWorld); It; ++It)
+		{
+			if (It->Controller == nullptr)
+			{
+				continue;
+			}
+			if (It->IsLocallyControlled())
+			{
+				HostPawn = *It;
+			}
+			else
+			{
+				ServerPawn = *It;
+			}
+		}
+		for (TActorIterator<AcraftingCharacter> It(ClientWorld); It; ++It)
+		{
+			if (It->IsLocallyControlled())
+			{
+				ClientPawn = *It;
+			}
+		}
+		if (ServerPawn == nullptr || HostPawn == nullptr || ClientPawn == nullptr)
+		{
+			return false;
+		}
+
+#if DO_ENABLE_NET_TEST
+		// both directions lag and lose packets, the reliable RPCs get resent and arrive late instead
+		UWorld* Worlds[] = { ServerWorld, ClientWorld };
+		for (UWorld* World : Worlds)
+		{
+			if (UNetDriver* NetDriver = World->GetNetDriver())
+			{
+				NetDriver->PacketSimulationSettings.PktLag = PktLag;
+				NetDriver->PacketSimulationSettings.PktLoss = PktLoss;
+			}
+		}
+#else
+		Test->AddWarning(TEXT("Packet simulation is compiled out, the prediction runs without lag and loss"));
+#endif
+		return true;
+	}
+
+	void SpawnPickups()
+	{
+		// the host stays out of reach, only the explicit Collect calls below may take pickups for it
+		HostPawn->SetActorLocation(ServerPawn->GetActorLocation() + FVector(5000.0f, 0, 0));
+
+		// a ring inside PickupTolerance but outside the capsule, overlaps must not collect anything on their own
+		PickupClass = APickupCommon::StaticClass();
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		for (int32 i = 0; i < NumPickups; i++)
+		{
+			const FVector Offset = FVector(150.0f, 0, 0).RotateAngleAxis(360.0f * i / NumPickups, FVector::UpVector);
+			ServerPickups.Add(ServerPawn->GetWorld()->SpawnActor<APickupObject>(PickupClass, ServerPawn->GetActorLocation() + Offset, FRotator::ZeroRotator, SpawnParams));
+		}
+
+		ClientItemsBefore = ClientPawn->GetItemNumber(PickupClass);
+		ServerItemsBefore = ServerPawn->GetItemNumber(PickupClass);
+		HostItemsBefore = HostPawn->GetItemNumber(PickupClass);
+		SetStep(EStep::WaitForReplication);
+	}
+
+	bool FindReplicatedPickups()
+	{
+		// replicated copies are matched to the server's by position, the ring keeps them far enough apart
+		ClientPickups.Reset();
+		for (APickupObject* ServerPickup : ServerPickups)
+		{
+			APickupObject* Closest = nullptr;
+			for (TActorIterator<APickupObject> It(ClientPawn->GetWorld()); It; ++It)
+			{
+				if (FVector::DistSquared(It->GetActorLocation(), ServerPickup->GetActorLocation()) < FMath::Square(10.0f))
+				{
+					Closest = *It;
+				}
+			}
+			if (Closest == nullptr)
+			{
+				return false;
+			}
+			ClientPickups.Add(Closest);
+		}
+		return true;
+	}
+
+	void Predict()
+	{
+		for (int32 i = 0; i < NumPickups; i++)
+		{
+			ClientPawn->PredictPickup(ClientPickups[i]);
+
+			// the host wins every other pickup: the client's request is still on its way and finds it gone
+			if (i % 2 == 1)
+			{
+				ServerPickups[i]->Collect(HostPawn);
+				++NumContested;
+			}
+		}
+		Test->TestEqual(TEXT("Predicted items show up right away"), ClientPawn->GetItemNumber(PickupClass), ClientItemsBefore + NumPickups);
+		SetStep(EStep::WaitForConvergence);
+	}
+
+	bool HasConverged() const
+	{
+		const int32 Won = NumPickups - NumContested;
+		return ClientPawn->GetNumPredictedPickups() == 0
+			&& ClientPawn->GetItemNumber(PickupClass) == ClientItemsBefore + Won
+			&& ServerPawn->GetItemNumber(PickupClass) == ServerItemsBefore + Won
+			&& HostPawn->GetItemNumber(PickupClass) == HostItemsBefore + NumContested;
+	}
+
+	bool CheckTimeout(const TCHAR* What)
+	{
+		if (GetStepTime() > Timeout)
+		{
+			Test->AddError(FString::Printf(TEXT("Timed out: %s"), What));
+			return EndPlay();
+		}
+		return false;
+	}
+
+	void SetStep(EStep NewStep)
+	{
+		Step = NewStep;
+		StepStartTime = FPlatformTime::Seconds();
+	}
+
+	double GetStepTime() const
+	{
+		return FPlatformTime::Seconds() - StepStartTime;
+	}
+
+	FAutomationTestBase* Test;
+	int32 PktLag;
+	int32 PktLoss;
+	EStep Step;
+	double StepStartTime;
+
+	EPlayNetMode OldNetMode;
+	int32 OldNumberOfClients;
+	bool bOldRunUnderOneProcess;
+
+	/** The client's pawn as the server sees it, the host's own pawn and the client's pawn on the client */
+	AcraftingCharacter* ServerPawn;
+	AcraftingCharacter* HostPawn;
+	AcraftingCharacter* ClientPawn;
+
+	TSubclassOf<APickupObject> PickupClass;
+	TArray<APickupObject*> ServerPickups;
+	TArray<APickupObject*> ClientPickups;
+	int32 ClientItemsBefore;
+	int32 ServerItemsBefore;
+	int32 HostItemsBefore;
+	int32 NumContested;
+};
+
+const float FPickupPredictionTestCommand::Timeout = 20.0f;
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPickupPredictionTest, "Crafting.Network.PickupPrediction", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FPickupPredictionTest::RunTest(const FString& Parameters)
+{
+	AutomationOpenMap(TEXT("/Game/StarterContent/Maps/Minimal_Default"));
+
+	// 150 ms each way and one packet in ten lost, worse than the connections the prediction is meant to hide
+	ADD_LATENT_AUTOMATION_COMMAND(FPickupPredictionTestCommand(this, 150, 10));
+	return true;
+}
+
+#endif
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "PickupRelevancyGrid.h"
+#include "PickupObject.h"
+
+static TAutoConsoleVariable<int32> CVarPickupRelevancyRadius(
+	TEXT("Crafting.PickupRelevancyRadius"),
+	4,
+	TEXT("Pickups replicate to connections whose viewer is at most this many relevancy grid cells away"));
+
+const float FPickupRelevancyGrid::CellSize = 2048.0f;
+
+static TMap<const UWorld*, TUniquePtr<FPickupRelevancyGrid>> WorldGrids;
+
+FIntPoint FPickupRelevancyGrid::GetCell(const FVector& Location)
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+bool FPickupRelevancyGrid::IsCellRelevant(const FIntPoint& ViewerCell, const FIntPoint& Cell)
+{
+	const int32 Radius = CVarPickupRelevancyRadius.GetValueOnGameThread();
+	return FMath::Abs(Cell.X - ViewerCell.X) <= Radius && FMath::Abs(Cell.Y - ViewerCell.Y) <= Radius;
+}
+
+FPickupRelevancyGrid& FPickupRelevancyGrid::Get(const UWorld* World)
+{
+	TUniquePtr<FPickupRelevancyGrid>& Grid = WorldGrids.FindOrAdd(World);
+	if (!Grid.IsValid())
+	{
+		Grid = MakeUnique<FPickupRelevancyGrid>();
+	}
+	return *Grid;
+}
+
+const FPickupRelevancyGrid* FPickupRelevancyGrid::Find(const UWorld* World)
+{
+	const TUniquePtr<FPickupRelevancyGrid>* Grid = WorldGrids.Find(World);
+	return Grid != nullptr ? Grid->Get() : nullptr;
+}
+
+void FPickupRelevancyGrid::Release(const UWorld* World)
+{
+	const TUniquePtr<FPickupRelevancyGrid>* Grid = WorldGrids.Find(World);
+	if (Grid != nullptr && (*Grid)->Num() == 0)
+	{
+		WorldGrids.Remove(World);
+	}
+}
+
+void FPickupRelevancyGrid::Add(APickupObject* Pickup)
+{
+	Cells.FindOrAdd(Pickup->GetRelevancyCell()).Add(Pickup);
+	++NumPickups;
+}
+
+void FPickupRelevancyGrid::Remove(APickupObject* Pickup)
+{
+	RemoveFromCell(Pickup, Pickup->GetRelevancyCell());
+	--NumPickups;
+}
+
+void FPickupRelevancyGrid::Update(APickupObject* Pickup, const FIntPoint& OldCell)
+{
+	if (OldCell != Pickup->GetRelevancyCell())
+	{
+		RemoveFromCell(Pickup, OldCell);
+		Cells.FindOrAdd(Pickup->GetRelevancyCell()).Add(Pickup);
+	}
+}
+
+void FPickupRelevancyGrid::RemoveFromCell(APickupObject* Pickup, const FIntPoint& Cell)
+{
+	TArray<APickupObject*>* Pickups = Cells.Find(Cell);
+	if (Pickups != nullptr)
+	{
+		Pickups->RemoveSingleSwap(Pickup, false);
+		if (Pickups->Num() == 0)
+		{
+			Cells.Remove(Cell);
+		}
+	}
+}
+
+void FPickupRelevancyGrid::GetRelevantPickups(const FVector& ViewLocation, TArray<APickupObject*>& OutPickups) const
+{
+	const FIntPoint ViewerCell = GetCell(ViewLocation);
+	const int32 Radius = CVarPickupRelevancyRadius.GetValueOnGameThread();
+	for (int32 Y = ViewerCell.Y - Radius; Y <= ViewerCell.Y + Radius; Y++)
+	{
+		for (int32 X = ViewerCell.X - Radius; X <= ViewerCell.X + Radius; X++)
+		{
+			if (const TArray<APickupObject*>* Pickups = Cells.Find(FIntPoint(X, Y)))
+			{
+				OutPickups.Append(*Pickups);
+			}
+		}
+	}
+}
+
+void FPickupRelevancyGrid::GetPickupsInRadius(const FVector& Location, float Radius, TArray<APickupObject*>& OutPickups) const
+{
+	const FIntPoint MinCell = GetCell(Location - FVector(Radius, Radius, 0));
+	const FIntPoint MaxCell = GetCell(Location + FVector(Radius, Radius, 0));
+	const float RadiusSquared = FMath::Square(Radius);
+	for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+	{
+		for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+		{
+			if (const TArray<APickupObject*>* Pickups = Cells.Find(FIntPoint(X, Y)))
+			{
+				for (APickupObject* Pickup : *Pickups)
+				{
+					if (FVector::DistSquared(Pickup->GetActorLocation(), Location) <= RadiusSquared)
+					{
+						OutPickups.Add(Pickup);
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class APickupObject;
+
+/**
+ * Coarse grid over the pickups of a world, used for their replication relevancy.
+ *
+ * A pickup is relevant to a connection when its cell is within Crafting.PickupRelevancyRadius cells of the
+ * viewer's cell, which is two integer compares instead of a distance check per pickup and connection. The
+ * cell lists find the pickups around a location without walking all of them, e.g. the ones a viewer starts
+ * seeing after crossing into a new cell.
+ */
+class FPickupRelevancyGrid
+{
+public:
+	static const float CellSize;
+
+	static FIntPoint GetCell(const FVector& Location);
+	static bool IsCellRelevant(const FIntPoint& ViewerCell, const FIntPoint& Cell);
+
+	/** Grid of the pickups that began play in the world, created on first use */
+	static FPickupRelevancyGrid& Get(const UWorld* World);
+
+	/** Grid of the world, null while no pickup began play in it */
+	static const FPickupRelevancyGrid* Find(const UWorld* World);
+
+	/** Drops the grid of the world once it holds no pickups anymore */
+	static void Release(const UWorld* World);
+
+	void Add(APickupObject* Pickup);
+	void Remove(APickupObject* Pickup);
+
+	/** Moves the pickup from OldCell to the cell it is in now */
+	void Update(APickupObject* Pickup, const FIntPoint& OldCell);
+
+	/** Appends the pickups relevant to a viewer at ViewLocation */
+	void GetRelevantPickups(const FVector& ViewLocation, TArray<APickupObject*>& OutPickups) const;
+
+	/** Appends the pickups within Radius of Location, only the cells the circle touches are visited */
+	void GetPickupsInRadius(const FVector& Location, float Radius, TArray<APickupObject*>& OutPickups) const;
+
+	FORCEINLINE int32 Num() const { return NumPickups; }
+
+private:
+	void RemoveFromCell(APickupObject* Pickup, const FIntPoint& Cell);
+
+	TMap<FIntPoint, TArray<APickupObject*>> Cells;
+	int32 NumPickups = 0;
+};
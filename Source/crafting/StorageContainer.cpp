@@ -0,0 +1,230 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "crafting.h"
+#include "StorageContainer.h"
+#include "CraftingJournal.h"
+#include "CraftingMetrics.h"
+
+AStorageContainer::AStorageContainer()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	Mesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Mesh"));
+	RootComponent = Mesh;
+}
+
+int AStorageContainer::GetItemNumber(TSubclassOf<APickupObject> ItemClass) const
+{
+	const FPickupItem* Item = Items.FindByPredicate([ItemClass](const FPickupItem& It) { return It.Class == ItemClass; });
+	return Item != nullptr ? Item->Number : 0;
+}
+
+int AStorageContainer::Deposit(AcraftingCharacter* Player, TSubclassOf<APickupObject> ItemClass, int Number)
+{
+	Number = Player != nullptr && ItemClass != nullptr ? FMath::Min(Number, Player->GetItemNumber(ItemClass)) : 0;
+	if (Number <= 0)
+	{
+		return 0;
+	}
+
+	Player->ApplyInventoryDeltas({ FInventoryDelta{ ItemClass, -Number } });
+	ApplyInventoryDeltas({ FInventoryDelta{ ItemClass, Number } });
+	return Number;
+}
+
+int AStorageContainer::Withdraw(AcraftingCharacter* Player, TSubclassOf<APickupObject> ItemClass, int Number)
+{
+	Number = Player != nullptr && ItemClass != nullptr ? FMath::Min(Number, GetItemNumber(ItemClass)) : 0;
+	if (Number <= 0)
+	{
+		return 0;
+	}
+
+	// a full grid inventory would push the rest into its overflow, only take what fits
+	if (!Player->CanHoldItem(ItemClass, Number))
+	{
+		int32 Low = 0;
+		int32 High = Number - 1;
+		while (Low < High)
+		{
+			const int32 Mid = Low + (High - Low + 1) / 2;
+			if (Player->CanHoldItem(ItemClass, Mid))
+			{
+				Low = Mid;
+			}
+			else
+			{
+				High = Mid - 1;
+			}
+		}
+		Number = Low;
+		if (Number == 0)
+		{
+			return 0;
+		}
+	}
+
+	ApplyInventoryDeltas({ FInventoryDelta{ ItemClass, -Number } });
+	Player->ApplyInventoryDeltas({ FInventoryDelta{ ItemClass, Number } });
+	return Number;
+}
+
+void AStorageContainer::ApplyInventoryDeltas(const TArray<FInventoryDelta>& Deltas)
+{
+	FScopedInventoryMutationTimer MutationTimer;
+
+	// deltas as they were really applied, removals are clamped to what the container held
+	TArray<FInventoryDelta> Applied;
+	for (const FInventoryDelta& Delta : Deltas)
+	{
+		if (Delta.Class == nullptr || Delta.Number == 0)
+		{
+			continue;
+		}
+
+		const int32 Index = Items.IndexOfByPredicate([&Delta](const FPickupItem& It) { return It.Class == Delta.Class; });
+		int OldNumber = 0;
+		int NewNumber = 0;
+		if (Index == INDEX_NONE)
+		{
+			if (Delta.Number < 0)
+			{
+				continue;
+			}
+			NewNumber = Delta.Number;
+			Items.Add(AcraftingCharacter::MakePickupItem(Delta.Class, NewNumber));
+		}
+		else
+		{
+			OldNumber = Items[Index].Number;
+			NewNumber = FMath::Max(0, OldNumber + Delta.Number);
+			Items[Index].Number = NewNumber;
+			if (NewNumber == 0)
+			{
+				Items.RemoveAt(Index);
+			}
+		}
+		Applied.Add(FInventoryDelta{ Delta.Class, NewNumber - OldNumber });
+
+		if (FCraftingJournal* Journal = FCraftingJournal::Get())
+		{
+			Journal->Record(ECraftingJournalEvent::ItemChanged, FCraftingJournal::GetStableId(GetPathName()), Delta.Class, NewNumber);
+		}
+	}
+
+	if (Applied.Num() > 0)
+	{
+		ItemsChanged.Broadcast(Applied);
+		FCraftingMetrics::Get().CountCallbackBroadcast();
+		Callback.Broadcast();
+	}
+}
+
+void AStorageContainer::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	EndPlayEvent.Broadcast(this);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FStorageAggregate
+
+FStorageAggregate::~FStorageAggregate()
+{
+	Reset();
+}
+
+void FStorageAggregate::AddContainer(AStorageContainer* Container)
+{
+	if (Container == nullptr || Containers.Contains(Container))
+	{
+		return;
+	}
+
+	Containers.Add(Container);
+	Handles.Add(Container->OnItemsChanged().AddRaw(this, &FStorageAggregate::OnItemsChanged));
+	EndPlayHandles.Add(Container->OnEndPlay().AddRaw(this, &FStorageAggregate::RemoveContainer));
+
+	// what the container already holds arrives as one delta per stack
+	TArray<FInventoryDelta> Deltas;
+	for (const FPickupItem& Item : Container->GetItems())
+	{
+		Deltas.Add(FInventoryDelta{ Item.Class, Item.Number });
+	}
+	OnItemsChanged(Deltas);
+}
+
+void FStorageAggregate::RemoveContainer(AStorageContainer* Container)
+{
+	const int32 Index = Containers.IndexOfByKey(Container);
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	Container->OnItemsChanged().Remove(Handles[Index]);
+	Container->OnEndPlay().Remove(EndPlayHandles[Index]);
+	Containers.RemoveAt(Index);
+	Handles.RemoveAt(Index);
+	EndPlayHandles.RemoveAt(Index);
+
+	TArray<FInventoryDelta> Deltas;
+	for (const FPickupItem& Item : Container->GetItems())
+	{
+		Deltas.Add(FInventoryDelta{ Item.Class, -Item.Number });
+	}
+	OnItemsChanged(Deltas);
+}
+
+void FStorageAggregate::Reset()
+{
+	for (int32 i = 0; i < Containers.Num(); i++)
+	{
+		if (AStorageContainer* Container = Containers[i].Get())
+		{
+			Container->OnItemsChanged().Remove(Handles[i]);
+			Container->OnEndPlay().Remove(EndPlayHandles[i]);
+		}
+	}
+	Containers.Reset();
+	Handles.Reset();
+	EndPlayHandles.Reset();
+	Items.Reset();
+	Slots.Reset();
+}
+
+int32 FStorageAggregate::GetItemNumber(UClass* ItemClass) const
+{
+	const int32* Slot = Slots.Find(ItemClass);
+	return Slot != nullptr ? Items[*Slot].Number : 0;
+}
+
+void FStorageAggregate::OnItemsChanged(const TArray<FInventoryDelta>& Deltas)
+{
+	for (const FInventoryDelta& Delta : Deltas)
+	{
+		const int32* Slot = Slots.Find(Delta.Class);
+		if (Slot == nullptr)
+		{
+			if (Delta.Number > 0)
+			{
+				Slots.Add(Delta.Class, Items.Add(AcraftingCharacter::MakePickupItem(Delta.Class, Delta.Number)));
+			}
+			continue;
+		}
+
+		const int32 Index = *Slot;
+		Items[Index].Number += Delta.Number;
+		if (Items[Index].Number <= 0)
+		{
+			// swap the last stack into the hole so no other slot index changes but one
+			Slots.Remove(Delta.Class);
+			Items.RemoveAtSwap(Index);
+			if (Index < Items.Num())
+			{
+				Slots.Add(Items[Index].Class, Index);
+			}
+		}
+	}
+}
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GameFramework/Actor.h"
+#include "craftingCharacter.h"
+#include "StorageContainer.generated.h"
+
+/**
+ * Chest in the world holding stacks the same way the player inventory does. Every change goes through
+ * ApplyInventoryDeltas, which broadcasts the applied deltas to the stations linked to the container.
+ */
+UCLASS()
+class CRAFTING_API AStorageContainer : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AStorageContainer();
+
+	DECLARE_EVENT_OneParam(AStorageContainer, FOnItemsChanged, const TArray<FInventoryDelta>&);
+	DECLARE_EVENT_OneParam(AStorageContainer, FOnEndPlay, AStorageContainer*);
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Appearance")
+		class UStaticMeshComponent* Mesh;
+
+	UPROPERTY(BlueprintAssignable, Category = "Storage")
+		FItemsDelegate Callback;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Storage")
+		int GetItemNumber(TSubclassOf<APickupObject> ItemClass) const;
+
+	/** Moves up to Number items from the player into the container, returns how many were moved */
+	UFUNCTION(BlueprintCallable, Category = "Storage")
+		int Deposit(AcraftingCharacter* Player, TSubclassOf<APickupObject> ItemClass, int Number);
+
+	/** Moves up to Number items from the container to the player, as many as the player can hold, returns how many were moved */
+	UFUNCTION(BlueprintCallable, Category = "Storage")
+		int Withdraw(AcraftingCharacter* Player, TSubclassOf<APickupObject> ItemClass, int Number);
+
+	/** Applies all deltas, broadcasts Callback once and OnItemsChanged with the deltas as they were applied */
+	void ApplyInventoryDeltas(const TArray<FInventoryDelta>& Deltas);
+
+	FORCEINLINE const TArray<FPickupItem>& GetItems() const { return Items; }
+
+	FOnItemsChanged& OnItemsChanged() { return ItemsChanged; }
+
+	/** Broadcast when the container leaves the world, whoever counts its items has to forget them */
+	FOnEndPlay& OnEndPlay() { return EndPlayEvent; }
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Storage")
+		TArray<FPickupItem> Items;
+
+private:
+	FOnItemsChanged ItemsChanged;
+	FOnEndPlay EndPlayEvent;
+};
+
+/**
+ * Per class totals over a set of containers. The totals are only touched by the deltas the containers
+ * broadcast, so asking how many items all linked containers hold never walks the containers.
+ */
+class FStorageAggregate
+{
+public:
+	~FStorageAggregate();
+
+	void AddContainer(AStorageContainer* Container);
+	void RemoveContainer(AStorageContainer* Container);
+	void Reset();
+
+	int32 GetItemNumber(UClass* ItemClass) const;
+
+	/** One stack per class with the totals of all containers */
+	const TArray<FPickupItem>& GetItems() const { return Items; }
+
+	const TArray<TWeakObjectPtr<AStorageContainer>>& GetContainers() const { return Containers; }
+
+private:
+	void OnItemsChanged(const TArray<FInventoryDelta>& Deltas);
+
+	TArray<TWeakObjectPtr<AStorageContainer>> Containers;
+	TArray<FDelegateHandle> Handles;
+	TArray<FDelegateHandle> EndPlayHandles;
+
+	TArray<FPickupItem> Items;
+	TMap<UClass*, int32> Slots;
+};
@@ -7,5 +7,13 @@ public class crafting : ModuleRules
 	public crafting(TargetInfo Target)
 	{
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "HeadMountedDisplay", "UMG" });
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "Sockets", "Networking" });
+
+		// the pickup prediction test plays a listen server and a client in the editor
+		if (UEBuildConfiguration.bBuildEditor)
+		{
+			PrivateDependencyModuleNames.Add("UnrealEd");
+		}
 	}
 }
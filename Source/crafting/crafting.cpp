@@ -1,7 +1,30 @@
 // Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
 
 #include "crafting.h"
+#include "CraftingJournal.h"
+#include "CraftingContentStreamer.h"
+#include "CraftingMetrics.h"
 
+class FCraftingModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		int32 MetricsPort = 0;
+		if (FParse::Value(FCommandLine::Get(), TEXT("CraftingMetricsPort="), MetricsPort))
+		{
+			FCraftingMetricsExporter::Start(MetricsPort);
+		}
+	}
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, crafting, "crafting" );
- 
\ No newline at end of file
+	virtual void ShutdownModule() override
+	{
+		FCraftingMetricsExporter::Stop();
+		FCraftingJournal::Shutdown();
+		FCraftingContentStreamer::Shutdown();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FCraftingModule, crafting, "crafting" );
+
+DEFINE_LOG_CATEGORY(LogCrafting);
@@ -5,5 +5,8 @@
 
 #include "EngineMinimal.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogCrafting, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("Crafting"), STATGROUP_Crafting, STATCAT_Advanced);
 
 #endif
@@ -5,14 +5,28 @@
 #include "craftingProjectile.h"
 #include "Animation/AnimInstance.h"
 #include "GameFramework/InputSettings.h"
+#include "GameFramework/PlayerState.h"
+#include "Engine/LocalPlayer.h"
 #include "Kismet/HeadMountedDisplayFunctionLibrary.h"
 #include <EngineGlobals.h>
 #include <Runtime/Engine/Classes/Engine/Engine.h>
 #include "Kismet/KismetMathLibrary.h"
 #include "MotionControllerComponent.h"
+#include "InventorySave.h"
+#include "CraftingJournal.h"
+#include "CraftingReplay.h"
+#include "CraftingContentStreamer.h"
+#include "CraftingRecipeMatcher.h"
+#include "CraftingRecipeIndex.h"
+#include "CraftingMetrics.h"
+#include "CraftingMemory.h"
+#include "PickupMagnet.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogFPChar, Warning, All);
 
+DECLARE_CYCLE_STAT(TEXT("Character BeginPlay"), STAT_CharacterBeginPlay, STATGROUP_Crafting);
+DECLARE_CYCLE_STAT(TEXT("Inventory Widgets"), STAT_InventoryWidgets, STATGROUP_Crafting);
+
 //////////////////////////////////////////////////////////////////////////
 // AcraftingCharacter
 
@@ -22,6 +36,36 @@ AcraftingCharacter::AcraftingCharacter()
 	bIsInventoryOpen = false;
 	bIsUIRotting = false;
 	bIsCraftingTableCurrentUI = true;
+	bHasRequestedIcons = false;
+	InventoryGridWidth = 0;
+	InventoryGridHeight = 0;
+	ItemCatalog = nullptr;
+	bPrewarmInventoryWidgets = true;
+	PrewarmDelay = 2.0f;
+	PrewarmMaxFrameTime = 1.0f / 50.0f;
+	bHasPlacedRecipeList = false;
+	BeginPlayTime = 0;
+
+	RecipeBook = nullptr;
+	CraftTableWidth = 3;
+	CraftTableHeight = 3;
+	CraftTableRecipe = INDEX_NONE;
+	UndoDepth = 64;
+	bIsApplyingHistory = false;
+	bRecordUndo = false;
+
+	InventorySaveSlot = TEXT("Player");
+	AutosaveInterval = 30.0f;
+	NumDeltaSaves = 0;
+	bFullSaveRequired = true;
+	bIsInventoryIOInFlight = false;
+	bHasLoadedInventory = false;
+	bIsLoadPending = false;
+	JournalPlayerId = 0;
+	PickupTolerance = 300.0f;
+	NextPredictionKey = 1;
+	MagnetRadius = 0;
+	MagnetSpeed = 1200.0f;
 	
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(55.f, 96.0f);
@@ -36,18 +80,19 @@ AcraftingCharacter::AcraftingCharacter()
 	FirstPersonCameraComponent->RelativeLocation = FVector(-39.56f, 1.75f, 64.f); // Position the camera
 	FirstPersonCameraComponent->bUsePawnControlRotation = true;
 
-	// Player inventory setup
-	PlayerInventory = CreateDefaultSubobject<UWidgetComponent>(TEXT("PlayerInventory"));
+	// Player inventory setup, the widgets themselves are created when the inventory is first needed
+	PlayerInventory = CreateDefaultSubobject<UCraftingWidgetComponent>(TEXT("PlayerInventory"));
 	PlayerInventory->SetupAttachment(FirstPersonCameraComponent);
 	PlayerInventory->bGenerateOverlapEvents = false;
 
 	// Player recipe list
-	RecipeList = CreateDefaultSubobject<UWidgetComponent>(TEXT("RecipeList"));
+	RecipeList = CreateDefaultSubobject<UCraftingWidgetComponent>(TEXT("RecipeList"));
 	RecipeList->SetupAttachment(FirstPersonCameraComponent);
 	RecipeList->bGenerateOverlapEvents = false;
 
 	InteractionPointer = CreateDefaultSubobject<UWidgetInteractionComponent>(TEXT("InteractionPointer"));
 	InteractionPointer->SetupAttachment(FirstPersonCameraComponent);
+	InteractionPointer->bAutoActivate = false;
 	
 	// Create a mesh component that will be used when being viewed from a '1st person' view (when controlling this pawn)
 	Mesh1P = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("CharacterMesh1P"));
@@ -103,9 +148,13 @@ AcraftingCharacter::AcraftingCharacter()
 
 void AcraftingCharacter::BeginPlay()
 {
+	SCOPE_CYCLE_COUNTER(STAT_CharacterBeginPlay);
+
 	// Call the base class  
 	Super::BeginPlay();
 
+	BeginPlayTime = GetWorld()->GetTimeSeconds();
+
 	// set player controller var
 	PlayerController = Cast<APlayerController>(GetController());
 	
@@ -123,20 +172,64 @@ void AcraftingCharacter::BeginPlay()
 		VR_Gun->SetHiddenInGame(true, true);
 		Mesh1P->SetHiddenInGame(false, true);
 	}
-	PlayerInventory->SetVisibility(false);
+	PlayerInventory->SetUIActive(false);
+	RecipeList->SetUIActive(false);
 	InteractionPointer->Deactivate();
 
-	// rotate recipe table 90 degrees
-	FVector fpsCamPos = FirstPersonCameraComponent->GetComponentToWorld().GetLocation();
-	FVector recipePos = RecipeList->GetComponentToWorld().GetLocation();
-	FVector dirFR = recipePos - fpsCamPos;
-	float distanceFR = FVector::Dist(recipePos, fpsCamPos);
-	dirFR.Normalize();
-	FVector newPosFR = UKismetMathLibrary::RotateAngleAxis(dirFR, 90, GetCapsuleComponent()->GetUpVector());
-	RecipeList->SetWorldLocation(FirstPersonCameraComponent->GetComponentToWorld().GetLocation() + newPosFR * distanceFR);
-
 	// Get current rotation of crafting table
 	UICurrentRotation = UIInitRotation = PlayerInventory->GetRelativeTransform().GetRotation().Rotator();
+
+	UndoHistory.SetMaxSteps(UndoDepth);
+
+	InventoryGrid.Init(InventoryGridWidth, InventoryGridHeight);
+	RebuildInventoryGrid();
+
+	if (RecipeBook != nullptr)
+	{
+		RecipesChangedHandle = RecipeBook->OnRecipesChanged().AddUObject(this, &AcraftingCharacter::OnRecipesChanged);
+	}
+
+	if (HasAuthority())
+	{
+		FPickupMagnet::Get(GetWorld()).AddPlayer(this);
+	}
+
+	// pawns spawned for a player begin play before they are possessed, PossessedBy starts their persistence
+	if (PlayerController != nullptr)
+	{
+		StartInventoryPersistence(PlayerController);
+	}
+}
+
+void AcraftingCharacter::PossessedBy(AController* NewController)
+{
+	Super::PossessedBy(NewController);
+
+	PlayerController = Cast<APlayerController>(NewController);
+	JournalPlayerId = 0;
+	if (PlayerController != nullptr && HasActorBegunPlay())
+	{
+		StartInventoryPersistence(PlayerController);
+	}
+}
+
+void AcraftingCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (RecipeBook != nullptr)
+	{
+		RecipeBook->OnRecipesChanged().Remove(RecipesChangedHandle);
+	}
+
+	if (HasAuthority())
+	{
+		FPickupMagnet::Get(GetWorld()).RemovePlayer(this);
+		FPickupMagnet::Release(GetWorld());
+	}
+
+	// the next autosave never comes, whatever changed since the last one would be lost on logout or map change
+	FinishInventorySave();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void AcraftingCharacter::Tick(float DeltaSeconds)
@@ -144,23 +237,33 @@ void AcraftingCharacter::Tick(float DeltaSeconds)
 	// Call the base class  
 	Super::Tick(DeltaSeconds);
 
+	// players without a controller never open the inventory, there is nothing to pre-warm for them
+	if (bPrewarmInventoryWidgets && !bIsInventoryOpen && PlayerController != nullptr
+		&& DeltaSeconds <= PrewarmMaxFrameTime && GetWorld()->GetTimeSeconds() - BeginPlayTime >= PrewarmDelay)
+	{
+		bPrewarmInventoryWidgets = PrewarmInventoryWidget();
+	}
+
 	if (bIsInventoryOpen)
 	{
-		// Rotate interaction pointer
-		FHitResult hit;
-		PlayerController->GetHitResultUnderCursor(ECollisionChannel::ECC_Visibility, true, hit);
-		FVector end = hit.Location;
-		FVector start = FirstPersonCameraComponent->GetComponentToWorld().GetLocation();
-		FQuat newRotation = FRotationMatrix::MakeFromX(end - start).Rotator().Quaternion();
-		InteractionPointer->SetWorldRotation(newRotation);
-
-		// Get mouse delta
-		FVector2D centerViewPort;
-		GetWorld()->GetGameViewport()->GetViewportSize(centerViewPort);
-		centerViewPort /= 2;
-		FVector2D MouseDelta;
-		PlayerController->GetMousePosition(MouseDelta.X, MouseDelta.Y);
-		MouseDelta = (MouseDelta - centerViewPort) / centerViewPort;
+		// Headless replays have neither a controller nor a viewport, the UI then rotates as if the mouse was centered
+		FVector2D MouseDelta = FVector2D::ZeroVector;
+		FVector2D ViewOrigin, ViewSize;
+		if (GetPlayerViewRect(ViewOrigin, ViewSize))
+		{
+			// Rotate interaction pointer
+			FHitResult hit;
+			PlayerController->GetHitResultUnderCursor(ECollisionChannel::ECC_Visibility, true, hit);
+			FVector end = hit.Location;
+			FVector start = FirstPersonCameraComponent->GetComponentToWorld().GetLocation();
+			FQuat newRotation = FRotationMatrix::MakeFromX(end - start).Rotator().Quaternion();
+			InteractionPointer->SetWorldRotation(newRotation);
+
+			// Get mouse delta from the center of this player's part of the screen
+			const FVector2D HalfView = ViewSize / 2;
+			PlayerController->GetMousePosition(MouseDelta.X, MouseDelta.Y);
+			MouseDelta = (MouseDelta - (ViewOrigin + HalfView)) / HalfView;
+		}
 
 		// Rotate player inventory
 		FRotator CameraRotation;
@@ -223,40 +326,56 @@ void AcraftingCharacter::Tick(float DeltaSeconds)
 
 int AcraftingCharacter::IncreaseItemNumber(APickupObject * po)
 {
+	FScopedInventoryMutationTimer MutationTimer;
+	TGuardValue<bool> RecordUndo(bRecordUndo, false);
+	RecordReplayEvent(ECraftingReplayEvent::Pickup, po->GetClass());
+
 	for (int i = 0; i < CurrentItems.Num(); i++)
 	{
 		if (CurrentItems[i].Class == po->GetClass())
 		{
 			++CurrentItems[i].Number;
-			Callback.Broadcast();
+			MarkItemChanged(i, po->GetClass(), CurrentItems[i].Number - 1, CurrentItems[i].Number);
+			BroadcastCallback();
 			return CurrentItems[i].Number;
 		}
 	}
 
 	CurrentItems.Add(FPickupItem{ po->GetClass(),1,po->IsRare(), po->ObjName,po->Description});
-	Callback.Broadcast();
+	MarkItemChanged(CurrentItems.Num() - 1, po->GetClass(), 0, 1);
+	BroadcastCallback();
 	return 1;
 }
 
 int AcraftingCharacter::IncreaseItemNumberS(FPickupItem po)
 {
+	FScopedInventoryMutationTimer MutationTimer;
+	TGuardValue<bool> RecordUndo(bRecordUndo, true);
+	RecordReplayEvent(ECraftingReplayEvent::AddItem, po.Class);
+
 	for (int i = 0; i < CurrentItems.Num(); i++)
 	{
 		if (CurrentItems[i].Class == po.Class)
 		{
 			++CurrentItems[i].Number;
-			Callback.Broadcast();
+			MarkItemChanged(i, po.Class, CurrentItems[i].Number - 1, CurrentItems[i].Number);
+			BroadcastCallback();
 			return CurrentItems[i].Number;
 		}
 	}
 	po.Number = 1;
 	CurrentItems.Add(po);
-	Callback.Broadcast();
+	MarkItemChanged(CurrentItems.Num() - 1, po.Class, 0, 1);
+	BroadcastCallback();
 	return 1;
 }
 
 int AcraftingCharacter::DecreaseItemNumber(APickupObject * po)
 {
+	FScopedInventoryMutationTimer MutationTimer;
+	TGuardValue<bool> RecordUndo(bRecordUndo, true);
+	RecordReplayEvent(ECraftingReplayEvent::RemovePickup, po->GetClass());
+
 	for (int i = 0; i < CurrentItems.Num(); i++)
 	{
 		if (CurrentItems[i].Class == po->GetClass())
@@ -264,13 +383,15 @@ int AcraftingCharacter::DecreaseItemNumber(APickupObject * po)
 			if (CurrentItems[i].Number > 1)
 			{
 				--CurrentItems[i].Number;
-				Callback.Broadcast();
+				MarkItemChanged(i, po->GetClass(), CurrentItems[i].Number + 1, CurrentItems[i].Number);
+				BroadcastCallback();
 				return CurrentItems[i].Number;
 			}
 			else
 			{
 				CurrentItems.RemoveAt(i);
-				Callback.Broadcast();
+				MarkItemChanged(i, po->GetClass(), 1, 0);
+				BroadcastCallback();
 				return 0;
 			}
 		}
@@ -280,6 +401,10 @@ int AcraftingCharacter::DecreaseItemNumber(APickupObject * po)
 
 int AcraftingCharacter::DecreaseItemNumberS(FPickupItem po)
 {
+	FScopedInventoryMutationTimer MutationTimer;
+	TGuardValue<bool> RecordUndo(bRecordUndo, true);
+	RecordReplayEvent(ECraftingReplayEvent::RemoveItem, po.Class);
+
 	for (int i = 0; i < CurrentItems.Num(); i++)
 	{
 		if (CurrentItems[i].Class == po.Class)
@@ -287,13 +412,15 @@ int AcraftingCharacter::DecreaseItemNumberS(FPickupItem po)
 			if (CurrentItems[i].Number > 1)
 			{
 				--CurrentItems[i].Number;
-				Callback.Broadcast();
+				MarkItemChanged(i, po.Class, CurrentItems[i].Number + 1, CurrentItems[i].Number);
+				BroadcastCallback();
 				return CurrentItems[i].Number;
 			}
 			else
 			{
 				CurrentItems.RemoveAt(i);
-				Callback.Broadcast();
+				MarkItemChanged(i, po.Class, 1, 0);
+				BroadcastCallback();
 				return 0;
 			}
 		}
@@ -301,8 +428,123 @@ int AcraftingCharacter::DecreaseItemNumberS(FPickupItem po)
 	return 0;
 }
 
+int AcraftingCharacter::GetItemNumber(TSubclassOf<APickupObject> ItemClass) const
+{
+	const FPickupItem* Item = CurrentItems.FindByPredicate([ItemClass](const FPickupItem& It) { return It.Class == ItemClass; });
+	return Item != nullptr ? Item->Number : 0;
+}
+
+int AcraftingCharacter::GetMaxCraftCount(const FCraftingRecipe& Recipe) const
+{
+	if (FRecipeMatcher::HasWildcards(Recipe))
+	{
+		return FRecipeMatcher::GetMaxCraftCount(Recipe, CurrentItems);
+	}
+
+	// a class listed in two slots is paid from the same stacks, so divide by the summed requirement
+	TMap<UClass*, int32> Needed;
+	FRecipeMatcher::GetRequiredPerClass(Recipe, Needed);
+
+	int MaxCount = MAX_int32;
+	for (const TPair<UClass*, int32>& Pair : Needed)
+	{
+		MaxCount = FMath::Min(MaxCount, GetItemNumber(Pair.Key) / Pair.Value);
+	}
+	return Recipe.Ingredients.Num() > 0 ? MaxCount : 0;
+}
+
+void AcraftingCharacter::ApplyInventoryDeltas(const TArray<FInventoryDelta>& Deltas)
+{
+	FScopedInventoryMutationTimer MutationTimer;
+	bool bChanged = false;
+	for (const FInventoryDelta& Delta : Deltas)
+	{
+		if (Delta.Class == nullptr || Delta.Number == 0)
+		{
+			continue;
+		}
+
+		int32 Index = CurrentItems.IndexOfByPredicate([&Delta](const FPickupItem& It) { return It.Class == Delta.Class; });
+		if (Index == INDEX_NONE)
+		{
+			if (Delta.Number > 0)
+			{
+				CurrentItems.Add(MakePickupItem(Delta.Class, Delta.Number));
+				MarkItemChanged(CurrentItems.Num() - 1, Delta.Class, 0, Delta.Number);
+				bChanged = true;
+			}
+			continue;
+		}
+
+		FPickupItem& Item = CurrentItems[Index];
+		const int OldNumber = Item.Number;
+		Item.Number = FMath::Max(0, Item.Number + Delta.Number);
+		MarkItemChanged(Index, Delta.Class, OldNumber, Item.Number);
+		if (Item.Number == 0)
+		{
+			CurrentItems.RemoveAt(Index);
+		}
+		bChanged = true;
+	}
+
+	if (bChanged)
+	{
+		BroadcastCallback();
+	}
+}
+
+void AcraftingCharacter::AddPickedUpItems(const TArray<FInventoryDelta>& Deltas)
+{
+	for (const FInventoryDelta& Delta : Deltas)
+	{
+		for (int32 i = 0; i < Delta.Number; i++)
+		{
+			RecordReplayEvent(ECraftingReplayEvent::Pickup, Delta.Class);
+		}
+	}
+
+	TGuardValue<bool> RecordUndo(bRecordUndo, false);
+	ApplyInventoryDeltas(Deltas);
+}
+
+void AcraftingCharacter::BroadcastCallback()
+{
+	FCraftingMetrics::Get().CountCallbackBroadcast();
+	Callback.Broadcast();
+}
+
+FPickupItem AcraftingCharacter::MakePickupItem(TSubclassOf<APickupObject> ItemClass, int Number)
+{
+	const APickupObject* Defaults = ItemClass->GetDefaultObject<APickupObject>();
+	return FPickupItem{ ItemClass, Number, Defaults->IsRare(), Defaults->ObjName, Defaults->Description };
+}
+
+SIZE_T AcraftingCharacter::GetInventoryAllocatedSize() const
+{
+	return FCraftingMemory::GetItemsAllocatedSize(CurrentItems) + CategoryIndex.GetAllocatedSize() + UndoHistory.GetAllocatedSize()
+		+ CraftTableCells.GetAllocatedSize() + DirtyItemClasses.GetAllocatedSize() + PredictedPickups.GetAllocatedSize() + InventoryGrid.GetAllocatedSize();
+}
+
+void AcraftingCharacter::RefreshItemDefinitions()
+{
+	for (FPickupItem& Item : CurrentItems)
+	{
+		if (Item.Class != nullptr)
+		{
+			Item = MakePickupItem(Item.Class, Item.Number);
+		}
+	}
+
+	// rarity, category or footprint may have changed, the inventory is small enough to just recount it
+	CategoryIndex.Rebuild(CurrentItems);
+	RebuildInventoryGrid();
+	BroadcastCallback();
+}
+
 void AcraftingCharacter::SwitchToRecipeList()
 {
+	RecordReplayEvent(ECraftingReplayEvent::SwitchToRecipeList);
+
 	if (currentAngle <= -90)
 	{
 		bIsUIRotting = false;
@@ -318,7 +560,12 @@ void AcraftingCharacter::SwitchToRecipeList()
 
 void AcraftingCharacter::SwitchToCraftingTable()
 {
-	
+	RecordReplayEvent(ECraftingReplayEvent::SwitchToCraftingTable);
+	RotateUIToCraftingTable();
+}
+
+void AcraftingCharacter::RotateUIToCraftingTable()
+{
 	if (currentAngle >= 0)
 	{
 		bIsUIRotting = false;
@@ -332,163 +579,1028 @@ void AcraftingCharacter::SwitchToCraftingTable()
 	bIsCraftingTableCurrentUI = true;
 }
 
+bool AcraftingCharacter::GetPlayerViewRect(FVector2D& OutOrigin, FVector2D& OutSize) const
+{
+	// with split screen every local player only owns a part of the viewport
+	const ULocalPlayer* LocalPlayer = PlayerController != nullptr ? PlayerController->GetLocalPlayer() : nullptr;
+	if (LocalPlayer == nullptr || LocalPlayer->ViewportClient == nullptr)
+	{
+		return false;
+	}
+
+	FVector2D ViewportSize;
+	LocalPlayer->ViewportClient->GetViewportSize(ViewportSize);
+	OutOrigin = LocalPlayer->Origin * ViewportSize;
+	OutSize = LocalPlayer->Size * ViewportSize;
+	return OutSize.X > 0 && OutSize.Y > 0;
+}
+
 bool AcraftingCharacter::GetIsInventoryOpen()
 {
 	return bIsInventoryOpen;
 }
 
-void AcraftingCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent)
+bool AcraftingCharacter::CanHoldItem(TSubclassOf<APickupObject> ItemClass, int Number) const
 {
-	// set up gameplay key bindings
-	check(PlayerInputComponent);
-
-	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &ACharacter::Jump);
-	PlayerInputComponent->BindAction("Jump", IE_Released, this, &ACharacter::StopJumping);
-	PlayerInputComponent->BindAction("Inventory", IE_Pressed, this, &AcraftingCharacter::SetInventory);
+	return !InventoryGrid.IsEnabled() || (ItemClass != nullptr && InventoryGrid.CanAdd(ItemClass, Number, FGridItemShape::Get(ItemClass)));
+}
 
-	//InputComponent->BindTouch(EInputEvent::IE_Pressed, this, &AcraftingCharacter::TouchStarted);
-	if (EnableTouchscreenMovement(PlayerInputComponent) == false)
+bool AcraftingCharacter::SortInventoryGrid()
+{
+	if (!InventoryGrid.IsEnabled() || !InventoryGrid.Sort())
 	{
-		PlayerInputComponent->BindAction("Fire", IE_Pressed, this, &AcraftingCharacter::OnFire);
-		PlayerInputComponent->BindAction("Fire", IE_Pressed, this, &AcraftingCharacter::OnStopFire);
+		return false;
 	}
+	BroadcastCallback();
+	return true;
+}
 
-	PlayerInputComponent->BindAction("ResetVR", IE_Pressed, this, &AcraftingCharacter::OnResetVR);
-
-	PlayerInputComponent->BindAxis("MoveForward", this, &AcraftingCharacter::MoveForward);
-	PlayerInputComponent->BindAxis("MoveRight", this, &AcraftingCharacter::MoveRight);
+TArray<FInventoryGridStack> AcraftingCharacter::GetInventoryGridStacks() const
+{
+	return InventoryGrid.GetStacks();
+}
 
-	// We have 2 versions of the rotation bindings to handle different kinds of devices differently
-	// "turn" handles devices that provide an absolute delta, such as a mouse.
-	// "turnrate" is for devices that we choose to treat as a rate of change, such as an analog joystick
-	PlayerInputComponent->BindAxis("Turn", this, &AcraftingCharacter::AddControllerYawInput);
-	PlayerInputComponent->BindAxis("TurnRate", this, &AcraftingCharacter::TurnAtRate);
-	PlayerInputComponent->BindAxis("LookUp", this, &AcraftingCharacter::AddControllerPitchInput);
-	PlayerInputComponent->BindAxis("LookUpRate", this, &AcraftingCharacter::LookUpAtRate);
+int AcraftingCharacter::GetInventoryGridOverflow() const
+{
+	return InventoryGrid.GetOverflow();
 }
 
-void AcraftingCharacter::OnFire()
+void AcraftingCharacter::RebuildInventoryGrid()
 {
-	// try and fire a projectile
-	if (!bIsInventoryOpen)
+	if (!InventoryGrid.IsEnabled())
 	{
-		if (ProjectileClass != NULL)
+		return;
+	}
+
+	InventoryGrid.Reset();
+	for (const FPickupItem& Item : CurrentItems)
+	{
+		if (Item.Class != nullptr)
 		{
-			UWorld* const World = GetWorld();
-			if (World != NULL)
-			{
-				if (bUsingMotionControllers)
-				{
-					const FRotator SpawnRotation = VR_MuzzleLocation->GetComponentRotation();
-					const FVector SpawnLocation = VR_MuzzleLocation->GetComponentLocation();
-					World->SpawnActor<AcraftingProjectile>(ProjectileClass, SpawnLocation, SpawnRotation);
-				}
-				else
-				{
-					const FRotator SpawnRotation = GetControlRotation();
-					// MuzzleOffset is in camera space, so transform it to world space before offsetting from the character location to find the final muzzle position
-					const FVector SpawnLocation = ((FP_MuzzleLocation != nullptr) ? FP_MuzzleLocation->GetComponentLocation() : GetActorLocation()) + SpawnRotation.RotateVector(GunOffset);
+			InventoryGrid.Add(Item.Class, Item.Number, FGridItemShape::Get(Item.Class));
+		}
+	}
+	InventoryGrid.Sort();
+}
 
-					//Set Spawn Collision Handling Override
-					FActorSpawnParameters ActorSpawnParams;
-					ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
+int AcraftingCharacter::GetCategoryItemNumber(ECommonType Category) const
+{
+	return Category < ECommonType::Count ? CategoryIndex.GetCategoryNumber(Category) : 0;
+}
 
-					// spawn the projectile at the muzzle
-					World->SpawnActor<AcraftingProjectile>(ProjectileClass, SpawnLocation, SpawnRotation, ActorSpawnParams);
-				}
-			}
-		}
+int AcraftingCharacter::GetRareItemNumber() const
+{
+	return CategoryIndex.GetRareNumber();
+}
 
-		// try and play the sound if specified
-		if (FireSound != NULL && !bIsInventoryOpen)
+TArray<FPickupItem> AcraftingCharacter::GetItemsInCategory(ECommonType Category) const
+{
+	TArray<FPickupItem> Items;
+	if (Category < ECommonType::Count)
+	{
+		for (TConstSetBitIterator<> It(CategoryIndex.GetCategorySlots(Category)); It; ++It)
 		{
-			UGameplayStatics::PlaySoundAtLocation(this, FireSound, GetActorLocation());
+			// a stale index must not read past the stacks, it is rebuilt when the inventory is loaded
+			if (CurrentItems.IsValidIndex(It.GetIndex()))
+			{
+				Items.Add(CurrentItems[It.GetIndex()]);
+			}
 		}
+	}
+	return Items;
+}
 
-		// try and play a firing animation if specified
-		if (FireAnimation != NULL)
+TArray<FPickupItem> AcraftingCharacter::GetRareItems() const
+{
+	TArray<FPickupItem> Items;
+	for (TConstSetBitIterator<> It(CategoryIndex.GetRareSlots()); It; ++It)
+	{
+		if (CurrentItems.IsValidIndex(It.GetIndex()))
 		{
-			// Get the animation object for the arms mesh
-			UAnimInstance* AnimInstance = Mesh1P->GetAnimInstance();
-			if (AnimInstance != NULL)
-			{
-				AnimInstance->Montage_Play(FireAnimation, 1.f);
-			}
+			Items.Add(CurrentItems[It.GetIndex()]);
 		}
 	}
-	else
+	return Items;
+}
+
+UTexture2D* AcraftingCharacter::GetItemIcon(TSubclassOf<APickupObject> ItemClass)
+{
+	const FItemImages* Item = ItemCatalog != nullptr ? ItemCatalog->FindItem(ItemClass) : nullptr;
+	if (Item != nullptr)
 	{
-		InteractionPointer->PressPointerKey(EKeys::LeftMouseButton);
+		return FCraftingContentStreamer::Get().GetIcon(Item->GetIcon());
 	}
+
+	// items missing from the catalog fall back to the icon of the pickup itself
+	return ItemClass != nullptr ? FCraftingContentStreamer::Get().GetIcon(ItemClass->GetDefaultObject<APickupObject>()->GetIcon()) : nullptr;
 }
 
-void AcraftingCharacter::OnStopFire()
+void AcraftingCharacter::CreateInventoryWidgets()
 {
-	InteractionPointer->ReleasePointerKey(EKeys::LeftMouseButton);
+	if (!bHasPlacedRecipeList || !PlayerInventory->HasCreatedWidget() || !RecipeList->HasCreatedWidget())
+	{
+		SCOPE_CYCLE_COUNTER(STAT_InventoryWidgets);
+
+		const double StartSeconds = FPlatformTime::Seconds();
+		while (PrewarmInventoryWidget())
+		{
+		}
+		UE_LOG(LogCrafting, Log, TEXT("Created the inventory widgets of %s on first open in %.2f ms"), *GetName(), (FPlatformTime::Seconds() - StartSeconds) * 1000.0);
+	}
 }
 
-void AcraftingCharacter::OnResetVR()
+bool AcraftingCharacter::PrewarmInventoryWidget()
 {
-	UHeadMountedDisplayFunctionLibrary::ResetOrientationAndPosition();
+	if (!PlayerInventory->HasCreatedWidget())
+	{
+		PlayerInventory->CreateWidgetNow();
+		return true;
+	}
+	if (!RecipeList->HasCreatedWidget())
+	{
+		RecipeList->CreateWidgetNow();
+		return true;
+	}
+	if (!bHasPlacedRecipeList)
+	{
+		// rotate recipe table 90 degrees around the camera
+		RecipeList->SetRelativeLocation(RecipeList->RelativeLocation.RotateAngleAxis(90, FVector::UpVector));
+		bHasPlacedRecipeList = true;
+		return true;
+	}
+	return false;
 }
 
-void AcraftingCharacter::BeginTouch(const ETouchIndex::Type FingerIndex, const FVector Location)
+//////////////////////////////////////////////////////////////////////////
+// Crafting table
+
+void AcraftingCharacter::SetCraftTableCell(int X, int Y, TSubclassOf<APickupObject> ItemClass)
 {
-	if (TouchItem.bIsPressed == true)
+	if (X < 0 || X >= CraftTableWidth || Y < 0 || Y >= CraftTableHeight)
 	{
 		return;
 	}
-	TouchItem.bIsPressed = true;
-	TouchItem.FingerIndex = FingerIndex;
-	TouchItem.Location = Location;
-	TouchItem.bMoved = false;
+
+	const int32 Cell = Y * CraftTableWidth + X;
+	RecordReplayEvent(ECraftingReplayEvent::SetCraftTableCell, ItemClass, Cell);
+
+	TGuardValue<bool> RecordUndo(bRecordUndo, true);
+	UClass* ReplacedClass = CraftTableCells.IsValidIndex(Cell) ? CraftTableCells[Cell] : nullptr;
+	SetCraftTableCellAt(Cell, ItemClass);
+	if (ItemClass != nullptr && ReplacedClass != nullptr)
+	{
+		ApplyInventoryDeltas({ FInventoryDelta{ ReplacedClass, 1 } });
+	}
+	ResolveCraftTable();
 }
 
-void AcraftingCharacter::EndTouch(const ETouchIndex::Type FingerIndex, const FVector Location)
+void AcraftingCharacter::SetCraftTableCellAt(int32 Cell, UClass* ItemClass)
 {
-	if (TouchItem.bIsPressed == false)
+	CraftTableCells.SetNum(CraftTableWidth * CraftTableHeight);
+	if (!CraftTableCells.IsValidIndex(Cell))
 	{
 		return;
 	}
-	if ((FingerIndex == TouchItem.FingerIndex) && (TouchItem.bMoved == false))
+
+	if (bRecordUndo && !bIsApplyingHistory)
 	{
-		OnFire();
+		UndoHistory.RecordTableCell(Cell, CraftTableCells[Cell], ItemClass);
 	}
-	TouchItem.bIsPressed = false;
+	CraftTableCells[Cell] = ItemClass;
 }
 
-void AcraftingCharacter::SetInventory()
+TSubclassOf<APickupObject> AcraftingCharacter::GetCraftTableCell(int X, int Y) const
 {
-	bIsInventoryOpen = !bIsInventoryOpen;
+	const int32 Cell = Y * CraftTableWidth + X;
+	return X >= 0 && X < CraftTableWidth && Cell >= 0 && Cell < CraftTableCells.Num() ? CraftTableCells[Cell] : nullptr;
+}
 
-	Mesh1P->SetVisibility(!bIsInventoryOpen, true);
-	FP_Gun->SetVisibility(!bIsInventoryOpen, true);
+void AcraftingCharacter::ClearCraftTable(bool bReturnItems)
+{
+	RecordReplayEvent(ECraftingReplayEvent::ClearCraftTable, nullptr, bReturnItems ? 1 : 0);
 
-	PlayerController->bShowMouseCursor = bIsInventoryOpen;
+	TGuardValue<bool> RecordUndo(bRecordUndo, true);
+	EmptyCraftTable(bReturnItems);
+}
 
-	if (bIsInventoryOpen)
+void AcraftingCharacter::EmptyCraftTable(bool bReturnItems)
+{
+	TArray<FInventoryDelta> Deltas;
+	for (int32 Cell = 0; Cell < CraftTableCells.Num(); Cell++)
 	{
-		SwitchToCraftingTable();
+		if (CraftTableCells[Cell] != nullptr)
+		{
+			Deltas.Add(FInventoryDelta{ CraftTableCells[Cell], 1 });
+			SetCraftTableCellAt(Cell, nullptr);
+		}
+	}
 
-		FVector2D viewportSize;
-		GetWorld()->GetGameViewport()->GetViewportSize(viewportSize);
-		PlayerController->SetMouseLocation(viewportSize.X/2.0f,viewportSize.Y/2.0f);
-		
-		RecipeList->SetVisibility(true);
-		PlayerInventory->SetVisibility(true);
-		FInputModeGameAndUI mode;
-		mode.SetLockMouseToViewport(true);
-		mode.SetHideCursorDuringCapture(false);
-		PlayerController->SetInputMode(mode);
+	if (bReturnItems)
+	{
+		ApplyInventoryDeltas(Deltas);
+	}
+	CraftTableRecipe = INDEX_NONE;
+}
 
-		InteractionPointer->Activate();
+bool AcraftingCharacter::GetCraftTableResult(FCraftingRecipe& OutRecipe) const
+{
+	if (RecipeBook == nullptr || !RecipeBook->Recipes.IsValidIndex(CraftTableRecipe))
+	{
+		return false;
 	}
-	else
+	OutRecipe = RecipeBook->Recipes[CraftTableRecipe];
+	return true;
+}
+
+bool AcraftingCharacter::CraftFromTable()
+{
+	FCraftingRecipe Recipe;
+	if (!GetCraftTableResult(Recipe) || Recipe.Result == nullptr)
 	{
-		RecipeList->SetVisibility(false);
-		PlayerInventory->SetVisibility(false);
-		FInputModeGameOnly mode;
-		PlayerController->SetInputMode(mode);
+		return false;
+	}
+
+	RecordReplayEvent(ECraftingReplayEvent::CraftFromTable);
+
+	// the ingredients already left the inventory when they were placed on the table
+	TGuardValue<bool> RecordUndo(bRecordUndo, true);
+	EmptyCraftTable(false);
+	ApplyInventoryDeltas({ FInventoryDelta{ Recipe.Result, Recipe.ResultNumber } });
+
+	FCraftingMetrics::Get().CountCraft();
+	if (FCraftingJournal* Journal = FCraftingJournal::Get())
+	{
+		Journal->Record(ECraftingJournalEvent::Craft, GetJournalPlayerId(), Recipe.Result, Recipe.ResultNumber);
+	}
+	return true;
+}
+
+void AcraftingCharacter::ResolveCraftTable()
+{
+	CraftTableRecipe = RecipeBook != nullptr ? RecipeBook->GetIndex().FindTableRecipe(CraftTableCells, CraftTableWidth) : INDEX_NONE;
+}
+
+void AcraftingCharacter::OnRecipesChanged(const TArray<int32>& ChangedRecipes)
+{
+	// the table may now form a different recipe, or none, and the recipe list shows what can be crafted
+	ResolveCraftTable();
+	BroadcastCallback();
+}
+
+bool AcraftingCharacter::Undo()
+{
+	RecordReplayEvent(ECraftingReplayEvent::Undo);
+	TGuardValue<bool> ApplyingHistory(bIsApplyingHistory, true);
+
+	TArray<FInventoryDelta> Deltas;
+	if (!UndoHistory.Undo([this, &Deltas](const FCraftingUndoRecord& Record)
+	{
+		if (Record.Type == FCraftingUndoRecord::Item)
+		{
+			Deltas.Add(FInventoryDelta{ Record.Class.Get(), -Record.Value });
+		}
+		else
+		{
+			SetCraftTableCellAt(Record.Value, Record.OldClass.Get());
+		}
+	}))
+	{
+		return false;
+	}
+
+	ApplyInventoryDeltas(Deltas);
+	ResolveCraftTable();
+	return true;
+}
+
+bool AcraftingCharacter::Redo()
+{
+	RecordReplayEvent(ECraftingReplayEvent::Redo);
+	TGuardValue<bool> ApplyingHistory(bIsApplyingHistory, true);
+
+	TArray<FInventoryDelta> Deltas;
+	if (!UndoHistory.Redo([this, &Deltas](const FCraftingUndoRecord& Record)
+	{
+		if (Record.Type == FCraftingUndoRecord::Item)
+		{
+			Deltas.Add(FInventoryDelta{ Record.Class.Get(), Record.Value });
+		}
+		else
+		{
+			SetCraftTableCellAt(Record.Value, Record.Class.Get());
+		}
+	}))
+	{
+		return false;
+	}
+
+	ApplyInventoryDeltas(Deltas);
+	ResolveCraftTable();
+	return true;
+}
+
+bool AcraftingCharacter::CanUndo() const
+{
+	return UndoHistory.CanUndo();
+}
+
+bool AcraftingCharacter::CanRedo() const
+{
+	return UndoHistory.CanRedo();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Replays
+
+void AcraftingCharacter::CraftingReplayRecord()
+{
+	ReplayRecording = MakeShareable(new FCraftingReplay(GetWorld()->GetTimeSeconds()));
+	UE_LOG(LogCrafting, Display, TEXT("Recording crafting replay"));
+}
+
+void AcraftingCharacter::CraftingReplayStop(const FString& Name)
+{
+	if (!ReplayRecording.IsValid())
+	{
+		return;
+	}
+
+	const FString Path = FCraftingReplay::GetReplayPath(Name.IsEmpty() ? TEXT("Replay") : Name);
+	if (ReplayRecording->Save(Path))
+	{
+		UE_LOG(LogCrafting, Display, TEXT("Saved %d replay events to '%s'"), ReplayRecording->Events.Num(), *Path);
+	}
+	else
+	{
+		UE_LOG(LogCrafting, Warning, TEXT("Could not write replay '%s'"), *Path);
+	}
+	ReplayRecording.Reset();
+}
+
+void AcraftingCharacter::RecordReplayEvent(ECraftingReplayEvent Type, UClass* ItemClass, int32 Value)
+{
+	if (ReplayRecording.IsValid())
+	{
+		ReplayRecording->Add(GetWorld()->GetTimeSeconds(), Type, ItemClass, Value);
+	}
+}
+
+void AcraftingCharacter::TakeCraftIngredients(const TArray<FInventoryDelta>& Deltas)
+{
+	// the replay world has no stations, so what they did to the inventory is recorded instead of the call
+	for (const FInventoryDelta& Delta : Deltas)
+	{
+		RecordReplayEvent(ECraftingReplayEvent::QueueCraft, Delta.Class, Delta.Number);
+	}
+
+	TGuardValue<bool> RecordUndo(bRecordUndo, false);
+	ApplyInventoryDeltas(Deltas);
+}
+
+void AcraftingCharacter::AddCraftResults(const TArray<FInventoryDelta>& Deltas)
+{
+	for (const FInventoryDelta& Delta : Deltas)
+	{
+		RecordReplayEvent(ECraftingReplayEvent::JobResult, Delta.Class, Delta.Number);
+	}
+
+	TGuardValue<bool> RecordUndo(bRecordUndo, false);
+	ApplyInventoryDeltas(Deltas);
+}
+
+void AcraftingCharacter::PlayReplayEvent(ECraftingReplayEvent Type, TSubclassOf<APickupObject> ItemClass, int32 Value)
+{
+	APickupObject* Pickup = ItemClass != nullptr ? ItemClass->GetDefaultObject<APickupObject>() : nullptr;
+	switch (Type)
+	{
+	case ECraftingReplayEvent::Pickup:
+		if (Pickup != nullptr)
+		{
+			IncreaseItemNumber(Pickup);
+		}
+		break;
+	case ECraftingReplayEvent::AddItem:
+		if (ItemClass != nullptr)
+		{
+			IncreaseItemNumberS(MakePickupItem(ItemClass, 1));
+		}
+		break;
+	case ECraftingReplayEvent::RemovePickup:
+		if (Pickup != nullptr)
+		{
+			DecreaseItemNumber(Pickup);
+		}
+		break;
+	case ECraftingReplayEvent::RemoveItem:
+		if (ItemClass != nullptr)
+		{
+			DecreaseItemNumberS(MakePickupItem(ItemClass, 1));
+		}
+		break;
+	case ECraftingReplayEvent::ToggleInventory:
+		SetInventory();
+		break;
+	case ECraftingReplayEvent::SwitchToRecipeList:
+		SwitchToRecipeList();
+		break;
+	case ECraftingReplayEvent::SwitchToCraftingTable:
+		SwitchToCraftingTable();
+		break;
+	case ECraftingReplayEvent::QueueCraft:
+		if (ItemClass != nullptr)
+		{
+			TakeCraftIngredients({ FInventoryDelta{ ItemClass, Value } });
+		}
+		break;
+	case ECraftingReplayEvent::JobResult:
+		if (ItemClass != nullptr)
+		{
+			AddCraftResults({ FInventoryDelta{ ItemClass, Value } });
+		}
+		break;
+	case ECraftingReplayEvent::SetCraftTableCell:
+		if (CraftTableWidth > 0)
+		{
+			SetCraftTableCell(Value % CraftTableWidth, Value / CraftTableWidth, ItemClass);
+		}
+		break;
+	case ECraftingReplayEvent::ClearCraftTable:
+		ClearCraftTable(Value != 0);
+		break;
+	case ECraftingReplayEvent::CraftFromTable:
+		CraftFromTable();
+		break;
+	case ECraftingReplayEvent::Undo:
+		Undo();
+		break;
+	case ECraftingReplayEvent::Redo:
+		Redo();
+		break;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Pickup prediction
+
+void AcraftingCharacter::PredictPickup(APickupObject* Pickup)
+{
+	FPredictedPickup& Predicted = PredictedPickups[PredictedPickups.AddDefaulted()];
+	Predicted.Key = NextPredictionKey;
+	Predicted.Pickup = Pickup;
+	Predicted.Class = Pickup->GetClass();
+	NextPredictionKey = NextPredictionKey == MAX_int32 ? 1 : NextPredictionKey + 1;
+
+	Pickup->SetPredictedCollected(true);
+	IncreaseItemNumber(Pickup);
+	ServerCollectPickup(Pickup, Predicted.Key);
+}
+
+bool AcraftingCharacter::ServerCollectPickup_Validate(APickupObject* Pickup, int32 PredictionKey)
+{
+	return PredictionKey > 0;
+}
+
+void AcraftingCharacter::ServerCollectPickup_Implementation(APickupObject* Pickup, int32 PredictionKey)
+{
+	// null when somebody else collected it first, too far when the client's view of the world is off
+	if (Pickup != nullptr && !Pickup->IsPendingKill() && CanHoldItem(Pickup->GetClass(), 1)
+		&& FVector::DistSquared(GetActorLocation(), Pickup->GetActorLocation()) <= FMath::Square(PickupTolerance))
+	{
+		Pickup->Collect(this);
+		ClientConfirmPickup(PredictionKey);
+	}
+	else
+	{
+		ClientRejectPickup(PredictionKey);
+	}
+}
+
+void AcraftingCharacter::ClientConfirmPickup_Implementation(int32 PredictionKey)
+{
+	const int32 Index = PredictedPickups.IndexOfByPredicate([PredictionKey](const FPredictedPickup& It) { return It.Key == PredictionKey; });
+	if (Index != INDEX_NONE)
+	{
+		// the pickup itself goes away when the server's destroy replicates
+		PredictedPickups.RemoveAt(Index);
+		FCraftingMetrics::Get().CountPickupPrediction(true);
+	}
+}
+
+void AcraftingCharacter::ClientRejectPickup_Implementation(int32 PredictionKey)
+{
+	const int32 Index = PredictedPickups.IndexOfByPredicate([PredictionKey](const FPredictedPickup& It) { return It.Key == PredictionKey; });
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	const FPredictedPickup Predicted = PredictedPickups[Index];
+	PredictedPickups.RemoveAt(Index);
+	FCraftingMetrics::Get().CountPickupPrediction(false);
+	UE_LOG(LogCrafting, Verbose, TEXT("Server rejected predicted pickup %d of %s"), PredictionKey, *GetNameSafe(Predicted.Class));
+
+	{
+		// the rollback is no more a player action than the pickup was, it must not end up in the undo history
+		TGuardValue<bool> RecordUndo(bRecordUndo, false);
+		ApplyInventoryDeltas({ FInventoryDelta{ Predicted.Class, -1 } });
+	}
+
+	APickupObject* Pickup = Predicted.Pickup.Get();
+	if (Pickup != nullptr && !Pickup->IsPendingKill())
+	{
+		Pickup->SetPredictedCollected(false);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Inventory persistence
+
+void AcraftingCharacter::MarkItemChanged(int32 Slot, TSubclassOf<APickupObject> ItemClass, int OldNumber, int NewNumber)
+{
+	DirtyItemClasses.Add(ItemClass);
+
+	// only what the player does in the inventory can be undone, not pickups, station crafts or rollbacks
+	if (bRecordUndo && bIsInventoryOpen && !bIsApplyingHistory)
+	{
+		UndoHistory.RecordItem(ItemClass, NewNumber - OldNumber);
+	}
+
+	if (InventoryGrid.IsEnabled())
+	{
+		if (NewNumber > OldNumber)
+		{
+			InventoryGrid.Add(ItemClass, NewNumber - OldNumber, FGridItemShape::Get(ItemClass));
+		}
+		else
+		{
+			InventoryGrid.Remove(ItemClass, OldNumber - NewNumber);
+		}
+	}
+
+	if (OldNumber == 0)
+	{
+		CategoryIndex.OnStackAdded(ItemClass, CurrentItems[Slot].IsRare, NewNumber);
+	}
+	else if (NewNumber == 0)
+	{
+		CategoryIndex.OnStackRemoved(Slot);
+	}
+	else
+	{
+		CategoryIndex.OnStackChanged(Slot, NewNumber - OldNumber);
+	}
+
+	if (FCraftingJournal* Journal = FCraftingJournal::Get())
+	{
+		Journal->Record(ECraftingJournalEvent::ItemChanged, GetJournalPlayerId(), ItemClass, NewNumber);
+	}
+}
+
+void AcraftingCharacter::StartInventoryPersistence(APlayerController* Controller)
+{
+	// the server owns the inventories, clients and headless or virtual players must not write a save
+	if (!SaveSlot.IsEmpty() || !HasAuthority())
+	{
+		return;
+	}
+
+	SaveSlot = GetInventorySaveSlot(Controller);
+	if (SaveSlot.IsEmpty())
+	{
+		UE_LOG(LogCrafting, Warning, TEXT("%s has no stable player id, its inventory is not saved"), *GetName());
+		return;
+	}
+	LoadInventory();
+}
+
+FString AcraftingCharacter::GetInventorySaveSlot(const APlayerController* Controller) const
+{
+	// split screen players share the machine and remote players the server, each of them needs a file of their own
+	if (Controller->IsLocalController())
+	{
+		const ULocalPlayer* LocalPlayer = Controller->GetLocalPlayer();
+		const int32 ControllerId = LocalPlayer != nullptr ? LocalPlayer->GetControllerId() : 0;
+		return ControllerId == 0 ? InventorySaveSlot : FString::Printf(TEXT("%s%d"), *InventorySaveSlot, ControllerId + 1);
+	}
+
+	const APlayerState* State = Controller->PlayerState;
+	if (State != nullptr && State->UniqueId.IsValid())
+	{
+		return InventorySaveSlot + TEXT("_") + FPaths::MakeValidFileName(State->UniqueId->ToString(), TEXT('_'));
+	}
+	return FString();
+}
+
+uint32 AcraftingCharacter::GetJournalPlayerId() const
+{
+	if (JournalPlayerId == 0)
+	{
+		// virtual players and pawns of other machines have no slot, their names are stable within a map
+		const APlayerController* Controller = Cast<APlayerController>(GetController());
+		const FString Slot = Controller != nullptr ? GetInventorySaveSlot(Controller) : FString();
+		JournalPlayerId = FCraftingJournal::GetStableId(Slot.IsEmpty() ? GetName() : Slot);
+	}
+	return JournalPlayerId;
+}
+
+void AcraftingCharacter::Autosave()
+{
+	SaveInventory(true);
+}
+
+void AcraftingCharacter::SaveInventory(bool bIncremental)
+{
+	if (SaveSlot.IsEmpty() || !bHasLoadedInventory)
+	{
+		return;
+	}
+
+	// one write at a time keeps the delta records in order, changes stay dirty until the next save
+	if (bIsInventoryIOInFlight)
+	{
+		return;
+	}
+
+	bIncremental = bIncremental && !bFullSaveRequired && NumDeltaSaves < FInventorySave::MaxDeltaRecords;
+	if (bIncremental && DirtyItemClasses.Num() == 0)
+	{
+		return;
+	}
+
+	// take the snapshot here, the compression and the file write happen on the thread pool
+	FInventorySnapshot Snapshot;
+	FillInventorySnapshot(Snapshot, bIncremental);
+	DirtyItemClasses.Reset();
+
+	bIsInventoryIOInFlight = true;
+	TWeakObjectPtr<AcraftingCharacter> WeakThis(this);
+	InventoryIO = FInventorySave::SaveAsync(SaveSlot, MoveTemp(Snapshot), bIncremental, [WeakThis, bIncremental](bool bSuccess)
+	{
+		AcraftingCharacter* Character = WeakThis.Get();
+		if (Character == nullptr)
+		{
+			return;
+		}
+		Character->bIsInventoryIOInFlight = false;
+		if (bSuccess)
+		{
+			Character->bFullSaveRequired = false;
+			Character->NumDeltaSaves = bIncremental ? Character->NumDeltaSaves + 1 : 0;
+		}
+		else
+		{
+			// the file no longer matches what we think was written, rewrite it fully next time
+			Character->bFullSaveRequired = true;
+		}
+
+		if (Character->bIsLoadPending)
+		{
+			Character->bIsLoadPending = false;
+			Character->LoadInventory();
+		}
+	});
+}
+
+void AcraftingCharacter::FinishInventorySave()
+{
+	if (SaveSlot.IsEmpty() || !bHasLoadedInventory)
+	{
+		return;
+	}
+	if (!bIsInventoryIOInFlight && !bFullSaveRequired && DirtyItemClasses.Num() == 0)
+	{
+		return;
+	}
+
+	// a write still on the pool would land after this one, its callback never runs once the pawn is gone
+	if (InventoryIO.IsValid())
+	{
+		InventoryIO.Wait();
+	}
+
+	FInventorySnapshot Snapshot;
+	FillInventorySnapshot(Snapshot, false);
+	DirtyItemClasses.Reset();
+	bFullSaveRequired = !FInventorySave::Save(SaveSlot, Snapshot, false);
+	NumDeltaSaves = 0;
+}
+
+void AcraftingCharacter::FillInventorySnapshot(FInventorySnapshot& Snapshot, bool bIncremental) const
+{
+	if (bIncremental)
+	{
+		for (TSubclassOf<APickupObject> ItemClass : DirtyItemClasses)
+		{
+			if (ItemClass == nullptr)
+			{
+				continue;
+			}
+			const FPickupItem* Item = CurrentItems.FindByPredicate([ItemClass](const FPickupItem& It) { return It.Class == ItemClass; });
+			Snapshot.AddSlot(ItemClass->GetPathName(), Item != nullptr ? Item->Number : 0);
+		}
+	}
+	else
+	{
+		// like RefreshItemDefinitions, stacks whose class went away are not written
+		for (const FPickupItem& Item : CurrentItems)
+		{
+			if (Item.Class != nullptr)
+			{
+				Snapshot.AddSlot(Item.Class->GetPathName(), Item.Number);
+			}
+		}
+	}
+}
+
+void AcraftingCharacter::LoadInventory()
+{
+	if (SaveSlot.IsEmpty())
+	{
+		return;
+	}
+	if (bIsInventoryIOInFlight)
+	{
+		bIsLoadPending = true;
+		return;
+	}
+
+	// what changes while the file is read happened after the save was made, it is applied on top of it
+	TMap<TSubclassOf<APickupObject>, int32> ItemsBeforeLoad;
+	for (const FPickupItem& Item : CurrentItems)
+	{
+		ItemsBeforeLoad.Add(Item.Class, Item.Number);
+	}
+
+	bIsInventoryIOInFlight = true;
+	TWeakObjectPtr<AcraftingCharacter> WeakThis(this);
+	InventoryIO = FInventorySave::LoadAsync(SaveSlot, [WeakThis, ItemsBeforeLoad](bool bSuccess, const TMap<FString, int32>& LoadedItems)
+	{
+		AcraftingCharacter* Character = WeakThis.Get();
+		if (Character == nullptr)
+		{
+			return;
+		}
+		Character->bIsInventoryIOInFlight = false;
+		if (!bSuccess)
+		{
+			// a save that cannot be read is kept for inspection instead of being replaced by whatever we hold
+			UE_LOG(LogCrafting, Error, TEXT("Could not read inventory slot '%s', it is not saved this session"), *Character->SaveSlot);
+			return;
+		}
+
+		Character->ApplyLoadedInventory(LoadedItems, ItemsBeforeLoad);
+		if (!Character->bHasLoadedInventory)
+		{
+			Character->bHasLoadedInventory = true;
+			if (Character->AutosaveInterval > 0)
+			{
+				Character->GetWorldTimerManager().SetTimer(Character->AutosaveTimer, Character, &AcraftingCharacter::Autosave, Character->AutosaveInterval, true);
+			}
+		}
+	});
+}
+
+void AcraftingCharacter::ApplyLoadedInventory(const TMap<FString, int32>& LoadedItems, const TMap<TSubclassOf<APickupObject>, int32>& ItemsBeforeLoad)
+{
+	TMap<TSubclassOf<APickupObject>, int32> Changes;
+	for (const FPickupItem& Item : CurrentItems)
+	{
+		Changes.Add(Item.Class, Item.Number - ItemsBeforeLoad.FindRef(Item.Class));
+	}
+	for (const TPair<TSubclassOf<APickupObject>, int32>& Before : ItemsBeforeLoad)
+	{
+		if (!Changes.Contains(Before.Key))
+		{
+			Changes.Add(Before.Key, -Before.Value);
+		}
+	}
+
+	CurrentItems.Reset(LoadedItems.Num());
+	for (const TPair<FString, int32>& Pair : LoadedItems)
+	{
+		TSubclassOf<APickupObject> ItemClass = StaticLoadClass(APickupObject::StaticClass(), nullptr, *Pair.Key);
+		if (ItemClass == nullptr)
+		{
+			UE_LOG(LogCrafting, Warning, TEXT("Dropping saved item of unknown class '%s'"), *Pair.Key);
+			continue;
+		}
+
+		// names and descriptions are not saved, they come from the class defaults
+		CurrentItems.Add(MakePickupItem(ItemClass, Pair.Value));
+	}
+
+	for (const TPair<TSubclassOf<APickupObject>, int32>& Change : Changes)
+	{
+		if (Change.Value == 0)
+		{
+			continue;
+		}
+		const int32 Index = CurrentItems.IndexOfByPredicate([&Change](const FPickupItem& It) { return It.Class == Change.Key; });
+		if (Index == INDEX_NONE)
+		{
+			if (Change.Value > 0)
+			{
+				CurrentItems.Add(MakePickupItem(Change.Key, Change.Value));
+			}
+		}
+		else if (CurrentItems[Index].Number + Change.Value > 0)
+		{
+			CurrentItems[Index].Number += Change.Value;
+		}
+		else
+		{
+			CurrentItems.RemoveAt(Index);
+		}
+	}
+
+	CategoryIndex.Rebuild(CurrentItems);
+	RebuildInventoryGrid();
+	UndoHistory.Reset();
+
+	// the next save rewrites the base, which also compacts the deltas replayed above
+	DirtyItemClasses.Reset();
+	bFullSaveRequired = true;
+	BroadcastCallback();
+}
+
+void AcraftingCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent)
+{
+	// set up gameplay key bindings
+	check(PlayerInputComponent);
+
+	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &ACharacter::Jump);
+	PlayerInputComponent->BindAction("Jump", IE_Released, this, &ACharacter::StopJumping);
+	PlayerInputComponent->BindAction("Inventory", IE_Pressed, this, &AcraftingCharacter::SetInventory);
+
+	//InputComponent->BindTouch(EInputEvent::IE_Pressed, this, &AcraftingCharacter::TouchStarted);
+	if (EnableTouchscreenMovement(PlayerInputComponent) == false)
+	{
+		PlayerInputComponent->BindAction("Fire", IE_Pressed, this, &AcraftingCharacter::OnFire);
+		PlayerInputComponent->BindAction("Fire", IE_Pressed, this, &AcraftingCharacter::OnStopFire);
+	}
+
+	PlayerInputComponent->BindAction("ResetVR", IE_Pressed, this, &AcraftingCharacter::OnResetVR);
+
+	PlayerInputComponent->BindAxis("MoveForward", this, &AcraftingCharacter::MoveForward);
+	PlayerInputComponent->BindAxis("MoveRight", this, &AcraftingCharacter::MoveRight);
+
+	// We have 2 versions of the rotation bindings to handle different kinds of devices differently
+	// "turn" handles devices that provide an absolute delta, such as a mouse.
+	// "turnrate" is for devices that we choose to treat as a rate of change, such as an analog joystick
+	PlayerInputComponent->BindAxis("Turn", this, &AcraftingCharacter::AddControllerYawInput);
+	PlayerInputComponent->BindAxis("TurnRate", this, &AcraftingCharacter::TurnAtRate);
+	PlayerInputComponent->BindAxis("LookUp", this, &AcraftingCharacter::AddControllerPitchInput);
+	PlayerInputComponent->BindAxis("LookUpRate", this, &AcraftingCharacter::LookUpAtRate);
+}
+
+void AcraftingCharacter::OnFire()
+{
+	// try and fire a projectile
+	if (!bIsInventoryOpen)
+	{
+		if (ProjectileClass != NULL)
+		{
+			UWorld* const World = GetWorld();
+			if (World != NULL)
+			{
+				if (bUsingMotionControllers)
+				{
+					const FRotator SpawnRotation = VR_MuzzleLocation->GetComponentRotation();
+					const FVector SpawnLocation = VR_MuzzleLocation->GetComponentLocation();
+					World->SpawnActor<AcraftingProjectile>(ProjectileClass, SpawnLocation, SpawnRotation);
+				}
+				else
+				{
+					const FRotator SpawnRotation = GetControlRotation();
+					// MuzzleOffset is in camera space, so transform it to world space before offsetting from the character location to find the final muzzle position
+					const FVector SpawnLocation = ((FP_MuzzleLocation != nullptr) ? FP_MuzzleLocation->GetComponentLocation() : GetActorLocation()) + SpawnRotation.RotateVector(GunOffset);
+
+					//Set Spawn Collision Handling Override
+					FActorSpawnParameters ActorSpawnParams;
+					ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
+
+					// spawn the projectile at the muzzle
+					World->SpawnActor<AcraftingProjectile>(ProjectileClass, SpawnLocation, SpawnRotation, ActorSpawnParams);
+				}
+			}
+		}
+
+		// try and play the sound if specified
+		if (FireSound != NULL && !bIsInventoryOpen)
+		{
+			UGameplayStatics::PlaySoundAtLocation(this, FireSound, GetActorLocation());
+		}
+
+		// try and play a firing animation if specified
+		if (FireAnimation != NULL)
+		{
+			// Get the animation object for the arms mesh
+			UAnimInstance* AnimInstance = Mesh1P->GetAnimInstance();
+			if (AnimInstance != NULL)
+			{
+				AnimInstance->Montage_Play(FireAnimation, 1.f);
+			}
+		}
+	}
+	else
+	{
+		InteractionPointer->PressPointerKey(EKeys::LeftMouseButton);
+	}
+}
+
+void AcraftingCharacter::OnStopFire()
+{
+	InteractionPointer->ReleasePointerKey(EKeys::LeftMouseButton);
+}
+
+void AcraftingCharacter::OnResetVR()
+{
+	UHeadMountedDisplayFunctionLibrary::ResetOrientationAndPosition();
+}
+
+void AcraftingCharacter::BeginTouch(const ETouchIndex::Type FingerIndex, const FVector Location)
+{
+	if (TouchItem.bIsPressed == true)
+	{
+		return;
+	}
+	TouchItem.bIsPressed = true;
+	TouchItem.FingerIndex = FingerIndex;
+	TouchItem.Location = Location;
+	TouchItem.bMoved = false;
+}
+
+void AcraftingCharacter::EndTouch(const ETouchIndex::Type FingerIndex, const FVector Location)
+{
+	if (TouchItem.bIsPressed == false)
+	{
+		return;
+	}
+	if ((FingerIndex == TouchItem.FingerIndex) && (TouchItem.bMoved == false))
+	{
+		OnFire();
+	}
+	TouchItem.bIsPressed = false;
+}
+
+void AcraftingCharacter::SetInventory()
+{
+	bIsInventoryOpen = !bIsInventoryOpen;
+
+	Mesh1P->SetVisibility(!bIsInventoryOpen, true);
+	FP_Gun->SetVisibility(!bIsInventoryOpen, true);
+
+	RecordReplayEvent(ECraftingReplayEvent::ToggleInventory);
+
+	if (PlayerController != nullptr)
+	{
+		PlayerController->bShowMouseCursor = bIsInventoryOpen;
+	}
+
+	if (bIsInventoryOpen && !bHasRequestedIcons)
+	{
+		// icons of the items we hold stream in ahead of the rest of the catalog
+		TArray<UClass*> HeldClasses;
+		for (const FPickupItem& Item : CurrentItems)
+		{
+			HeldClasses.Add(Item.Class);
+		}
+		FCraftingContentStreamer::Get().RequestIcons(ItemCatalog, HeldClasses);
+		bHasRequestedIcons = true;
+	}
+
+	if (bIsInventoryOpen)
+	{
+		// part of the toggle, so it is not recorded as a switch of its own
+		RotateUIToCraftingTable();
+
+		FVector2D ViewOrigin, ViewSize;
+		if (GetPlayerViewRect(ViewOrigin, ViewSize))
+		{
+			const FVector2D ViewCenter = ViewOrigin + ViewSize / 2;
+			PlayerController->SetMouseLocation(ViewCenter.X, ViewCenter.Y);
+
+			FInputModeGameAndUI mode;
+			mode.SetLockMouseToViewport(true);
+			mode.SetHideCursorDuringCapture(false);
+			PlayerController->SetInputMode(mode);
+		}
+		
+		CreateInventoryWidgets();
+		RecipeList->SetUIActive(true);
+		PlayerInventory->SetUIActive(true);
+
+		InteractionPointer->Activate();
+	}
+	else
+	{
+		RecipeList->SetUIActive(false);
+		PlayerInventory->SetUIActive(false);
+		if (PlayerController != nullptr)
+		{
+			FInputModeGameOnly mode;
+			PlayerController->SetInputMode(mode);
+		}
 
 		InteractionPointer->Deactivate();
 	}
@@ -1,11 +1,20 @@
 // Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
 #pragma once
 #include "GameFramework/Character.h"
-#include "Components/WidgetComponent.h"
+#include "CraftingWidgetComponent.h"
 #include "Components/WidgetInteractionComponent.h"
 #include "PickupObject.h"
+#include "CraftingRecipe.h"
+#include "CraftingItemCatalog.h"
+#include "InventoryCategoryIndex.h"
+#include "CraftingReplay.h"
+#include "CraftingUndoHistory.h"
+#include "GridInventory.h"
+#include "Async/Future.h"
 #include "craftingCharacter.generated.h"
 
+struct FInventorySnapshot;
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FItemsDelegate);
 
 
@@ -30,17 +39,11 @@ struct FPickupItem
 		FString Description;
 };
 
-USTRUCT(BlueprintType)
-struct FItemImages
+/** Signed change of one stack, used to apply many changes with a single Callback broadcast */
+struct FInventoryDelta
 {
-	GENERATED_BODY()
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
-		TSubclassOf<class APickupObject> Class;
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
-		UTexture2D *Texture;
-
+	TSubclassOf<class APickupObject> Class;
+	int32 Number;
 };
 
 
@@ -86,6 +89,7 @@ public:
 
 protected:
 	virtual void BeginPlay();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaSeconds);
 
 public:
@@ -166,16 +170,42 @@ protected:
 
 	// -------------- Inventory & pickups ---------------
 	void SetInventory();
+
+	/** Pixel rectangle of this player's view in the viewport, false without a local player */
+	bool GetPlayerViewRect(FVector2D& OutOrigin, FVector2D& OutSize) const;
+
+	void RotateUIToCraftingTable();
 	bool bIsInventoryOpen;
 	bool bIsUIRotting;
 	bool bIsCraftingTableCurrentUI;
 	float currentAngle;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = UI)
-	class UWidgetComponent* PlayerInventory;
+	class UCraftingWidgetComponent* PlayerInventory;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = UI)
-	class UWidgetComponent* RecipeList;
+	class UCraftingWidgetComponent* RecipeList;
+
+	/** Builds the inventory widgets ahead of the first open, one per frame once the game is idle */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = UI)
+	bool bPrewarmInventoryWidgets;
+
+	/** Seconds after BeginPlay before the pre-warm starts */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = UI)
+	float PrewarmDelay;
+
+	/** Frames longer than this are not idle, nothing is pre-warmed in them */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = UI)
+	float PrewarmMaxFrameTime;
+
+	/** Creates the widgets that do not exist yet and moves the recipe list beside the crafting table */
+	void CreateInventoryWidgets();
+
+	/** Creates at most one missing widget, returns false once there is nothing left to create */
+	bool PrewarmInventoryWidget();
+
+	bool bHasPlacedRecipeList;
+	float BeginPlayTime;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = UI)
 	float UIRadius;
@@ -186,12 +216,34 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = UI)
 	class UWidgetInteractionComponent* InteractionPointer;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = UI)
+	/** Read only for blueprints, changes go through ApplyInventoryDeltas so the category index follows them */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = UI)
 	TArray<FPickupItem> CurrentItems;
 
 	UPROPERTY(BlueprintAssignable, Category = UI)
 	FItemsDelegate Callback;
 
+	/** Category and rarity aggregates of CurrentItems */
+	FInventoryCategoryIndex CategoryIndex;
+
+	/** Cells of the bounded grid inventory, 0 keeps the unbounded list of stacks */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = UI)
+	int InventoryGridWidth;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = UI)
+	int InventoryGridHeight;
+
+	/** Placement of CurrentItems on the grid, follows every change of a stack */
+	FGridInventory InventoryGrid;
+
+	void RebuildInventoryGrid();
+
+	/** Soft references to all item icons, streamed in when the inventory is opened for the first time */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = UI)
+	class UCraftingItemCatalog* ItemCatalog;
+
+	bool bHasRequestedIcons;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = UI)
 	FRotator UIInitRotation;
 
@@ -219,6 +271,289 @@ public:
 
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = UI)
 		bool GetIsInventoryOpen();
+
+	/** Whether the items fit the grid inventory, always true without one */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = UI)
+		bool CanHoldItem(TSubclassOf<APickupObject> ItemClass, int Number) const;
+
+	/** Merges partial stacks and packs the grid inventory tightly, false when nothing changed because it would not fit */
+	UFUNCTION(BlueprintCallable, Category = UI)
+		bool SortInventoryGrid();
+
+	/** Stacks of the grid inventory with their cells, for the inventory widget */
+	UFUNCTION(BlueprintCallable, Category = UI)
+		TArray<FInventoryGridStack> GetInventoryGridStacks() const;
+
+	/** Items that do not fit the grid inventory, e.g. crafting results made while it was full */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = UI)
+		int GetInventoryGridOverflow() const;
+
+	/** Total number of held items of the category */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = UI)
+		int GetCategoryItemNumber(ECommonType Category) const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = UI)
+		int GetRareItemNumber() const;
+
+	/** Stacks of the category in inventory order, for the category tabs of the inventory */
+	UFUNCTION(BlueprintCallable, Category = UI)
+		TArray<FPickupItem> GetItemsInCategory(ECommonType Category) const;
+
+	UFUNCTION(BlueprintCallable, Category = UI)
+		TArray<FPickupItem> GetRareItems() const;
+
+	/** Icon of the item, null while it is still streaming in */
+	UFUNCTION(BlueprintCallable, Category = UI)
+		UTexture2D* GetItemIcon(TSubclassOf<APickupObject> ItemClass);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = Crafting)
+		int GetItemNumber(TSubclassOf<APickupObject> ItemClass) const;
+
+	/** How many times the recipe can be crafted from CurrentItems */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = Crafting)
+		int GetMaxCraftCount(const FCraftingRecipe& Recipe) const;
+
+	/** Applies all deltas and broadcasts Callback once, stacks are clamped at zero and removed when empty */
+	void ApplyInventoryDeltas(const TArray<FInventoryDelta>& Deltas);
+
+	FORCEINLINE const TArray<FPickupItem>& GetCurrentItems() const { return CurrentItems; }
+
+	/** Broadcasts Callback, every inventory change goes through here so the broadcasts can be counted */
+	void BroadcastCallback();
+
+	/** Builds a stack from the class defaults of the pickup */
+	static FPickupItem MakePickupItem(TSubclassOf<APickupObject> ItemClass, int Number);
+
+	/** Heap memory of the stacks, their strings and everything derived from them: indexes, undo steps and the table */
+	SIZE_T GetInventoryAllocatedSize() const;
+
+	/** Copies names, descriptions and rarity from the class defaults into the held stacks again, after item data was edited */
+	void RefreshItemDefinitions();
+
+	/** Player id for the journal, the same in every session: derived from the save slot of the controlling player */
+	uint32 GetJournalPlayerId() const;
+	// ------------------------------------------------
+
+	// -------------- Crafting table ---------------
+	/**
+	 * Places an item on the table, None empties the cell. An item placed on an occupied cell sends the one it
+	 * replaces back to the inventory, both revert in one undo step. The output is resolved again right away
+	 */
+	UFUNCTION(BlueprintCallable, Category = Crafting)
+		void SetCraftTableCell(int X, int Y, TSubclassOf<APickupObject> ItemClass);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = Crafting)
+		TSubclassOf<APickupObject> GetCraftTableCell(int X, int Y) const;
+
+	/** Empties the table, the items go back to the inventory when bReturnItems is set */
+	UFUNCTION(BlueprintCallable, Category = Crafting)
+		void ClearCraftTable(bool bReturnItems);
+
+	/** Recipe the items on the table form, false when they form none */
+	UFUNCTION(BlueprintCallable, Category = Crafting)
+		bool GetCraftTableResult(FCraftingRecipe& OutRecipe) const;
+
+	/** Turns the items on the table into the result of the recipe they form and empties the table */
+	UFUNCTION(BlueprintCallable, Category = Crafting)
+		bool CraftFromTable();
+
+	/** Reverts the last inventory or table action of the player, pickups and station crafts are not undone */
+	UFUNCTION(BlueprintCallable, Category = Crafting)
+		bool Undo();
+
+	UFUNCTION(BlueprintCallable, Category = Crafting)
+		bool Redo();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = Crafting)
+		bool CanUndo() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = Crafting)
+		bool CanRedo() const;
+
+protected:
+	void ResolveCraftTable();
+
+	/** Re-resolves the table and redraws the recipe list after recipes of the book were edited */
+	void OnRecipesChanged(const TArray<int32>& ChangedRecipes);
+
+	FDelegateHandle RecipesChangedHandle;
+	void SetCraftTableCellAt(int32 Cell, UClass* ItemClass);
+
+	/** ClearCraftTable without the replay event, for actions that empty the table as part of something else */
+	void EmptyCraftTable(bool bReturnItems);
+
+	/** Recipes that can be made on the crafting table */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Crafting)
+	class UCraftingRecipeBook* RecipeBook;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Crafting)
+	int CraftTableWidth;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Crafting)
+	int CraftTableHeight;
+
+	/** Row major cells of the table, the items on it are no longer in CurrentItems */
+	TArray<TSubclassOf<APickupObject>> CraftTableCells;
+
+	/** Recipe book index of the current table output, INDEX_NONE for none */
+	int32 CraftTableRecipe;
+
+	/** Undo steps kept, older ones are forgotten */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Crafting)
+	int UndoDepth;
+
+	FCraftingUndoHistory UndoHistory;
+
+	/** Set while undo or redo change the inventory, so the changes are not recorded again */
+	bool bIsApplyingHistory;
+
+	/**
+	 * Set by the inventory and table actions of the player for their duration. Changes made without it,
+	 * pickups, station jobs or prediction rollbacks, never become undo steps: undoing them would duplicate items.
+	 */
+	bool bRecordUndo;
+	// ------------------------------------------------
+
+public:
+	// -------------- Replays ---------------
+	/** Starts recording the inventory and crafting UI events of this player */
+	UFUNCTION(Exec)
+		void CraftingReplayRecord();
+
+	/** Stops recording and writes Saved/Replays/<Name>.ccr */
+	UFUNCTION(Exec)
+		void CraftingReplayStop(const FString& Name);
+
+	/** Feeds one recorded event back, used by the CraftingReplay commandlet */
+	void PlayReplayEvent(ECraftingReplayEvent Type, TSubclassOf<APickupObject> ItemClass, int32 Value = 0);
+
+	/** Takes the ingredients of a queued station craft, Deltas are negative */
+	void TakeCraftIngredients(const TArray<FInventoryDelta>& Deltas);
+
+	/** Adds the results of finished station jobs */
+	void AddCraftResults(const TArray<FInventoryDelta>& Deltas);
+
+protected:
+	void RecordReplayEvent(ECraftingReplayEvent Type, UClass* ItemClass = nullptr, int32 Value = 0);
+
+	TSharedPtr<class FCraftingReplay> ReplayRecording;
+	// ------------------------------------------------
+
+public:
+	// -------------- Inventory persistence ---------------
+	/** Writes the inventory in the background, incremental saves only store stacks changed since the last save */
+	UFUNCTION(BlueprintCallable, Category = Save)
+		void SaveInventory(bool bIncremental);
+
+	/**
+	 * Reads the inventory in the background and replaces CurrentItems with it once it is done, items gained
+	 * or lost while it was read are applied on top. Waits for a save that is still being written.
+	 */
+	UFUNCTION(BlueprintCallable, Category = Save)
+		void LoadInventory();
+
+	virtual void PossessedBy(AController* NewController) override;
+
+protected:
+	/** Base name of the save, local players and remote players get their own slot derived from it */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Save)
+	FString InventorySaveSlot;
+
+	/** Seconds between incremental autosaves, 0 disables autosave */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Save)
+	float AutosaveInterval;
+
+	/** Picks the slot of the controlling player and loads it, autosave starts once the load finished */
+	void StartInventoryPersistence(APlayerController* Controller);
+
+	/** The local player index for players of this machine, the unique net id for remote players, empty without either */
+	FString GetInventorySaveSlot(const APlayerController* Controller) const;
+
+	void Autosave();
+
+	/** Writes the whole inventory before the pawn goes away, after waiting for the file work still running */
+	void FinishInventorySave();
+
+	/** Skips stacks without a class, the incremental snapshot only holds the dirty classes */
+	void FillInventorySnapshot(FInventorySnapshot& Snapshot, bool bIncremental) const;
+
+	void ApplyLoadedInventory(const TMap<FString, int32>& LoadedItems, const TMap<TSubclassOf<APickupObject>, int32>& ItemsBeforeLoad);
+
+	/**
+	 * Called after every change of the stack in Slot. OldNumber is 0 when the stack was just added,
+	 * NewNumber is 0 when it was removed and the following slots moved down.
+	 */
+	void MarkItemChanged(int32 Slot, TSubclassOf<APickupObject> ItemClass, int OldNumber, int NewNumber);
+
+	TSet<TSubclassOf<APickupObject>> DirtyItemClasses;
+	FTimerHandle AutosaveTimer;
+	int32 NumDeltaSaves;
+	bool bFullSaveRequired;
+	bool bIsInventoryIOInFlight;
+
+	/** File work of the last save or load, waited for before the final save */
+	TFuture<void> InventoryIO;
+
+	/** Slot of this player, empty while nothing may be saved: without a player, off the authority */
+	FString SaveSlot;
+
+	/** Nothing is written before the save was read or found absent, a base of the starting inventory would replace it */
+	bool bHasLoadedInventory;
+
+	/** LoadInventory was called while a save was written, it runs once that finished */
+	bool bIsLoadPending;
+
+	/** Cached GetJournalPlayerId, 0 until first used and after the pawn changed hands */
+	mutable uint32 JournalPlayerId;
+	// ------------------------------------------------
+
+public:
+	// -------------- Pickup prediction ---------------
+	/** Collects the pickup right away on the owning client and asks the server to confirm it */
+	void PredictPickup(APickupObject* Pickup);
+
+	/** Predictions the server has neither confirmed nor rejected yet */
+	FORCEINLINE int32 GetNumPredictedPickups() const { return PredictedPickups.Num(); }
+
+protected:
+	UFUNCTION(Server, Reliable, WithValidation)
+		void ServerCollectPickup(APickupObject* Pickup, int32 PredictionKey);
+
+	UFUNCTION(Client, Reliable)
+		void ClientConfirmPickup(int32 PredictionKey);
+
+	/** Takes the predicted item back out of the inventory and shows the pickup again */
+	UFUNCTION(Client, Reliable)
+		void ClientRejectPickup(int32 PredictionKey);
+
+	/** How far the server lets the pawn be from a pickup it claims, covers movement the server has not seen yet */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Network)
+	float PickupTolerance;
+
+	/** Pickup the server has not answered for yet */
+	struct FPredictedPickup
+	{
+		int32 Key;
+		TWeakObjectPtr<APickupObject> Pickup;
+		TSubclassOf<APickupObject> Class;
+	};
+
+	TArray<FPredictedPickup> PredictedPickups;
+	int32 NextPredictionKey;
+	// ------------------------------------------------
+
+public:
+	// -------------- Pickup magnet ---------------
+	/** Pickups within this distance fly to the player and are collected, 0 turns the magnet off */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Pickup)
+	float MagnetRadius;
+
+	/** Speed the pickups fly to the player with */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Pickup)
+	float MagnetSpeed;
+
+	/** Adds the items FPickupMagnet collected for the player this frame with a single Callback broadcast */
+	void AddPickedUpItems(const TArray<FInventoryDelta>& Deltas);
 	// ------------------------------------------------
 
 protected:
@@ -8,10 +8,49 @@
 AcraftingGameMode::AcraftingGameMode()
 	: Super()
 {
-	// set default pawn class to our Blueprinted character
-	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnClassFinder(TEXT("/Game/FirstPersonCPP/Blueprints/FirstPersonCharacter"));
-	DefaultPawnClass = PlayerPawnClassFinder.Class;
-
 	// use our custom HUD class
 	HUDClass = AcraftingHUD::StaticClass();
+
+	// finished crafts are handed over to the inventories once per frame
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void AcraftingGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	// set default pawn class to our Blueprinted character
+	if (UClass* PlayerPawnClass = PlayerPawnClassName.TryLoadClass<APawn>())
+	{
+		DefaultPawnClass = PlayerPawnClass;
+	}
+
+	Super::InitGame(MapName, Options, ErrorMessage);
+}
+
+void AcraftingGameMode::BeginPlay()
+{
+	Super::BeginPlay();
+
+	CraftingJobs = MakeUnique<FCraftingJobScheduler>();
+}
+
+void AcraftingGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (CraftingJobs.IsValid())
+	{
+		const int32 NumFinished = CraftingJobs->FinishAllJobs();
+		UE_CLOG(NumFinished > 0, LogCrafting, Log, TEXT("Handed out %d unfinished crafts at the end of play"), NumFinished);
+		CraftingJobs.Reset();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AcraftingGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (CraftingJobs.IsValid())
+	{
+		CraftingJobs->ProcessCompletedJobs(GetWorld()->GetTimeSeconds());
+	}
 }
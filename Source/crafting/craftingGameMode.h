@@ -1,6 +1,7 @@
 // Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
 #pragma once
 #include "GameFramework/GameModeBase.h"
+#include "CraftingJobScheduler.h"
 #include "craftingGameMode.generated.h"
 
 UCLASS(minimalapi)
@@ -10,6 +11,21 @@ class AcraftingGameMode : public AGameModeBase
 
 public:
 	AcraftingGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** Timed crafts of all stations in the world, null outside of play */
+	FCraftingJobScheduler* GetCraftingJobs() { return CraftingJobs.Get(); }
+
+private:
+	/** Loaded when a game starts instead of when the class default object is built at boot */
+	UPROPERTY(config)
+	FStringClassReference PlayerPawnClassName;
+
+	TUniquePtr<FCraftingJobScheduler> CraftingJobs;
 };
 
 
@@ -6,12 +6,12 @@
 #include "TextureResource.h"
 #include "craftingCharacter.h"
 #include "CanvasItem.h"
+#include "CraftingContentStreamer.h"
 
 AcraftingHUD::AcraftingHUD()
 {
 	// Set the crosshair texture
-	static ConstructorHelpers::FObjectFinder<UTexture2D> CrosshiarTexObj(TEXT("/Game/FirstPerson/Textures/FirstPersonCrosshair"));
-	CrosshairTex = CrosshiarTexObj.Object;
+	CrosshairTex = TAssetPtr<UTexture2D>(FStringAssetReference(TEXT("/Game/FirstPerson/Textures/FirstPersonCrosshair.FirstPersonCrosshair")));
 }
 
 
@@ -19,7 +19,11 @@ void AcraftingHUD::DrawHUD()
 {
 	Super::DrawHUD();
 
-	if (!PlayerPawn->GetIsInventoryOpen())
+	FCraftingContentStreamer::Get().NotifyFirstFrame();
+
+	// every local player has its own HUD, it follows the pawn of its own controller
+	AcraftingCharacter* PlayerPawn = Cast<AcraftingCharacter>(GetOwningPawn());
+	if (PlayerPawn != nullptr && !PlayerPawn->GetIsInventoryOpen() && CrosshairTex.Get() != nullptr)
 	{
 		// Draw very simple crosshair
 
@@ -31,7 +35,7 @@ void AcraftingHUD::DrawHUD()
 			(Center.Y + 20.0f));
 
 		// draw the crosshair
-		FCanvasTileItem TileItem(CrosshairDrawPosition, CrosshairTex->Resource, FLinearColor::White);
+		FCanvasTileItem TileItem(CrosshairDrawPosition, CrosshairTex.Get()->Resource, FLinearColor::White);
 		TileItem.BlendMode = SE_BLEND_Translucent;
 		Canvas->DrawItem(TileItem);
 	}
@@ -41,7 +45,8 @@ void AcraftingHUD::BeginPlay()
 {
 	Super::BeginPlay();
 
-	PlayerPawn = Cast<AcraftingCharacter>(GetWorld()->GetFirstPlayerController()->GetPawn());
-
+	TArray<FStringAssetReference> Crosshair;
+	Crosshair.Add(CrosshairTex.ToStringReference());
+	FCraftingContentStreamer::Get().RequestAssets(MoveTemp(Crosshair), FCraftingContentStreamer::PriorityHeld, FSimpleDelegate());
 }
 
@@ -16,10 +16,9 @@ public:
 	virtual void BeginPlay() override;
 
 private:
-	/** Crosshair asset pointer */
-	class UTexture2D* CrosshairTex;
-
-	class AcraftingCharacter *PlayerPawn;
+	/** Crosshair asset pointer, streamed in on BeginPlay */
+	UPROPERTY(EditDefaultsOnly, Category = HUD)
+	TAssetPtr<UTexture2D> CrosshairTex;
 
 };
 